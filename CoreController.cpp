@@ -9,6 +9,7 @@
 #include "core/manager/HandoffManager.h"
 #include "core/manager/KeyboardEmulator.h"
 #include "core/manager/LogManager.h"
+#include "core/manager/ProjectHistory.h"
 #include "core/manager/ProjectManager.h"
 #include "core/manager/WebsocketConnection.h"
 #include "core/manager/StatusManager.h"
@@ -56,6 +57,7 @@ CoreController::CoreController(QQmlApplicationEngine* qmlEngine, QString templat
     qmlRegisterAnonymousType<HandoffManager>("Luminosus", 1);
     qmlRegisterAnonymousType<KeyboardEmulator>("Luminosus", 1);
     qmlRegisterAnonymousType<LogManager>("Luminosus", 1);
+    qmlRegisterAnonymousType<ProjectHistory>("Luminosus", 1);
     qmlRegisterAnonymousType<ProjectManager>("Luminosus", 1);
     qmlRegisterAnonymousType<WebsocketConnection>("Luminosus", 1);
 
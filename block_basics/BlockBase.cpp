@@ -5,8 +5,11 @@
 #include "core/manager/GuiManager.h"
 #include "core/connections/Nodes.h"
 #include "core/helpers/SmartAttribute.h"
+#include "core/helpers/cbor_stream_utils.h"
+#include "core/helpers/SlabAllocator.h"
 
 #include <QQmlEngine>
+#include <QSet>
 #include <time.h>
 #include <string>
 #include <cstdlib>
@@ -33,8 +36,10 @@ BlockBase::BlockBase(CoreController* controller, QString uid)
   , m_heightIsResizable(false)
   , m_guiItemParent(nullptr)
   , m_guiShouldBeHidden(false)
+  , m_suspended(false)
   , m_focused(false)
   , m_guiItemCompleted(false)
+  , m_guiItemIsRecyclable(false)
   , m_controllerFunctionCount(1)
   , m_controllerFunctionSelected(0)
   , m_isSceneBlock(false)
@@ -59,6 +64,19 @@ BlockBase::~BlockBase() {
     }
 }
 
+void* BlockBase::operator new(std::size_t size) {
+    return allocator().allocate(size);
+}
+
+void BlockBase::operator delete(void* ptr, std::size_t size) {
+    allocator().deallocate(ptr, size);
+}
+
+SlabAllocator& BlockBase::allocator() {
+    static SlabAllocator blockAllocator("Blocks");
+    return blockAllocator;
+}
+
 QCborMap BlockBase::getState() const {
     QCborMap state;
     state["sceneGroup"_q] = getSceneGroup();
@@ -77,6 +95,99 @@ void BlockBase::setState(const QCborMap& state) {
     setAdditionalState(state);
 }
 
+void BlockBase::writeState(QCborStreamWriter& writer) const {
+    writer.startMap();
+    writer.append("sceneGroup"_q);
+    writer.append(qint64(getSceneGroup()));
+    writer.append("guiItemHidden"_q);
+    writer.append(guiShouldBeHidden());
+    writer.append("group"_q);
+    writer.append(getGroup());
+    writeAttributesTo(writer);
+    // the additional state is usually small or empty, it is still created as a map
+    // to keep the interface for blocks unchanged:
+    QCborMap additionalState;
+    getAdditionalState(additionalState);
+    for (auto it = additionalState.constBegin(); it != additionalState.constEnd(); ++it) {
+        it.key().toCbor(writer);
+        it.value().toCbor(writer);
+    }
+    writer.endMap();
+}
+
+void BlockBase::readState(QCborStreamReader& reader) {
+    if (!reader.isMap()) {
+        qWarning() << "Block state is not a map: " << getUid();
+        setState(QCborValue::fromCbor(reader).toMap());
+        return;
+    }
+
+    // same order and defaults as in setState():
+    int sceneGroup = 0;
+    bool guiItemHidden = false;
+    QString group;
+    bool fixedKeysApplied = false;
+    auto applyFixedKeys = [&]() {
+        if (fixedKeysApplied) return;
+        fixedKeysApplied = true;
+        setSceneGroup(sceneGroup);
+        if (guiItemHidden) hideGui();
+        setGroup(group);
+    };
+
+    QSet<SmartAttribute*> restoredAttributes;
+    QVector<bool> restoredTableValues(m_attributeTable.size(), false);
+    QCborMap additionalState;
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isString()) {
+            // skip key and value:
+            reader.next();
+            reader.next();
+            continue;
+        }
+        const QString key = readCborString(reader);
+        if (key == "sceneGroup") {
+            sceneGroup = int(QCborValue::fromCbor(reader).toInteger());
+            continue;
+        } else if (key == "guiItemHidden") {
+            guiItemHidden = QCborValue::fromCbor(reader).toBool();
+            continue;
+        } else if (key == "group") {
+            group = readCborString(reader);
+            continue;
+        }
+        applyFixedKeys();
+        SmartAttribute* attr = persistentAttributeForKey(key);
+        const int tableIndex = attr ? -1 : m_attributeTable.persistentIndexForKey(key);
+        if (attr) {
+            attr->readFrom(key, reader);
+            restoredAttributes.insert(attr);
+        } else if (tableIndex >= 0) {
+            m_attributeTable.readFrom(tableIndex, reader);
+            restoredTableValues[tableIndex] = true;
+        } else {
+            additionalState[key] = QCborValue::fromCbor(reader);
+        }
+    }
+    reader.leaveContainer();
+    applyFixedKeys();
+
+    for (SmartAttribute* attr: restoredAttributes) {
+        attr->finishReading();
+    }
+    // attributes that are not part of the state are reset like in readAttributesFrom():
+    for (SmartAttribute* attr: m_persistentAttributes) {
+        if (!attr || restoredAttributes.contains(attr)) continue;
+        attr->readFrom(QCborMap());
+    }
+    for (int i = 0; i < m_attributeTable.size(); ++i) {
+        if (!m_attributeTable.isPersistent(i) || restoredTableValues[i]) continue;
+        m_attributeTable.resetToMissingState(i);
+    }
+    setAdditionalState(additionalState);
+}
+
 QCborArray BlockBase::getConnections() {
     QCborArray connections;
     for (NodeBase* node: m_nodes.values()) {
@@ -234,6 +345,8 @@ void BlockBase::setGuiItemCode(QString code) {
         return;
     }
     destroyGuiItem();
+    // the item is not created from the QML file of this block type:
+    m_guiItemIsRecyclable = false;
 
     newGuiItem->setProperty("block", QVariant::fromValue<QObject*>(this));
     newGuiItem->setProperty("plane", QVariant::fromValue<QQuickItem*>(m_guiItemParent));
@@ -312,37 +425,39 @@ QObject* BlockBase::attr(QString name) {
 void BlockBase::createGuiItem() {
     if (m_guiItem) return;
 
-    QQmlComponent* component = new QQmlComponent(m_controller->guiManager()->qmlEngine(), QUrl(this->getBlockInfo().qmlFile));
-    if (!component) {
-        qWarning() << "Couldn't create QML component.";
-        return;
-    }
-    QQuickItem* newGuiItem = qobject_cast<QQuickItem*>(component->beginCreate(m_controller->guiManager()->qmlEngine()->rootContext()));
-    if (!newGuiItem) {
-        qCritical() << "Could not create GUI item: " << component->errorString();
-
-        component->deleteLater();
-        component = new QQmlComponent(m_controller->guiManager()->qmlEngine(), QUrl(BlockBaseConstants::fallbackQmlFile));
-        if (!component) {
-            qWarning() << "Could create QML component loader.";
-            return;
-        }
+    GuiItemPool* pool = m_controller->guiManager()->itemPool();
+    const BlockInfo info = getBlockInfo();
+    QQuickItem* newGuiItem = pool->takeItem(info.qmlFile, this, info.guiItemIsRebindable);
+    if (newGuiItem) {
+        // reuse an unused item, changing the block property updates its bindings:
+        newGuiItem->setProperty("block", QVariant::fromValue<QObject*>(this));
+        newGuiItem->setProperty("plane", QVariant::fromValue<QQuickItem*>(m_guiItemParent));
+        newGuiItem->setParentItem(m_guiShouldBeHidden ? nullptr : m_guiItemParent);
+        newGuiItem->setVisible(true);
+        m_guiItemIsRecyclable = true;
+    } else {
+        QQmlComponent* component = pool->component(info.qmlFile);
         newGuiItem = qobject_cast<QQuickItem*>(component->beginCreate(m_controller->guiManager()->qmlEngine()->rootContext()));
+        m_guiItemIsRecyclable = newGuiItem != nullptr;
         if (!newGuiItem) {
-            qCritical() << "Could not create fallback GUI item: " << component->errorString();
-            return;
+            qCritical() << "Could not create GUI item: " << component->errorString();
+
+            component = pool->component(BlockBaseConstants::fallbackQmlFile);
+            newGuiItem = qobject_cast<QQuickItem*>(component->beginCreate(m_controller->guiManager()->qmlEngine()->rootContext()));
+            if (!newGuiItem) {
+                qCritical() << "Could not create fallback GUI item: " << component->errorString();
+                return;
+            }
         }
+        newGuiItem->setProperty("block", QVariant::fromValue<QObject*>(this));
+        newGuiItem->setProperty("plane", QVariant::fromValue<QQuickItem*>(m_guiItemParent));
+        if (m_guiShouldBeHidden) {
+            newGuiItem->setParentItem(nullptr);
+        } else {
+            newGuiItem->setParentItem(m_guiItemParent);
+        }
+        component->completeCreate();
     }
-    newGuiItem->setProperty("block", QVariant::fromValue<QObject*>(this));
-    newGuiItem->setProperty("plane", QVariant::fromValue<QQuickItem*>(m_guiItemParent));
-    if (m_guiShouldBeHidden) {
-        newGuiItem->setParentItem(nullptr);
-    } else {
-        newGuiItem->setParentItem(m_guiItemParent);
-    }
-    component->completeCreate();
-    component->deleteLater();
-    component = nullptr;
     newGuiItem->setX(m_guiX);
     newGuiItem->setY(m_guiY);
     if (m_widthIsResizable && m_guiWidth >= 1.0) newGuiItem->setWidth(m_guiWidth);
@@ -364,12 +479,17 @@ void BlockBase::destroyGuiItem(bool immediate) {
     m_guiHeight = m_guiItem->height();
     m_guiItem->setVisible(false);
     m_guiItem->setParentItem(nullptr);
-    if (immediate) {
+    disconnect(m_guiItem, nullptr, this, nullptr);
+    const BlockInfo info = getBlockInfo();
+    if (m_guiItemIsRecyclable && m_controller->guiManager()->itemPool()->recycleItem(info.qmlFile, m_guiItem, this, info.guiItemIsRebindable)) {
+        // the item is kept in the pool to be reused
+    } else if (immediate) {
         delete m_guiItem;
     } else {
         m_guiItem->deleteLater();
     }
     m_guiItem = nullptr;
+    m_guiItemIsRecyclable = false;
 }
 
 QQuickItem* BlockBase::getGuiItem() {
@@ -384,6 +504,25 @@ double BlockBase::getGuiX() const {
     return m_guiItem ? m_guiItem->x() : m_guiX;
 }
 
+void BlockBase::setGroup(QString group) {
+    if (group == m_group) return;
+    const QString oldGroup = m_group;
+    m_group = group;
+    m_controller->blockManager()->onBlockGroupChanged(this, oldGroup);
+}
+
+void BlockBase::setSuspended(bool value) {
+    if (value == m_suspended) return;
+    m_suspended = value;
+    for (NodeBase* node: m_nodes) {
+        if (!node || node->isOutput()) continue;
+        node->setSuspended(value);
+    }
+    // nobody sees the changes while the block is suspended:
+    setAttributeNotificationsPaused(m_suspended || m_guiShouldBeHidden);
+    emit suspendedChanged();
+}
+
 void BlockBase::setGuiX(double value) {
     if (m_guiItem) {
         m_guiItem->setX(value);
@@ -451,6 +590,7 @@ void BlockBase::showFullscreen() {
 
 void BlockBase::hideGui() {
     m_guiShouldBeHidden = true;
+    setAttributeNotificationsPaused(true);
     QQuickItem* item = getGuiItem();
     if (!item) return;
     m_guiItemParent = item->parentItem();
@@ -459,6 +599,7 @@ void BlockBase::hideGui() {
 
 void BlockBase::unhideGui() {
     m_guiShouldBeHidden = false;
+    setAttributeNotificationsPaused(m_suspended);
     QQuickItem* item = getGuiItem();
     if (!item) return;
     item->setParentItem(m_guiItemParent);
@@ -20,6 +20,7 @@ class NodeBase;
 class OutputNodeHsv;
 class InputNodeHsv;
 class SmartAttribute;
+class SlabAllocator;
 
 /**
  * @brief The BlockBase class is the basis of all blocks.
@@ -36,6 +37,8 @@ class BlockBase : public BlockInterface, public ObjectWithAttributes
 
     Q_PROPERTY(bool guiIsHidden READ guiIsHidden NOTIFY guiIsHiddenChanged)
 
+    Q_PROPERTY(bool suspended READ isSuspended NOTIFY suspendedChanged)
+
 public:
     // constructor etc:
     /**
@@ -50,10 +53,25 @@ public:
      */
     virtual ~BlockBase() override;
 
+    /**
+     * @brief operator new allocates blocks (including their attributes) from a slab allocator
+     * to avoid a heap allocation per block when loading or deleting many blocks
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
+    /**
+     * @brief allocator returns the slab allocator all blocks are created with
+     * @return the allocator, i.e. to release its empty slabs or get statistics
+     */
+    static SlabAllocator& allocator();
+
 	// interface methods (documentation is in interface):
     virtual void onCreatedByUser() override {}
     virtual QCborMap getState() const override;
     virtual void setState(const QCborMap& state) override;
+    virtual void writeState(QCborStreamWriter& writer) const override;
+    virtual void readState(QCborStreamReader& reader) override;
     virtual void getAdditionalState(QCborMap& /*state*/) const override {}
     virtual void setAdditionalState(const QCborMap& /*state*/) override {}
     virtual QCborArray getConnections() override;
@@ -104,6 +122,8 @@ signals:
 
     void guiIsHiddenChanged();
 
+    void suspendedChanged();
+
 public slots:
     virtual QString getUid() const override { return m_uid; }
     virtual void setUid(QString id) override { m_uid = id; }
@@ -149,7 +169,9 @@ public slots:
     virtual void setGuiParentItem(QQuickItem* parent) override;
     virtual void onGuiItemCreated() override {}
     virtual QString getGroup() const override { return m_group; }
-    virtual void setGroup(QString group) override { m_group = group; }
+    virtual void setGroup(QString group) override;
+    virtual bool isSuspended() const override { return m_suspended; }
+    virtual void setSuspended(bool value) override;
 
     // ---------------------------- Scenes ----------------------------
 
@@ -228,6 +250,10 @@ protected:
      * @brief m_group is the UID of the group of this block
      */
     QString m_group;
+    /**
+     * @brief m_suspended is true if the inputs of this block are suspended (see setSuspended())
+     */
+    bool m_suspended;
 	/**
 	 * @brief m_nodes stores pointer to all created nodes
 	 */
@@ -252,6 +278,12 @@ protected:
      */
     bool m_guiItemCompleted;
 
+    /**
+     * @brief m_guiItemIsRecyclable is true if the GUI item was created from the QML file of this block type
+     * and can be reused when it is destroyed
+     */
+    bool m_guiItemIsRecyclable;
+
     /**
      * @brief m_controllerFunctionCount is the count of function reachable by pressing the controller
      */
@@ -6,6 +6,8 @@
 
 #include <QObject>
 #include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
 #include <QQuickItem>
 #include <QString>
 
@@ -83,6 +85,18 @@ struct BlockInfo {
 	 * @brief qmlFile is the path to the file containing the QML component for this block
 	 */
 	QString qmlFile = "";
+    /**
+     * @brief guiItemIsRebindable is true if the GUI item only depends on its "block" property
+     * and can be reused for another block of this type after changing it (see GuiItemPool),
+     * the QML file has to handle a block property that is null while the item is unused
+     */
+    bool guiItemIsRebindable = false;
+    /**
+     * @brief visualizationOnly is true if the block only displays its input data
+     * and has no effect on other blocks or outputs,
+     * it is suspended while its group is not displayed (see BlockInterface::setSuspended())
+     */
+    bool visualizationOnly = false;
 	/**
 	 * @brief helpText is a text to be displayed in the help section of the UI
 	 */
@@ -136,6 +150,12 @@ public:
     BlockInterface(CoreController* controller) : QObject(static_cast<QObject*>(controller)) { }
     virtual ~BlockInterface() {}  // virtual destructor makes shure the right destructor is called
 
+    /**
+     * @brief getController returns the main controller this block belongs to
+     * @return a pointer to the CoreController
+     */
+    CoreController* getController() const { return static_cast<CoreController*>(parent()); }
+
     /**
      * @brief onCreatedByUser is called after the block was initially added by the user
      * from the GUI, it can be used to set some default values for this case
@@ -153,6 +173,20 @@ public:
      * (including the attributes)
      */
     virtual void setState(const QCborMap&) = 0;
+    /**
+     * @brief writeState writes the same state as getState() to a CBOR stream,
+     * the default implementation uses getState(), override it to write the state
+     * without creating an intermediate QCborMap
+     * @param writer the stream writer, the state is written as a single map item
+     */
+    virtual void writeState(QCborStreamWriter& writer) const { getState().toCborValue().toCbor(writer); }
+    /**
+     * @brief readState restores the state written by writeState() or getState() from a CBOR stream,
+     * the default implementation uses setState(), override it to restore the state
+     * without creating an intermediate QCborMap
+     * @param reader the stream reader, positioned on the map item, it is advanced past it
+     */
+    virtual void readState(QCborStreamReader& reader) { setState(QCborValue::fromCbor(reader).toMap()); }
     /**
      * @brief getAdditionalState is used to get the current additional state of the block beside
      * the attributes to persist it
@@ -442,6 +476,19 @@ public slots:
     virtual QString getGroup() const = 0;
     virtual void setGroup(QString group) = 0;
 
+    /**
+     * @brief isSuspended returns if the block is suspended because it is not displayed
+     * @return true if suspended
+     */
+    virtual bool isSuspended() const = 0;
+    /**
+     * @brief setSuspended suspends or resumes the block, a suspended block doesn't
+     * receive data changes of its inputs and its inputs are inactive
+     * (called by the BlockManager for visualization-only blocks)
+     * @param value true to suspend, false to resume
+     */
+    virtual void setSuspended(bool value) = 0;
+
     // ---------------------------- Scenes ----------------------------
 
     virtual bool isSceneBlock() const = 0;
@@ -16,6 +16,7 @@ public:
         info.typeName = "Connection Cycle";
         info.category << "General" << "Groups / Projects";
         info.qmlFile = "qrc:/core/ui/blocks/ConnectionCycleBlock.qml";
+        info.guiItemIsRebindable = true;
         info.helpText = "Lets you create an intentional connection cycle\n"
                         "It overrides the cycle detection, so please ensure to not create "
                         "endless update loops.\n\n"
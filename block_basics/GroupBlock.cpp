@@ -47,9 +47,7 @@ void GroupBlock::moveFocusedBlockToGroup() {
     if (focusedBlock == nullptr || focusedBlock == this) return;
     if (focusedBlock->getGroup() != getGroup()) return;
 
-    QSet<BlockInterface*> connectedBlocks;
-    connectedBlocks.insert(focusedBlock);
-    findConnectedBlocks(focusedBlock, connectedBlocks);
+    const QVector<BlockInterface*> connectedBlocks = m_controller->blockManager()->getConnectedBlocks(focusedBlock);
 
     QString group = getUid();
     QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
@@ -60,20 +58,14 @@ void GroupBlock::moveFocusedBlockToGroup() {
     for (BlockInterface* block: connectedBlocks) {
         block->setGuiX(block->getGuiX() + xOffset);
         block->setGuiY(block->getGuiY() + yOffset);
-        m_controller->blockManager()->setGroupOfBlock(block, group);
     }
+    m_controller->blockManager()->setGroupOfBlocks(connectedBlocks, group);
 }
 
 void GroupBlock::moveAllBlocksToGroup() {
-    QSet<BlockInterface*> blocksOnThisLevel;
     QString parentGroup = getGroup();
-    for (QPointer<BlockInterface> block: m_controller->blockManager()->getCurrentBlocks()) {
-        if (block.isNull()) continue;
-        if (block == this) continue;
-        if (block->getGroup() == parentGroup) {
-            blocksOnThisLevel.insert(block);
-        }
-    }
+    QVector<BlockInterface*> blocksOnThisLevel = m_controller->blockManager()->getBlocksInGroup(parentGroup);
+    blocksOnThisLevel.removeOne(this);
 
     QString group = getUid();
     QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
@@ -84,23 +76,48 @@ void GroupBlock::moveAllBlocksToGroup() {
     for (BlockInterface* block: blocksOnThisLevel) {
         block->setGuiX(block->getGuiX() + xOffset);
         block->setGuiY(block->getGuiY() + yOffset);
-        m_controller->blockManager()->setGroupOfBlock(block, group);
     }
+    m_controller->blockManager()->setGroupOfBlocks(blocksOnThisLevel, group);
 }
 
 void GroupBlock::findConnectedBlocks(BlockInterface* block, QSet<BlockInterface*>& connectedBlocks) {
-    for (QPointer<NodeBase>& node: block->getNodes()) {
-        if (node.isNull()) continue;
-        for (const QPointer<NodeBase>& otherNode: node->getConnectedNodes()) {
-            if (otherNode.isNull()) continue;
-            BlockInterface* otherBlock = otherNode->getBlock();
-            if (!otherBlock) continue;
-            if (!connectedBlocks.contains(otherBlock)) {
-                connectedBlocks.insert(otherBlock);
-                findConnectedBlocks(otherBlock, connectedBlocks);
+    for (BlockInterface* connectedBlock: m_controller->blockManager()->getConnectedBlocks(block)) {
+        connectedBlocks.insert(connectedBlock);
+    }
+}
+
+QVariantMap GroupBlock::getSummary() const {
+    int blockCount = 0;
+    int activeOutputs = 0;
+    int suspendedBlocks = 0;
+    int pendingInputs = 0;
+
+    QStringList groups = {getUid()};
+    while (!groups.isEmpty()) {
+        const QString group = groups.takeLast();
+        for (BlockInterface* block: m_controller->blockManager()->getBlocksInGroup(group)) {
+            ++blockCount;
+            if (block->isSuspended()) ++suspendedBlocks;
+            if (qobject_cast<GroupBlock*>(block)) groups.append(block->getUid());
+            for (const QPointer<NodeBase>& node: block->getNodes()) {
+                if (!node) continue;
+                if (node->isOutput()) {
+                    if (node->isActive() && node->isConnected()) ++activeOutputs;
+                } else if (node->hasPendingData()) {
+                    ++pendingInputs;
+                }
             }
         }
     }
+
+    QVariantMap summary;
+    summary["blockCount"] = blockCount;
+    summary["activeOutputs"] = activeOutputs;
+    summary["suspendedBlocks"] = suspendedBlocks;
+    summary["pendingInputs"] = pendingInputs;
+    summary["active"] = activeOutputs > 0;
+    summary["dirty"] = pendingInputs > 0;
+    return summary;
 }
 
 void GroupBlock::onRemove() {
@@ -112,12 +129,10 @@ void GroupBlock::onRemove() {
     double xOffset = workspace->x() - m_groupPosX;
     double yOffset = workspace->y() - m_groupPosY;
 
-    for (QPointer<BlockInterface> block: m_controller->blockManager()->getCurrentBlocks()) {
-        if (block.isNull()) continue;
-        if (block->getGroup() == group) {
-            block->setGuiX(block->getGuiX() - xOffset);
-            block->setGuiY(block->getGuiY() - yOffset);
-            m_controller->blockManager()->setGroupOfBlock(block, parentGroup);
-        }
+    const QVector<BlockInterface*> memberBlocks = m_controller->blockManager()->getBlocksInGroup(group);
+    for (BlockInterface* block: memberBlocks) {
+        block->setGuiX(block->getGuiX() - xOffset);
+        block->setGuiY(block->getGuiY() - yOffset);
     }
+    m_controller->blockManager()->setGroupOfBlocks(memberBlocks, parentGroup);
 }
@@ -3,6 +3,8 @@
 
 #include "core/block_basics/BlockBase.h"
 
+#include <QVariantMap>
+
 
 class GroupBlock: public BlockBase
 {
@@ -42,13 +44,21 @@ public slots:
 
     void findConnectedBlocks(BlockInterface* block, QSet<BlockInterface*>& connectedBlocks);
 
+    /**
+     * @brief getSummary returns the state of all blocks in this group and its subgroups
+     * @return map with "blockCount", "activeOutputs" (outputs with an active input connected),
+     * "suspendedBlocks", "pendingInputs" (suspended inputs whose data changed),
+     * "active" (at least one active output) and "dirty" (at least one pending input)
+     */
+    QVariantMap getSummary() const;
+
     virtual void onRemove() override;
 
 protected:
-    DoubleAttribute m_parentPosX;
-    DoubleAttribute m_parentPosY;
-    DoubleAttribute m_groupPosX;
-    DoubleAttribute m_groupPosY;
+    CompactDoubleAttribute m_parentPosX;
+    CompactDoubleAttribute m_parentPosY;
+    CompactDoubleAttribute m_groupPosX;
+    CompactDoubleAttribute m_groupPosY;
 };
 
 #endif // GROUPBLOCK_H
@@ -2,6 +2,7 @@
 
 #include <QDebug>
 #include <cmath>
+#include <algorithm>
 
 // ---------------------------- HSV ----------------------------
 
@@ -10,7 +11,7 @@ HsvMatrix::HsvMatrix()
 { }
 
 HsvMatrix::HsvMatrix(int width, int height)
-    : m_data(qMax(1, width), QVector<HSV>(qMax(1, height)))
+    : m_data(qMax(1, width) * qMax(1, height))
     , m_width(qMax(1, width))
     , m_height(qMax(1, height))
 {
@@ -32,24 +33,26 @@ void HsvMatrix::rescale(int width, int height) {
     width = qMax(1, width);
     height = qMax(1, height);
 
-    // change width:
-    m_data.resize(width);
-
-    // for all columns:
-    for (int x = 0; x < width; ++x) {
-        // change height:
-        m_data[x].resize(height);
+    if (height == m_height) {
+        // columns are stored one after another, existing columns stay in place:
+        m_data.resize(width * height);
+    } else {
+        // the position of each value changes, copy the overlapping part:
+        QVector<HSV> data(width * height);
+        const int minWidth = qMin(m_width, width);
+        const int minHeight = qMin(m_height, height);
+        for (int x = 0; x < minWidth; ++x) {
+            std::copy_n(m_data.constBegin() + x * m_height, minHeight, data.begin() + x * height);
+        }
+        m_data = std::move(data);
     }
     m_width = width;
     m_height = height;
 
     // postcondition check because this operation
-    if (m_width < 1 || m_height < 1 || m_data.size() != m_width || m_data[0].size() != m_height) {
-        if (m_data.size() < 1) {
-            qCritical() << "Matrix resize failed.";
-        }
+    if (m_data.size() != m_width * m_height) {
         qCritical() << "Matrix resize failed (target: " << width << "x" << height
-                    << ", actual:" << m_data.size() << "x" << m_data[0].size() << ")";
+                    << ", actual size:" << m_data.size() << ")";
     }
 }
 
@@ -70,7 +73,7 @@ void HsvMatrix::setFrom(const HsvMatrix& other) {
     int minHeight = qMin(m_height, other.m_height);
     for (int x=0; x<minWidth; ++x) {
         for (int y=0; y<minHeight; ++y) {
-            m_data[x][y] = other.m_data[x][y];
+            m_data[x * m_height + y] = other.m_data[x * other.m_height + y];
         }
     }
 }
@@ -78,7 +81,7 @@ void HsvMatrix::setFrom(const HsvMatrix& other) {
 void HsvMatrix::fadeTo(const HsvMatrix& other, double pos) {
     for (int x=0; x < m_width; ++x) {
         for (int y=0; y < m_height; ++y) {
-            HSV& col = m_data[x][y];
+            HSV& col = m_data[x * m_height + y];
             const HSV& colOther = other.at(x, y);
             col.h = col.h * (1 - pos) + colOther.h * pos;
             col.s = col.s * (1 - pos) + colOther.s * pos;
@@ -94,7 +97,7 @@ RgbMatrix::RgbMatrix()
 { }
 
 RgbMatrix::RgbMatrix(int width, int height)
-    : m_data(qMax(1, width), QVector<RGB>(qMax(1, height)))
+    : m_data(qMax(1, width) * qMax(1, height))
     , m_width(qMax(1, width))
     , m_height(qMax(1, height))
 {
@@ -116,24 +119,26 @@ void RgbMatrix::rescale(int width, int height) {
     width = qMax(1, width);
     height = qMax(1, height);
 
-    // change width:
-    m_data.resize(width);
-
-    // for all columns:
-    for (int x = 0; x < width; ++x) {
-        // change height:
-        m_data[x].resize(height);
+    if (height == m_height) {
+        // columns are stored one after another, existing columns stay in place:
+        m_data.resize(width * height);
+    } else {
+        // the position of each value changes, copy the overlapping part:
+        QVector<RGB> data(width * height);
+        const int minWidth = qMin(m_width, width);
+        const int minHeight = qMin(m_height, height);
+        for (int x = 0; x < minWidth; ++x) {
+            std::copy_n(m_data.constBegin() + x * m_height, minHeight, data.begin() + x * height);
+        }
+        m_data = std::move(data);
     }
     m_width = width;
     m_height = height;
 
     // postcondition check because this operation
-    if (m_width < 1 || m_height < 1 || m_data.size() != m_width || m_data[0].size() != m_height) {
-        if (m_data.size() < 1) {
-            qCritical() << "Matrix resize failed.";
-        }
+    if (m_data.size() != m_width * m_height) {
         qCritical() << "Matrix resize failed (target: " << width << "x" << height
-                    << ", actual:" << m_data.size() << "x" << m_data[0].size() << ")";
+                    << ", actual size:" << m_data.size() << ")";
     }
 }
 
@@ -154,7 +159,7 @@ void RgbMatrix::setFrom(const RgbMatrix& other) {
     int minHeight = qMin(m_height, other.m_height);
     for (int x=0; x<minWidth; ++x) {
         for (int y=0; y<minHeight; ++y) {
-            m_data[x][y] = other.m_data[x][y];
+            m_data[x * m_height + y] = other.m_data[x * other.m_height + y];
         }
     }
 }
@@ -164,20 +169,26 @@ void RgbMatrix::addHtp(const RgbMatrix& other) {
     int minHeight = qMin(m_height, other.m_height);
     for (int x=0; x<minWidth; ++x) {
         for (int y=0; y<minHeight; ++y) {
-            m_data[x][y].mixHtp(other.m_data[x][y]);
+            m_data[x * m_height + y].mixHtp(other.m_data[x * other.m_height + y]);
         }
     }
 }
 
 QDataStream& operator<<(QDataStream& out, const HsvMatrix& matrix) {
-    out << matrix.m_data;
+    // the stream format is a vector of columns:
+    QVector< QVector<HSV> > columns(matrix.m_width);
+    for (int x = 0; x < matrix.m_width; ++x) {
+        columns[x] = matrix.m_data.mid(x * matrix.m_height, matrix.m_height);
+    }
+    out << columns;
     out << matrix.m_width;
     out << matrix.m_height;
     return out;
 }
 
 QDataStream& operator>>(QDataStream& in, HsvMatrix& matrix) {
-    in >> matrix.m_data;
+    QVector< QVector<HSV> > columns;
+    in >> columns;
     in >> matrix.m_width;
     in >> matrix.m_height;
 
@@ -185,13 +196,11 @@ QDataStream& operator>>(QDataStream& in, HsvMatrix& matrix) {
     matrix.m_width = qMax(matrix.m_width, 1);
     matrix.m_height = qMax(matrix.m_height, 1);
 
-    // change width:
-    matrix.m_data.resize(matrix.m_width);
-
-    // for all columns:
-    for (int x = 0; x < matrix.m_width; ++x) {
-        // change height:
-        matrix.m_data[x].resize(matrix.m_height);
+    matrix.m_data.fill(HSV(), matrix.m_width * matrix.m_height);
+    for (int x = 0; x < qMin(matrix.m_width, columns.size()); ++x) {
+        const QVector<HSV>& column = columns[x];
+        std::copy_n(column.constBegin(), qMin(matrix.m_height, column.size()),
+                    matrix.m_data.begin() + x * matrix.m_height);
     }
 
     return in;
@@ -118,8 +118,8 @@ public:
 
     // ---- Getter + Setter:
 
-    HSV& at(int x, int y) { return m_data[abs(x % m_width)][abs(y % m_height)]; }
-    const HSV& at(int x, int y) const { return m_data[abs(x % m_width)][abs(y % m_height)]; }
+    HSV& at(int x, int y) { return m_data[abs(x % m_width) * m_height + abs(y % m_height)]; }
+    const HSV& at(int x, int y) const { return m_data[abs(x % m_width) * m_height + abs(y % m_height)]; }
 
     void setFrom(const HsvMatrix& other);
 
@@ -137,7 +137,7 @@ public:
 
 
 protected:
-    QVector< QVector< HSV > > m_data;
+    QVector< HSV > m_data;  //!< all columns in one contiguous buffer, index is x * height + y
     int m_width;
     int m_height;
 };
@@ -174,8 +174,8 @@ public:
 
     // ---- Getter + Setter:
 
-    RGB& at(int x, int y) { return m_data[abs(x % m_width)][abs(y % m_height)]; }
-    const RGB& at(int x, int y) const { return m_data[abs(x % m_width)][abs(y % m_height)]; }
+    RGB& at(int x, int y) { return m_data[abs(x % m_width) * m_height + abs(y % m_height)]; }
+    const RGB& at(int x, int y) const { return m_data[abs(x % m_width) * m_height + abs(y % m_height)]; }
 
     void setFrom(const RgbMatrix& other);
     void addHtp(const RgbMatrix& other);
@@ -189,7 +189,7 @@ public:
 
 
 protected:
-    QVector< QVector< RGB > > m_data;
+    QVector< RGB > m_data;  //!< all columns in one contiguous buffer, index is x * height + y
     int m_width;
     int m_height;
 };
@@ -3,6 +3,8 @@
 #include "core/block_basics/BlockInterface.h"
 #include "core/block_basics/ConnectionCycleBlock.h"
 #include "core/helpers/constants.h"
+#include "core/helpers/SlabAllocator.h"
+#include "core/manager/BlockManager.h"
 
 // ------------------------ NodeBase -----------------------------------------------------------
 
@@ -22,6 +24,8 @@ NodeBase::NodeBase(BlockInterface* block, int index, bool isOutput)
     , m_isActive(true)
     , m_htp(false)
     , m_impulseActive(false)
+    , m_suspended(false)
+    , m_hasPendingData(false)
     , m_requestedSize(1, 1)
     , m_data()
 {
@@ -31,6 +35,19 @@ NodeBase::NodeBase(BlockInterface* block, int index, bool isOutput)
     connect(block, SIGNAL(positionChanged()), this, SLOT(updateConnectionLines()));
 }
 
+void* NodeBase::operator new(std::size_t size) {
+    return allocator().allocate(size);
+}
+
+void NodeBase::operator delete(void* ptr, std::size_t size) {
+    allocator().deallocate(ptr, size);
+}
+
+SlabAllocator& NodeBase::allocator() {
+    static SlabAllocator nodeAllocator("Nodes");
+    return nodeAllocator;
+}
+
 
 // --------------------------- Logic ----------------------------------
 
@@ -98,6 +115,7 @@ void NodeBase::connectTo(NodeBase* otherNode) {
 
     outputNode->m_connectedNodes.append(inputNode);
     inputNode->m_connectedNodes.append(outputNode);
+    m_block->getController()->blockManager()->onBlocksConnected(outputNode->m_block, inputNode->m_block);
     // TODO: create Bezier Curve
 
     outputNode->updateRequestedSize();
@@ -149,6 +167,8 @@ void NodeBase::disconnectFrom(NodeBase* otherNode) {
 
     outputNode->m_connectedNodes.removeOne(inputNode);
     inputNode->m_connectedNodes.removeOne(outputNode);
+    // the component of the blocks may be split now:
+    m_block->getController()->blockManager()->onBlocksDisconnected(outputNode->m_block, inputNode->m_block);
 
     // check if requested Size changed in output node because of disconnect:
     outputNode->updateRequestedSize();
@@ -250,6 +270,33 @@ void NodeBase::setActive(bool value) {
     }
 }
 
+void NodeBase::setSuspended(bool value) {
+    if (m_isOutput) {
+        qCritical() << "Method setSuspended() is only available for input nodes.";
+        return;
+    }
+    if (value == m_suspended) return;
+    const bool wasActive = isActive();
+    m_suspended = value;
+
+    if (isActive() != wasActive) {
+        emit isActiveChanged();
+        // outputs that only feed suspended inputs become inactive, too:
+        for (NodeBase* outputNode: m_connectedNodes) {
+            if (!outputNode) continue;
+            outputNode->updateActiveState();
+        }
+    }
+    if (!m_suspended && m_hasPendingData) {
+        m_hasPendingData = false;
+        NodeBase* ltpSource = m_pendingLtpSource;
+        m_pendingLtpSource = nullptr;
+        // the source is only replayed if it is still connected, otherwise all outputs are merged:
+        if (ltpSource && !m_connectedNodes.contains(ltpSource)) ltpSource = nullptr;
+        updateData(ltpSource);
+    }
+}
+
 void NodeBase::setRequestedSize(Size value) {
     if (m_isOutput) {
         qCritical() << "Method setRequestedSize() is only available for input nodes.";
@@ -463,6 +510,12 @@ void NodeBase::updateData(NodeBase* ltpSource) {
         qCritical() << "Method updateData() is only available for input nodes.";
         return;
     }
+    if (m_suspended) {
+        // merge the data only once when this node is resumed:
+        m_hasPendingData = true;
+        m_pendingLtpSource = ltpSource;
+        return;
+    }
 
     if (m_htp || !ltpSource) {
         bool isFirst = true;
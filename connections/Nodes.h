@@ -17,6 +17,7 @@
 
 // Forward declaration to reduce dependencies
 class BlockInterface;
+class SlabAllocator;
 
 
 /**
@@ -41,6 +42,19 @@ public:
      */
     explicit NodeBase(BlockInterface* block, int index, bool isOutput);
 
+    /**
+     * @brief operator new allocates nodes (including their data) from a slab allocator
+     * to avoid a heap allocation per node when loading or deleting many blocks
+     */
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
+    /**
+     * @brief allocator returns the slab allocator all nodes are created with
+     * @return the allocator, i.e. to release its empty slabs or get statistics
+     */
+    static SlabAllocator& allocator();
+
 signals:
     // ------------ signals for Block:
     /**
@@ -222,6 +236,16 @@ public slots:
      * @return true, if HTP merging is used, false if LTP is used
      */
     bool getHtpMode() const { return m_htp; }
+    /**
+     * @brief isSuspended returns if this Node ignores data changes at the moment (Input Node only)
+     * @return true if suspended
+     */
+    bool isSuspended() const { return m_suspended; }
+    /**
+     * @brief hasPendingData returns if the data of a connected output changed while suspended (Input Node only)
+     * @return true if the data is outdated
+     */
+    bool hasPendingData() const { return m_hasPendingData; }
 
     // ------------------------- Setter of Input Node --------------------------
     /**
@@ -243,6 +267,15 @@ public slots:
      * @brief toggleHtpMode toggle the merging mode (Input Node only)
      */
     void toggleHtpMode() { setHtpMode(!m_htp); }
+    /**
+     * @brief setSuspended suspends or resumes this Node (Input Node only)
+     *
+     * A suspended Node is not active and doesn't merge data or emit dataChanged().
+     * When it is resumed, the data is updated once if it changed in the meantime,
+     * in LTP mode from the output that changed last.
+     * @param value true to suspend, false to resume
+     */
+    void setSuspended(bool value);
 
     /**
      * @brief enableImpulseDetection enables the impulse mode where impulseBegin and impulseEnd
@@ -258,7 +291,7 @@ public slots:
      * @brief isActive returns if this Node is in active state (Output Node only)
      * @return true if it is active
      */
-    bool isActive() const { return m_isActive; }
+    bool isActive() const { return m_isActive && !m_suspended; }
     /**
      * @brief data returns a writable reference to the ColorMatrix object of this Node;
      * after modifying it, dataWasModifiedByBlock() should be called; (Output Node only)
@@ -397,6 +430,9 @@ protected:
     bool m_isActive;  //!< true if this Node is in active state
     bool m_htp;  //!< true if this Node uses HTP merging, false if LTP
     bool m_impulseActive;  //!< true if value is above threshold and impulseBegin was sent (only in impulse mode)
+    bool m_suspended;  //!< true if this Node ignores data changes (Input Node only)
+    bool m_hasPendingData;  //!< true if data changed while this Node was suspended
+    QPointer<NodeBase> m_pendingLtpSource;  //!< output that changed last while this Node was suspended
     QTimer m_impulseTimer;  //!< used for sendImpulse() to set the value back to 0.0 after a short time
 
     // data:
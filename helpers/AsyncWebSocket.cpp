@@ -1,11 +1,27 @@
 #include "AsyncWebSocket.h"
 
+#include <QDebug>
+
+
+// create a shorter alias for the constants namespace:
+namespace AWSC = AsyncWebSocketConstants;
 
 AsyncWebSocket::AsyncWebSocket()
     : m_socket()
     , m_thread(nullptr)
+    , m_producerThread(QThread::currentThread())
+    , m_sendQueue(AWSC::sendQueueCapacity)
+    , m_drainScheduled(false)
+    , m_unsentBytes(0)
+    , m_congested(false)
 {
     qRegisterMetaType<QAbstractSocket::SocketState>("QAbstractSocket::SocketState");
+    connect(&m_socket, &QWebSocket::bytesWritten,
+            this, &AsyncWebSocket::onBytesWritten);
+    connect(&m_socket, &QWebSocket::connected,
+            this, &AsyncWebSocket::resetCongestion);
+    connect(&m_socket, &QWebSocket::disconnected,
+            this, &AsyncWebSocket::resetCongestion);
 #ifdef THREADS_ENABLED
     m_thread = new QThread();
     this->moveToThread(m_thread);
@@ -26,12 +42,21 @@ AsyncWebSocket::AsyncWebSocket()
 }
 
 qint64 AsyncWebSocket::sendBinaryMessage(const QByteArray& data) {
-    qint64 bytesSent = 0;
-    QMetaObject::invokeMethod(this,
-                              "sendBinaryMessageInThread",
-                              Qt::QueuedConnection,
-                              Q_ARG(const QByteArray&, data));
-    return bytesSent;
+    if (QThread::currentThread() != m_producerThread) {
+        qCritical() << "AsyncWebSocket: sendBinaryMessage() called from another thread, message dropped.";
+        return -1;
+    }
+    QByteArray message = data;
+    const qint64 size = message.size();
+    if (!m_sendQueue.push(message)) {
+        qWarning() << "AsyncWebSocket: Send queue is full, message dropped.";
+        return -1;
+    }
+    // the socket thread is only woken up if it isn't already going to drain the queue:
+    if (!m_drainScheduled.exchange(true)) {
+        QMetaObject::invokeMethod(this, "drainSendQueue", Qt::QueuedConnection);
+    }
+    return size;
 }
 
 void AsyncWebSocket::open(const QUrl& url) {
@@ -47,6 +72,33 @@ void AsyncWebSocket::close() {
                               Qt::QueuedConnection);
 }
 
-void AsyncWebSocket::sendBinaryMessageInThread(const QByteArray& data) {
-    m_socket.sendBinaryMessage(data);
+void AsyncWebSocket::drainSendQueue() {
+    // reset before draining, messages queued in the meantime schedule another call:
+    m_drainScheduled.store(false);
+    // all messages are written to the socket buffer now and sent together
+    // when control returns to the event loop:
+    QByteArray data;
+    while (m_sendQueue.pop(data)) {
+        // only messages accepted by the socket are written later and reported by bytesWritten,
+        // nothing is accepted while it is not connected:
+        const qint64 acceptedBytes = m_socket.sendBinaryMessage(data);
+        if (acceptedBytes <= 0) continue;
+        if (m_unsentBytes.fetch_add(acceptedBytes) + acceptedBytes > AWSC::highWaterMarkBytes) {
+            m_congested.store(true);
+        }
+    }
+}
+
+void AsyncWebSocket::onBytesWritten(qint64 bytes) {
+    // the written bytes include the frame headers, the counter must not become negative:
+    qint64 current = m_unsentBytes.load();
+    while (!m_unsentBytes.compare_exchange_weak(current, qMax<qint64>(0, current - bytes))) {}
+    if (current - bytes < AWSC::lowWaterMarkBytes) {
+        m_congested.store(false);
+    }
+}
+
+void AsyncWebSocket::resetCongestion() {
+    m_unsentBytes.store(0);
+    m_congested.store(false);
 }
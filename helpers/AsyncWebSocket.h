@@ -1,14 +1,43 @@
 #ifndef ASYNCWEBSOCKET_H
 #define ASYNCWEBSOCKET_H
 
+#include "core/helpers/SpscRingBuffer.h"
+
 #include <QObject>
 #include <QWebSocket>
-
-#ifdef THREADS_ENABLED
 #include <QThread>
-#endif
+
+#include <atomic>
+
+
+/**
+ * @brief The AsyncWebSocketConstants namespace contains all constants used in AsyncWebSocket.
+ */
+namespace AsyncWebSocketConstants {
+    /**
+     * @brief sendQueueCapacity is the maximum number of messages waiting to be passed to the socket
+     */
+    static const int sendQueueCapacity = 4096;
+    /**
+     * @brief highWaterMarkBytes is the amount of unsent bytes above which the socket is congested
+     */
+    static const qint64 highWaterMarkBytes = 8 * 1024 * 1024;
+    /**
+     * @brief lowWaterMarkBytes is the amount of unsent bytes below which the socket is not congested anymore
+     */
+    static const qint64 lowWaterMarkBytes = 2 * 1024 * 1024;
+}
 
 
+/**
+ * @brief The AsyncWebSocket class is a websocket client that runs in its own thread.
+ *
+ * Messages are passed to the socket thread through a lock-free queue instead of a queued
+ * signal per message. The socket thread is only woken up if it is not already sending,
+ * all messages queued until then are written to the socket together.
+ * The queue has a single producer: sendBinaryMessage() must be called from the thread
+ * that created this object (WebsocketConnection forwards calls from other threads to it).
+ */
 class AsyncWebSocket : public QObject {
 
     Q_OBJECT
@@ -18,8 +47,23 @@ public:
 
     QWebSocket& socket() { return m_socket; }
 
+    /**
+     * @brief sendBinaryMessage queues a message to be sent in the socket thread
+     * (must be called from the thread that created this object)
+     * @param data the message
+     * @return the size of the message or -1 if the queue is full or it was called
+     * from another thread and the message was dropped
+     */
     qint64 sendBinaryMessage(const QByteArray& data);
 
+    /**
+     * @brief isCongested returns true if more than highWaterMarkBytes were passed to the socket
+     * and are not written yet, senders should hold back messages in this case
+     * (it is reset when the connection is established or lost)
+     * @return true if congested
+     */
+    bool isCongested() const { return m_congested.load(std::memory_order_relaxed); }
+
     void open(const QUrl &url);
     void close();
 
@@ -29,7 +73,18 @@ signals:
     void binaryMessageReceived(QByteArray data);
 
 private slots:
-    void sendBinaryMessageInThread(const QByteArray& data);
+    /**
+     * @brief drainSendQueue passes all queued messages to the socket (called in the socket thread)
+     */
+    void drainSendQueue();
+
+    void onBytesWritten(qint64 bytes);
+
+    /**
+     * @brief resetCongestion resets the unsent bytes, called when the connection state changes
+     * because the data of the previous connection will never be written
+     */
+    void resetCongestion();
 
 protected:
     QWebSocket m_socket;
@@ -38,6 +93,27 @@ protected:
 #else
     void* m_thread;
 #endif
+    /**
+     * @brief m_producerThread is the only thread allowed to push to m_sendQueue
+     */
+    QThread* const m_producerThread;
+
+    /**
+     * @brief m_sendQueue contains the messages not yet passed to the socket
+     */
+    SpscRingBuffer<QByteArray> m_sendQueue;
+
+    /**
+     * @brief m_drainScheduled is true if drainSendQueue() will be called
+     */
+    std::atomic<bool> m_drainScheduled;
+
+    /**
+     * @brief m_unsentBytes is the size of the messages accepted by the socket but not yet written
+     */
+    std::atomic<qint64> m_unsentBytes;
+
+    std::atomic<bool> m_congested;
 
 };
 
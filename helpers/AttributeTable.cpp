@@ -0,0 +1,243 @@
+#include "AttributeTable.h"
+
+#include "core/helpers/ObjectWithAttributes.h"
+#include "core/helpers/utils.h"
+
+#include <QQmlEngine>
+#include <QHash>
+#include <QDebug>
+
+#include <cmath>
+
+
+namespace {
+
+// interned attribute names, only used from the main thread like all attributes:
+QHash<QString, int>& nameIds() {
+    static QHash<QString, int> ids;
+    return ids;
+}
+
+QVector<QString>& names() {
+    static QVector<QString> list;
+    return list;
+}
+
+}  // namespace
+
+
+// ------------------------ AttributeProxy ------------------------
+
+AttributeProxy::AttributeProxy(AttributeTable* table, int index, QObject* parent)
+    : QObject(parent)
+    , m_table(table)
+    , m_index(index)
+{
+
+}
+
+QString AttributeProxy::name() const {
+    return m_table->name(m_index);
+}
+
+bool AttributeProxy::persistent() const {
+    return m_table->isPersistent(m_index);
+}
+
+QVariant AttributeProxy::getValue() const {
+    return m_table->valueAsVariant(m_index);
+}
+
+void AttributeProxy::setValue(const QVariant& value) {
+    m_table->setValue(m_index, value.toDouble());
+}
+
+double AttributeProxy::getMin() const {
+    return m_table->min(m_index);
+}
+
+double AttributeProxy::getMax() const {
+    return m_table->max(m_index);
+}
+
+
+// ------------------------ AttributeTable ------------------------
+
+AttributeTable::AttributeTable(QObject* owner)
+    : m_owner(owner)
+    , m_notifier(nullptr)
+{
+
+}
+
+AttributeTable::~AttributeTable() {
+    // they are children of the owner but reference this table, which is deleted first:
+    qDeleteAll(m_proxies);
+    delete m_notifier;
+}
+
+int AttributeTable::internName(const QString& name) {
+    auto it = nameIds().constFind(name);
+    if (it != nameIds().constEnd()) return it.value();
+    const int id = names().size();
+    names().append(name);
+    nameIds().insert(name, id);
+    return id;
+}
+
+int AttributeTable::findName(const QString& name) {
+    return nameIds().value(name, -1);
+}
+
+QString AttributeTable::nameOf(int nameId) {
+    return names().value(nameId);
+}
+
+int AttributeTable::add(const QString& name, Type type, double initialValue, double min, double max, bool persistent) {
+    const int nameId = internName(name);
+    if (indexOf(nameId) >= 0) {
+        qWarning() << "Attribute" << name << "exists already.";
+    } else {
+        m_indexByNameId.insert(nameId, m_rows.size());
+    }
+    if (type == Type::Bool) initialValue = initialValue != 0.0 ? 1.0 : 0.0;
+    m_rows.append(Row{nameId, type, persistent, min, max});
+    m_values.append(initialValue);
+    if (!m_proxies.isEmpty()) m_proxies.append(nullptr);
+    return m_values.size() - 1;
+}
+
+int AttributeTable::persistentIndexForKey(const QString& key) const {
+    const int nameId = findName(key);
+    if (nameId < 0) return -1;
+    const int index = indexOf(nameId);
+    if (index < 0 || !m_rows[index].persistent) return -1;
+    return index;
+}
+
+void AttributeTable::setValue(int index, double value) {
+    const Row& row = m_rows[index];
+    switch (row.type) {
+    case Type::Double:
+        value = limit(row.min, value, row.max);
+        break;
+    case Type::Integer:
+        value = limit(row.min, std::trunc(value), row.max);
+        break;
+    case Type::Bool:
+        value = value != 0.0 ? 1.0 : 0.0;
+        break;
+    }
+    if (value == m_values[index]) return;
+    m_values[index] = value;
+    if (m_notifier) emit m_notifier->valueChanged(index);
+    if (index < m_proxies.size() && m_proxies[index]) emit m_proxies[index]->valueChanged();
+}
+
+void AttributeTable::setRange(int index, double min, double max) {
+    m_rows[index].min = min;
+    m_rows[index].max = max;
+    if (index < m_proxies.size() && m_proxies[index]) emit m_proxies[index]->rangeChanged();
+}
+
+QVariant AttributeTable::valueAsVariant(int index) const {
+    switch (m_rows[index].type) {
+    case Type::Integer:
+        return int(m_values[index]);
+    case Type::Bool:
+        return m_values[index] != 0.0;
+    default:
+        return m_values[index];
+    }
+}
+
+AttributeNotifier* AttributeTable::notifier() {
+    if (!m_notifier) {
+        m_notifier = new AttributeNotifier(m_owner);
+    }
+    return m_notifier;
+}
+
+AttributeProxy* AttributeTable::proxy(int index) {
+    if (m_proxies.isEmpty()) m_proxies.fill(nullptr, m_values.size());
+    if (!m_proxies[index]) {
+        AttributeProxy* proxy = new AttributeProxy(this, index, m_owner);
+        QQmlEngine::setObjectOwnership(proxy, QQmlEngine::CppOwnership);
+        m_proxies[index] = proxy;
+    }
+    return m_proxies[index];
+}
+
+void AttributeTable::writeTo(QCborMap& state) const {
+    for (int i = 0; i < m_values.size(); ++i) {
+        if (!m_rows[i].persistent) continue;
+        switch (m_rows[i].type) {
+        case Type::Double:
+            state[name(i)] = m_values[i];
+            break;
+        case Type::Integer:
+            state[name(i)] = qint64(m_values[i]);
+            break;
+        case Type::Bool:
+            state[name(i)] = m_values[i] != 0.0;
+            break;
+        }
+    }
+}
+
+void AttributeTable::writeTo(QCborStreamWriter& writer) const {
+    for (int i = 0; i < m_values.size(); ++i) {
+        if (!m_rows[i].persistent) continue;
+        const QString key = name(i);
+        writer.append(QStringView(key));
+        switch (m_rows[i].type) {
+        case Type::Double:
+            writer.append(m_values[i]);
+            break;
+        case Type::Integer:
+            writer.append(qint64(m_values[i]));
+            break;
+        case Type::Bool:
+            writer.append(m_values[i] != 0.0);
+            break;
+        }
+    }
+}
+
+void AttributeTable::readFrom(const QCborMap& state) {
+    for (int i = 0; i < m_values.size(); ++i) {
+        if (!m_rows[i].persistent) continue;
+        setValue(i, valueFromCbor(i, state[name(i)]));
+    }
+}
+
+void AttributeTable::readFrom(int index, QCborStreamReader& reader) {
+    setValue(index, valueFromCbor(index, QCborValue::fromCbor(reader)));
+}
+
+void AttributeTable::resetToMissingState(int index) {
+    setValue(index, valueFromCbor(index, QCborValue()));
+}
+
+double AttributeTable::valueFromCbor(int index, const QCborValue& value) const {
+    // the same conversions as in the SmartAttribute classes:
+    switch (m_rows[index].type) {
+    case Type::Integer:
+        return double(int(value.toInteger()));
+    case Type::Bool:
+        return value.toBool() ? 1.0 : 0.0;
+    default:
+        return value.toDouble();
+    }
+}
+
+
+// ------------------------ CompactAttribute ------------------------
+
+CompactAttribute::CompactAttribute(ObjectWithAttributes* owner, const QString& name, AttributeTable::Type type,
+                                   double initialValue, double min, double max, bool persistent)
+    : m_table(owner->attributeTable())
+    , m_index(m_table.add(name, type, initialValue, min, max, persistent))
+{
+
+}
@@ -0,0 +1,307 @@
+#ifndef ATTRIBUTETABLE_H
+#define ATTRIBUTETABLE_H
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QVariant>
+#include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+
+// forward declaration to reduce dependencies
+class ObjectWithAttributes;
+class AttributeTable;
+
+
+/**
+ * @brief The AttributeNotifier class emits the change notifications of all values in an AttributeTable.
+ */
+class AttributeNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AttributeNotifier(QObject* parent) : QObject(parent) {}
+
+signals:
+    /**
+     * @brief valueChanged is emitted when a value changed
+     * @param index the index of the value in the table
+     */
+    void valueChanged(int index);
+};
+
+
+/**
+ * @brief The AttributeProxy class makes a single value of an AttributeTable available in QML
+ * with the same properties as a SmartAttribute (val, min, max).
+ */
+class AttributeProxy : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(QVariant val READ getValue WRITE setValue NOTIFY valueChanged)
+    Q_PROPERTY(double min READ getMin NOTIFY rangeChanged)
+    Q_PROPERTY(double max READ getMax NOTIFY rangeChanged)
+
+public:
+    explicit AttributeProxy(AttributeTable* table, int index, QObject* parent);
+
+signals:
+    void valueChanged();
+    void rangeChanged();
+
+public slots:
+    QString name() const;
+    bool persistent() const;
+
+    QVariant getValue() const;
+    void setValue(const QVariant& value);
+
+    double getMin() const;
+    double getMax() const;
+
+protected:
+    AttributeTable* const m_table;
+    const int m_index;
+};
+
+
+/**
+ * @brief The AttributeTable class stores numeric attributes of an object in contiguous arrays.
+ *
+ * In contrast to a SmartAttribute, a value in this table is not a QObject.
+ * Names are interned and stored as integer IDs. A single AttributeNotifier
+ * is created when the first change listener is added and an AttributeProxy
+ * for QML is only created when the GUI requests the attribute by attr().
+ *
+ * Values are accessed through CompactDoubleAttribute, CompactIntegerAttribute
+ * and CompactBoolAttribute handles.
+ */
+class AttributeTable {
+
+    Q_DISABLE_COPY(AttributeTable)
+
+public:
+    enum class Type : quint8 { Double, Integer, Bool };
+
+    /**
+     * @brief AttributeTable creates an empty table
+     * @param owner the object the attributes belong to, parent of the notifier and proxies
+     */
+    explicit AttributeTable(QObject* owner);
+    ~AttributeTable();
+
+    // ------------------ Interned Names -------------------
+
+    /**
+     * @brief internName returns the ID of an attribute name, it is added if it doesn't exist yet
+     * @param name attribute name
+     * @return ID of the name
+     */
+    static int internName(const QString& name);
+
+    /**
+     * @brief findName returns the ID of an attribute name without adding it
+     * @param name attribute name
+     * @return ID of the name or -1 if no attribute has this name
+     */
+    static int findName(const QString& name);
+
+    /**
+     * @brief nameOf returns the name with the given ID,
+     * all copies share the same string data
+     * @param nameId ID returned by internName()
+     * @return the name
+     */
+    static QString nameOf(int nameId);
+
+    // ------------------ Values -------------------
+
+    /**
+     * @brief add adds a value to the table
+     * @return index of the value
+     */
+    int add(const QString& name, Type type, double initialValue, double min, double max, bool persistent);
+
+    int size() const { return m_values.size(); }
+
+    /**
+     * @brief indexOf returns the index of a value
+     * @param nameId interned name of the value
+     * @return index or -1 if it doesn't exist
+     */
+    int indexOf(int nameId) const { return m_indexByNameId.value(nameId, -1); }
+
+    /**
+     * @brief persistentIndexForKey returns the index of the persistent value that uses the given key in a state map
+     * @param key a key of a state map
+     * @return index or -1 if no persistent value uses this key
+     */
+    int persistentIndexForKey(const QString& key) const;
+
+    QString name(int index) const { return nameOf(m_rows[index].nameId); }
+    Type type(int index) const { return m_rows[index].type; }
+    bool isPersistent(int index) const { return m_rows[index].persistent; }
+
+    double value(int index) const { return m_values[index]; }
+    void setValue(int index, double value);
+
+    double min(int index) const { return m_rows[index].min; }
+    double max(int index) const { return m_rows[index].max; }
+    void setRange(int index, double min, double max);
+
+    /**
+     * @brief valueAsVariant returns a value with the QVariant type matching its type (double, int or bool)
+     */
+    QVariant valueAsVariant(int index) const;
+
+    // ------------------ Notifications -------------------
+
+    /**
+     * @brief notifier returns the object that emits the change notifications, it is created on first use
+     * @return the notifier, a child of the owner
+     */
+    AttributeNotifier* notifier();
+
+    /**
+     * @brief proxy returns the QML proxy object of a value, it is created on first use
+     * @param index index of the value
+     * @return the proxy, a child of the owner
+     */
+    AttributeProxy* proxy(int index);
+
+    // ------------------ Persistence -------------------
+
+    void writeTo(QCborMap& state) const;
+    /**
+     * @brief writeTo writes all persistent values as key-value pairs directly to a CBOR stream
+     * @param writer the stream writer, positioned inside a map
+     */
+    void writeTo(QCborStreamWriter& writer) const;
+    void readFrom(const QCborMap& state);
+    /**
+     * @brief readFrom reads a single value from a CBOR stream
+     * @param index index of the value
+     * @param reader the stream reader, positioned on the value
+     */
+    void readFrom(int index, QCborStreamReader& reader);
+    /**
+     * @brief resetToMissingState sets a value like it was read from a state that doesn't contain it
+     * (the same as SmartAttribute::readFrom() with an empty map)
+     * @param index index of the value
+     */
+    void resetToMissingState(int index);
+
+protected:
+    /**
+     * @brief The Row struct contains the metadata of a value.
+     */
+    struct Row {
+        int nameId;
+        Type type;
+        bool persistent;
+        double min;
+        double max;
+    };
+
+    double valueFromCbor(int index, const QCborValue& value) const;
+
+    QObject* const m_owner;
+    QVector<double> m_values;  //!< all values in one contiguous array
+    QVector<Row> m_rows;  //!< metadata of each value, same index as in m_values
+    QHash<int, int> m_indexByNameId;  //!< index of each value by its interned name
+    AttributeNotifier* m_notifier;  //!< created on first use
+    QVector<AttributeProxy*> m_proxies;  //!< QML proxy by index, empty until the first proxy is requested
+};
+
+
+/**
+ * @brief The CompactAttribute class is the base of the handles to a value in an AttributeTable.
+ *
+ * A handle is used like a SmartAttribute member, but is only as large as two pointers.
+ * Blocks should use them for numeric values instead of Double-, Integer- and BoolAttribute,
+ * unless the value needs the coalesced notification mode of a SmartAttribute.
+ */
+class CompactAttribute {
+
+    Q_DISABLE_COPY(CompactAttribute)
+
+public:
+    int index() const { return m_index; }
+
+    /**
+     * @brief onChange connects a function to the changes of this value
+     * @param context the function is disconnected when this object is deleted
+     * @param function function without arguments
+     * @return the connection
+     */
+    template<typename Function>
+    QMetaObject::Connection onChange(const QObject* context, Function function) const {
+        const int ownIndex = m_index;
+        return QObject::connect(m_table.notifier(), &AttributeNotifier::valueChanged, context, [ownIndex, function](int index) {
+            if (index == ownIndex) function();
+        });
+    }
+
+protected:
+    CompactAttribute(ObjectWithAttributes* owner, const QString& name, AttributeTable::Type type,
+                     double initialValue, double min, double max, bool persistent);
+
+    AttributeTable& m_table;
+    const int m_index;
+};
+
+
+class CompactDoubleAttribute : public CompactAttribute {
+
+public:
+    explicit CompactDoubleAttribute(ObjectWithAttributes* owner, QString name, double initialValue = 0.0, double min = 0.0, double max = 1.0, bool persistent = true)
+        : CompactAttribute(owner, name, AttributeTable::Type::Double, initialValue, min, max, persistent) {}
+    operator double() const { return getValue(); }
+    CompactDoubleAttribute& operator=(double value) { setValue(value); return *this; }
+
+    double getValue() const { return m_table.value(m_index); }
+    void setValue(double value) { m_table.setValue(m_index, value); }
+
+    double getMin() const { return m_table.min(m_index); }
+    void setMin(double value) { m_table.setRange(m_index, value, getMax()); }
+
+    double getMax() const { return m_table.max(m_index); }
+    void setMax(double value) { m_table.setRange(m_index, getMin(), value); }
+};
+
+
+class CompactIntegerAttribute : public CompactAttribute {
+
+public:
+    explicit CompactIntegerAttribute(ObjectWithAttributes* owner, QString name, int initialValue = 0, int min = 0, int max = 100, bool persistent = true)
+        : CompactAttribute(owner, name, AttributeTable::Type::Integer, initialValue, min, max, persistent) {}
+    operator int() const { return getValue(); }
+    CompactIntegerAttribute& operator=(int value) { setValue(value); return *this; }
+
+    int getValue() const { return int(m_table.value(m_index)); }
+    void setValue(int value) { m_table.setValue(m_index, value); }
+
+    int getMin() const { return int(m_table.min(m_index)); }
+    void setMin(int value) { m_table.setRange(m_index, value, getMax()); }
+
+    int getMax() const { return int(m_table.max(m_index)); }
+    void setMax(int value) { m_table.setRange(m_index, getMin(), value); }
+};
+
+
+class CompactBoolAttribute : public CompactAttribute {
+
+public:
+    explicit CompactBoolAttribute(ObjectWithAttributes* owner, QString name, bool initialValue = false, bool persistent = true)
+        : CompactAttribute(owner, name, AttributeTable::Type::Bool, initialValue, 0, 1, persistent) {}
+    operator bool() const { return getValue(); }
+    CompactBoolAttribute& operator=(bool value) { setValue(value); return *this; }
+
+    bool getValue() const { return m_table.value(m_index) != 0.0; }
+    void setValue(bool value) { m_table.setValue(m_index, value ? 1.0 : 0.0); }
+};
+
+#endif // ATTRIBUTETABLE_H
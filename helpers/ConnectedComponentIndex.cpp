@@ -0,0 +1,97 @@
+#include "ConnectedComponentIndex.h"
+
+#include <QSet>
+
+
+ConnectedComponentIndex::ConnectedComponentIndex()
+{
+
+}
+
+void ConnectedComponentIndex::onConnected(BlockInterface* block, BlockInterface* otherBlock) {
+    if (!block || !otherBlock || block == otherBlock) return;
+    unite(block, otherBlock);
+}
+
+void ConnectedComponentIndex::onDisconnected(BlockInterface* block, BlockInterface* otherBlock, const NeighboursFunction& neighboursOf) {
+    if (!block || !otherBlock || block == otherBlock) return;
+    if (!m_parent.contains(block) || !m_parent.contains(otherBlock)) return;
+    BlockInterface* root = find(block);
+    if (root != find(otherBlock)) return;
+
+    // search all blocks still reachable from one side of the removed connection:
+    QSet<BlockInterface*> reachable {block};
+    QVector<BlockInterface*> side {block};
+    for (int i = 0; i < side.size(); ++i) {
+        for (BlockInterface* neighbour: neighboursOf(side[i])) {
+            if (!neighbour || reachable.contains(neighbour)) continue;
+            // the other side is still connected, the component doesn't change:
+            if (neighbour == otherBlock) return;
+            reachable.insert(neighbour);
+            side.append(neighbour);
+        }
+    }
+
+    // the component is split into the reachable blocks and the rest:
+    const QVector<BlockInterface*> members = m_members.take(root);
+    QVector<BlockInterface*> otherSide;
+    otherSide.reserve(members.size() - side.size());
+    for (BlockInterface* member: members) {
+        m_parent.remove(member);
+        if (!reachable.contains(member)) otherSide.append(member);
+    }
+    setComponent(side);
+    setComponent(otherSide);
+}
+
+QVector<BlockInterface*> ConnectedComponentIndex::componentOf(BlockInterface* block) {
+    if (!m_parent.contains(block)) return {block};
+    return m_members.value(find(block));
+}
+
+void ConnectedComponentIndex::clear() {
+    m_parent.clear();
+    m_members.clear();
+}
+
+BlockInterface* ConnectedComponentIndex::find(BlockInterface* block) {
+    BlockInterface* root = block;
+    while (true) {
+        BlockInterface* parent = m_parent.value(root, root);
+        if (parent == root) break;
+        // path halving:
+        BlockInterface* grandParent = m_parent.value(parent, parent);
+        m_parent[root] = grandParent;
+        root = grandParent;
+    }
+    return root;
+}
+
+void ConnectedComponentIndex::unite(BlockInterface* block, BlockInterface* otherBlock) {
+    if (!m_parent.contains(block)) {
+        m_parent.insert(block, block);
+        m_members.insert(block, {block});
+    }
+    if (!m_parent.contains(otherBlock)) {
+        m_parent.insert(otherBlock, otherBlock);
+        m_members.insert(otherBlock, {otherBlock});
+    }
+    BlockInterface* root = find(block);
+    BlockInterface* otherRoot = find(otherBlock);
+    if (root == otherRoot) return;
+
+    // union by size, the member list of the smaller component is appended to the larger one:
+    if (m_members[root].size() < m_members[otherRoot].size()) std::swap(root, otherRoot);
+    m_parent[otherRoot] = root;
+    m_members[root] += m_members.take(otherRoot);
+}
+
+void ConnectedComponentIndex::setComponent(const QVector<BlockInterface*>& members) {
+    // blocks without connections are not stored:
+    if (members.size() < 2) return;
+    BlockInterface* root = members.first();
+    for (BlockInterface* member: members) {
+        m_parent.insert(member, root);
+    }
+    m_members.insert(root, members);
+}
@@ -0,0 +1,94 @@
+#ifndef CONNECTEDCOMPONENTINDEX_H
+#define CONNECTEDCOMPONENTINDEX_H
+
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+// forward declaration to reduce dependencies
+class BlockInterface;
+
+
+/**
+ * @brief The ConnectedComponentIndex class knows which blocks are connected to each other
+ * directly or indirectly (i.e. to move them to a group together).
+ *
+ * It is a union-find structure over blocks that keeps the member list of each component.
+ * A new connection merges two components in almost constant time.
+ * A removed connection can split a component, which union-find cannot do. In that case
+ * only the affected component is searched again, starting at one of the disconnected blocks.
+ *
+ * Blocks without connections are not stored. The blocks are never dereferenced,
+ * their connections are provided by a NeighboursFunction.
+ */
+class ConnectedComponentIndex {
+
+    Q_DISABLE_COPY(ConnectedComponentIndex)
+
+public:
+    /**
+     * @brief NeighboursFunction returns the blocks that are directly connected to a block
+     */
+    typedef std::function<QVector<BlockInterface*>(BlockInterface*)> NeighboursFunction;
+
+    ConnectedComponentIndex();
+
+    /**
+     * @brief onConnected merges the components of two blocks after they were connected
+     * @param block one of the blocks
+     * @param otherBlock the other block
+     */
+    void onConnected(BlockInterface* block, BlockInterface* otherBlock);
+
+    /**
+     * @brief onDisconnected splits the component of two blocks if they are not connected
+     * anymore after a connection between them was removed
+     * @param block one of the blocks
+     * @param otherBlock the other block
+     * @param neighboursOf returns the current connections of a block
+     */
+    void onDisconnected(BlockInterface* block, BlockInterface* otherBlock, const NeighboursFunction& neighboursOf);
+
+    /**
+     * @brief componentOf returns all blocks that are connected to a block, including the block itself
+     * @param block the block
+     * @return the blocks of the component in no particular order
+     */
+    QVector<BlockInterface*> componentOf(BlockInterface* block);
+
+    /**
+     * @brief contains returns if a block is connected to any other block
+     */
+    bool contains(BlockInterface* block) const { return m_parent.contains(block); }
+
+    /**
+     * @brief clear removes all blocks (i.e. when all blocks are deleted)
+     */
+    void clear();
+
+protected:
+    /**
+     * @brief find returns the representative block of the component of a block
+     * @param block a block in the index
+     * @return the root block
+     */
+    BlockInterface* find(BlockInterface* block);
+
+    /**
+     * @brief unite merges the components of two blocks, the smaller one is added to the larger one
+     */
+    void unite(BlockInterface* block, BlockInterface* otherBlock);
+
+    /**
+     * @brief setComponent replaces the entries of some blocks by a new component,
+     * a single block is removed from the index instead
+     * @param members the blocks of the new component
+     */
+    void setComponent(const QVector<BlockInterface*>& members);
+
+    QHash<BlockInterface*, BlockInterface*> m_parent;  //!< parent of each block in the union-find forest
+    QHash<BlockInterface*, QVector<BlockInterface*>> m_members;  //!< all blocks of a component by its root
+};
+
+#endif // CONNECTEDCOMPONENTINDEX_H
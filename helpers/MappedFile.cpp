@@ -0,0 +1,50 @@
+#include "MappedFile.h"
+
+#include <QDebug>
+
+#include <limits>
+
+
+MappedFile::MappedFile(const QString& path)
+    : m_file(path)
+    , m_valid(false)
+    , m_mappedData(nullptr)
+    , m_size(0)
+{
+    if (path.isEmpty()) return;
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Couldn't open file " + path + ".";
+        return;
+    }
+    m_valid = true;
+    m_size = m_file.size();
+    if (m_size <= 0) return;
+
+    m_mappedData = m_file.map(0, m_size);
+    if (!m_mappedData) {
+        // i.e. resources or sequential devices, read the content instead:
+        m_fallbackContent = m_file.readAll();
+        m_size = m_fallbackContent.size();
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (m_mappedData) {
+        m_file.unmap(m_mappedData);
+    }
+}
+
+const char* MappedFile::data() const {
+    if (m_mappedData) {
+        return reinterpret_cast<const char*>(m_mappedData);
+    }
+    return m_fallbackContent.constData();
+}
+
+QByteArray MappedFile::bytes() const {
+    if (m_size > std::numeric_limits<int>::max()) {
+        qWarning() << "File is too large for a QByteArray: " << m_file.fileName();
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(data(), int(m_size));
+}
@@ -0,0 +1,72 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+
+/**
+ * @brief The MappedFile class provides read-only access to the content of a file
+ * that is memory mapped instead of being copied to the heap.
+ *
+ * The content is only valid as long as the MappedFile object exists, use it through
+ * the QSharedPointer returned by FileSystemManager::mapFile() to keep it alive
+ * while a view on the content is used (i.e. in another thread).
+ * If a file can't be mapped (i.e. a Qt resource), its content is read instead.
+ *
+ * A mapped file must not be truncated or overwritten in place while it is mapped
+ * (accessing the removed part would crash with SIGBUS). FileSystemManager replaces files
+ * instead, the mapping keeps the old content.
+ */
+class MappedFile {
+
+    Q_DISABLE_COPY(MappedFile)
+
+public:
+    /**
+     * @brief MappedFile opens and maps a file
+     * @param path including directory and filename in the local file system
+     * (an empty path creates an invalid object)
+     */
+    explicit MappedFile(const QString& path);
+    ~MappedFile();
+
+    /**
+     * @brief isValid returns true if the file could be opened
+     * @return true if data() can be used
+     */
+    bool isValid() const { return m_valid; }
+
+    /**
+     * @brief data returns a pointer to the content of the file
+     * @return pointer to the first byte, only valid as long as this object exists
+     */
+    const char* data() const;
+
+    /**
+     * @brief size returns the size of the file in bytes
+     * @return number of bytes
+     */
+    qint64 size() const { return m_size; }
+
+    /**
+     * @brief bytes returns a QByteArray that uses the mapped content without copying it
+     * @return a QByteArray that is only valid as long as this object exists
+     * (modifying it creates a deep copy)
+     */
+    QByteArray bytes() const;
+
+protected:
+    QFile m_file;
+    bool m_valid;
+    uchar* m_mappedData;
+    qint64 m_size;
+
+    /**
+     * @brief m_fallbackContent the content of the file if it couldn't be mapped
+     */
+    QByteArray m_fallbackContent;
+};
+
+#endif // MAPPEDFILE_H
@@ -8,21 +8,35 @@
 
 ObjectWithAttributes::ObjectWithAttributes(QObject* parent)
     : m_parent(parent)
+    , m_attributeTable(parent)
 {
 
 }
 
 QObject* ObjectWithAttributes::attr(QString name) {
-    if (!m_attributes.contains(name)) {
-        qWarning() << "Object has no attribute " << name;
+    const int nameId = AttributeTable::findName(name);
+    if (nameId >= 0) {
+        const int index = m_attributeNameIds.indexOf(nameId);
+        if (index >= 0 && m_attributes[index]) return m_attributes[index].data();
+        const int tableIndex = m_attributeTable.indexOf(nameId);
+        if (tableIndex >= 0) return m_attributeTable.proxy(tableIndex);
     }
-    return static_cast<QObject*>(m_attributes.value(name, nullptr));
+    qWarning() << "Object has no attribute " << name;
+    return nullptr;
 }
 
 void ObjectWithAttributes::registerAttribute(SmartAttribute* attr) {
-    m_attributes[attr->name()] = attr;
+    const int nameId = AttributeTable::internName(attr->name());
+    const int index = m_attributeNameIds.indexOf(nameId);
+    if (index >= 0) {
+        m_attributes[index] = attr;
+    } else {
+        m_attributes.append(attr);
+        m_attributeNameIds.append(nameId);
+    }
     if (attr->persistent()) {
         m_persistentAttributes.append(attr);
+        m_persistentAttributeKeys.clear();
     }
 }
 
@@ -31,6 +45,7 @@ void ObjectWithAttributes::writeAttributesTo(QCborMap& state) const {
         if (!attr) continue;
         attr->writeTo(state);
     }
+    m_attributeTable.writeTo(state);
 }
 
 void ObjectWithAttributes::readAttributesFrom(const QCborMap& state) {
@@ -38,4 +53,37 @@ void ObjectWithAttributes::readAttributesFrom(const QCborMap& state) {
         if (!attr) continue;
         attr->readFrom(state);
     }
+    m_attributeTable.readFrom(state);
+}
+
+void ObjectWithAttributes::writeAttributesTo(QCborStreamWriter& writer) const {
+    for (SmartAttribute* attr: m_persistentAttributes) {
+        if (!attr) continue;
+        attr->writeTo(writer);
+    }
+    m_attributeTable.writeTo(writer);
+}
+
+void ObjectWithAttributes::setAttributeNotificationsPaused(bool paused) {
+    for (SmartAttribute* attr: m_attributes) {
+        if (!attr) continue;
+        attr->setNotificationsPaused(paused);
+    }
+}
+
+SmartAttribute* ObjectWithAttributes::persistentAttributeForKey(const QString& key) const {
+    if (m_persistentAttributeKeys.isEmpty()) {
+        for (SmartAttribute* attr: m_persistentAttributes) {
+            if (!attr) continue;
+            for (const QString& attrKey: attr->stateKeys()) {
+                m_persistentAttributeKeys[attrKey] = attr;
+            }
+        }
+    }
+    return m_persistentAttributeKeys.value(key);
+}
+
+SmartAttribute* ObjectWithAttributes::attributeByName(const QString& name) const {
+    const int index = m_attributeNameIds.indexOf(AttributeTable::findName(name));
+    return index >= 0 ? m_attributes[index].data() : nullptr;
 }
@@ -1,9 +1,15 @@
 #ifndef OBJECTWITHPROPERTIES_H
 #define OBJECTWITHPROPERTIES_H
 
+#include "core/helpers/AttributeTable.h"
+
 #include <QMap>
+#include <QHash>
 #include <QString>
+#include <QVector>
 #include <QPointer>
+#include <QCborMap>
+#include <QCborStreamWriter>
 
 class SmartAttribute;
 
@@ -16,41 +22,105 @@ public:
 
     QObject* parent() { return m_parent; }
 
+    /**
+     * @brief attr returns the SmartAttribute with the given name or the QML proxy
+     * of a value in the attribute table (the proxy is created on first use)
+     * @param name name of the attribute
+     * @return the attribute or nullptr if it doesn't exist
+     */
     QObject* attr(QString name);
 
     template<typename T>
     T* attribute(const QString& name) {
-        return qobject_cast<T*>(m_attributes.value(name));
+        return qobject_cast<T*>(attributeByName(name));
     }
 
     template<typename T>
     const T* attribute(const QString& name) const {
-        return qobject_cast<const T*>(m_attributes.value(name));
+        return qobject_cast<const T*>(attributeByName(name));
     }
 
+    /**
+     * @brief attributeTable returns the table that contains the values of all Compact*Attributes
+     * @return the attribute table of this object
+     */
+    AttributeTable& attributeTable() { return m_attributeTable; }
+
     /**
      * @brief registerAttribute registers an attribute to be available by attr()
      * and to be persisted if requested
-     * @param attr a pointer to the attribute to register
+     * @param attr a pointer to the attribute to register,
+     * it has to exist as long as this object (usually it is a member)
      */
     void registerAttribute(SmartAttribute* attr);
 
     void writeAttributesTo(QCborMap& state) const;
     void readAttributesFrom(const QCborMap& state);
 
+    /**
+     * @brief writeAttributesTo writes all persistent attributes directly to a CBOR stream
+     * @param writer the stream writer, positioned inside a map
+     */
+    void writeAttributesTo(QCborStreamWriter& writer) const;
+
+    /**
+     * @brief persistentAttributeForKey returns the persistent attribute that uses the given key
+     * in a state map (see SmartAttribute::stateKeys())
+     * @param key a key of a state map
+     * @return the attribute or nullptr if no persistent attribute uses this key
+     */
+    SmartAttribute* persistentAttributeForKey(const QString& key) const;
+
+    /**
+     * @brief persistentAttributes returns all attributes that should be persisted
+     * @return list of attributes
+     */
+    const QVector<QPointer<SmartAttribute>>& persistentAttributes() const { return m_persistentAttributes; }
+
+    /**
+     * @brief setAttributeNotificationsPaused pauses the coalesced notifications of all attributes
+     * (see SmartAttribute::setNotificationsPaused())
+     * @param paused true to pause the notifications
+     */
+    void setAttributeNotificationsPaused(bool paused);
+
 protected:
+    /**
+     * @brief attributeByName returns the SmartAttribute with the given name
+     * @param name name of the attribute
+     * @return the attribute or nullptr if there is no SmartAttribute with this name
+     */
+    SmartAttribute* attributeByName(const QString& name) const;
 
     QObject* const m_parent;
 
     /**
      * @brief m_attributes contains all SmartAttributes of this object
+     * (an attribute could be deleted before this object if it is not a member)
+     */
+    QVector<QPointer<SmartAttribute>> m_attributes;
+
+    /**
+     * @brief m_attributeNameIds contains the interned name of each attribute in m_attributes
+     * (see AttributeTable::internName()), they are compared instead of the strings
      */
-    QMap<QString, QPointer<SmartAttribute>> m_attributes;
+    QVector<int> m_attributeNameIds;
 
     /**
      * @brief m_persistentAttributes contains pointers to all attributes that should be persistet
      */
     QVector<QPointer<SmartAttribute>> m_persistentAttributes;
+
+    /**
+     * @brief m_persistentAttributeKeys maps the state keys to the persistent attributes,
+     * it is created on first use by persistentAttributeForKey()
+     */
+    mutable QHash<QString, QPointer<SmartAttribute>> m_persistentAttributeKeys;
+
+    /**
+     * @brief m_attributeTable contains the values of all Compact*Attributes of this object
+     */
+    AttributeTable m_attributeTable;
 };
 
 #endif // OBJECTWITHPROPERTIES_H
@@ -0,0 +1,149 @@
+#include "PersistentStateMap.h"
+
+
+PersistentStateMap::PersistentStateMap()
+    : m_size(0)
+{
+
+}
+
+bool PersistentStateMap::contains(const QString& key) const {
+    const Bucket* bucket = bucketFor(key);
+    return bucket && bucket->contains(key);
+}
+
+QByteArray PersistentStateMap::value(const QString& key) const {
+    const Bucket* bucket = bucketFor(key);
+    if (!bucket) return QByteArray();
+    return bucket->value(key);
+}
+
+QStringList PersistentStateMap::keys() const {
+    QStringList keys;
+    keys.reserve(m_size);
+    for (const QSharedPointer<const Branch>& branch: m_branches) {
+        if (!branch) continue;
+        for (const QSharedPointer<const Bucket>& bucket: branch->buckets) {
+            if (!bucket) continue;
+            keys.append(bucket->keys());
+        }
+    }
+    return keys;
+}
+
+PersistentStateMap PersistentStateMap::updated(const QHash<QString, QByteArray>& changed, const QStringList& removed) const {
+    // collect the modified buckets first, each bucket is only copied once
+    // even if it contains multiple changed entries:
+    QHash<int, Bucket> modifiedBuckets;
+    int sizeDifference = 0;
+
+    auto modifiableBucket = [this, &modifiedBuckets](uint hash) -> Bucket& {
+        const int slot = branchIndex(hash) * fanout + bucketIndex(hash);
+        auto it = modifiedBuckets.find(slot);
+        if (it == modifiedBuckets.end()) {
+            const QSharedPointer<const Branch>& branch = m_branches[size_t(branchIndex(hash))];
+            Bucket copy;
+            if (branch && branch->buckets[size_t(bucketIndex(hash))]) {
+                copy = *branch->buckets[size_t(bucketIndex(hash))];
+            }
+            it = modifiedBuckets.insert(slot, copy);
+        }
+        return it.value();
+    };
+
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        const Bucket* existingBucket = bucketFor(it.key());
+        if (existingBucket) {
+            auto existing = existingBucket->constFind(it.key());
+            if (existing != existingBucket->constEnd() && existing.value() == it.value()) {
+                // entry didn't change, keep sharing the bucket:
+                continue;
+            }
+            if (existing == existingBucket->constEnd()) ++sizeDifference;
+        } else {
+            ++sizeDifference;
+        }
+        modifiableBucket(qHash(it.key())).insert(it.key(), it.value());
+    }
+
+    for (const QString& key: removed) {
+        if (!contains(key)) continue;
+        modifiableBucket(qHash(key)).remove(key);
+        --sizeDifference;
+    }
+
+    if (modifiedBuckets.isEmpty()) return *this;
+
+    // build the new tree, only the modified paths are copied:
+    PersistentStateMap result = *this;
+    result.m_size += sizeDifference;
+    QHash<int, Branch> modifiedBranches;
+    for (auto it = modifiedBuckets.begin(); it != modifiedBuckets.end(); ++it) {
+        const int branchIdx = it.key() / fanout;
+        const int bucketIdx = it.key() % fanout;
+        auto branchIt = modifiedBranches.find(branchIdx);
+        if (branchIt == modifiedBranches.end()) {
+            Branch copy;
+            if (m_branches[size_t(branchIdx)]) copy = *m_branches[size_t(branchIdx)];
+            branchIt = modifiedBranches.insert(branchIdx, copy);
+        }
+        if (it.value().isEmpty()) {
+            branchIt.value().buckets[size_t(bucketIdx)].reset();
+        } else {
+            branchIt.value().buckets[size_t(bucketIdx)] = QSharedPointer<const Bucket>::create(it.value());
+        }
+    }
+    for (auto it = modifiedBranches.begin(); it != modifiedBranches.end(); ++it) {
+        result.m_branches[size_t(it.key())] = QSharedPointer<const Branch>::create(it.value());
+    }
+    return result;
+}
+
+void PersistentStateMap::diff(const PersistentStateMap& newer, QStringList& changed, QStringList& removed) const {
+    static const Bucket emptyBucket;
+    for (size_t b = 0; b < size_t(fanout); ++b) {
+        const QSharedPointer<const Branch>& oldBranch = m_branches[b];
+        const QSharedPointer<const Branch>& newBranch = newer.m_branches[b];
+        // shared branches are equal by definition:
+        if (oldBranch == newBranch) continue;
+
+        for (size_t i = 0; i < size_t(fanout); ++i) {
+            const Bucket* oldBucket = oldBranch ? oldBranch->buckets[i].data() : nullptr;
+            const Bucket* newBucket = newBranch ? newBranch->buckets[i].data() : nullptr;
+            if (oldBucket == newBucket) continue;
+            if (!oldBucket) oldBucket = &emptyBucket;
+            if (!newBucket) newBucket = &emptyBucket;
+
+            for (auto it = newBucket->constBegin(); it != newBucket->constEnd(); ++it) {
+                auto oldEntry = oldBucket->constFind(it.key());
+                if (oldEntry == oldBucket->constEnd() || oldEntry.value() != it.value()) {
+                    changed.append(it.key());
+                }
+            }
+            for (auto it = oldBucket->constBegin(); it != oldBucket->constEnd(); ++it) {
+                if (!newBucket->contains(it.key())) {
+                    removed.append(it.key());
+                }
+            }
+        }
+    }
+}
+
+int PersistentStateMap::sharedBucketCount(const PersistentStateMap& other) const {
+    int count = 0;
+    for (size_t b = 0; b < size_t(fanout); ++b) {
+        if (!m_branches[b] || !other.m_branches[b]) continue;
+        for (size_t i = 0; i < size_t(fanout); ++i) {
+            const QSharedPointer<const Bucket>& bucket = m_branches[b]->buckets[i];
+            if (bucket && bucket == other.m_branches[b]->buckets[i]) ++count;
+        }
+    }
+    return count;
+}
+
+const PersistentStateMap::Bucket* PersistentStateMap::bucketFor(const QString& key) const {
+    const uint hash = qHash(key);
+    const QSharedPointer<const Branch>& branch = m_branches[size_t(branchIndex(hash))];
+    if (!branch) return nullptr;
+    return branch->buckets[size_t(bucketIndex(hash))].data();
+}
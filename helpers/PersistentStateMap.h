@@ -0,0 +1,115 @@
+#ifndef PERSISTENTSTATEMAP_H
+#define PERSISTENTSTATEMAP_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+
+
+/**
+ * @brief The PersistentStateMap class is an immutable map from a key (i.e. a block UID)
+ * to a CBOR encoded state that shares its structure with previous versions of itself.
+ *
+ * The entries are distributed by hash over a fixed two level tree of buckets.
+ * Modifying a map returns a new map that only copies the buckets containing changed
+ * entries while all other buckets are shared with the original map.
+ * This makes it cheap to keep many versions of a large project in memory and to
+ * find the differences between two versions (shared buckets are skipped).
+ */
+class PersistentStateMap {
+
+public:
+    /**
+     * @brief fanout is the number of children of each tree level
+     */
+    static const int fanout = 32;
+
+    /**
+     * @brief PersistentStateMap creates an empty map
+     */
+    PersistentStateMap();
+
+    /**
+     * @brief size returns the number of entries in this map
+     * @return number of entries
+     */
+    int size() const { return m_size; }
+
+    bool isEmpty() const { return m_size == 0; }
+
+    bool contains(const QString& key) const;
+
+    /**
+     * @brief value returns the state stored for a key
+     * @param key to look for
+     * @return the encoded state or an empty array if the key does not exist
+     */
+    QByteArray value(const QString& key) const;
+
+    /**
+     * @brief keys returns all keys of this map in an unspecified order
+     * @return list of keys
+     */
+    QStringList keys() const;
+
+    /**
+     * @brief updated returns a new version of this map with the given changes applied,
+     * entries that are equal to the existing ones don't create a copy of their bucket
+     * @param changed new or modified entries
+     * @param removed keys of entries to remove
+     * @return a new map sharing all unchanged buckets with this one
+     */
+    PersistentStateMap updated(const QHash<QString, QByteArray>& changed, const QStringList& removed) const;
+
+    /**
+     * @brief diff calculates the differences between this map and a newer version of it
+     * @param newer the other version
+     * @param changed will contain the keys of entries that are new or modified in newer
+     * @param removed will contain the keys of entries that don't exist in newer anymore
+     */
+    void diff(const PersistentStateMap& newer, QStringList& changed, QStringList& removed) const;
+
+    /**
+     * @brief sharedBucketCount returns the number of buckets shared with another map,
+     * useful to check how much memory a version actually costs
+     * @param other map to compare with
+     * @return number of shared non-empty buckets
+     */
+    int sharedBucketCount(const PersistentStateMap& other) const;
+
+    /**
+     * @brief isIdenticalTo returns true if both maps share their complete structure,
+     * i.e. if other was returned by updated() without any actual changes
+     * @param other map to compare with
+     * @return true if identical
+     */
+    bool isIdenticalTo(const PersistentStateMap& other) const { return m_branches == other.m_branches; }
+
+protected:
+    typedef QHash<QString, QByteArray> Bucket;
+
+    struct Branch {
+        std::array<QSharedPointer<const Bucket>, fanout> buckets;
+    };
+
+    static int branchIndex(uint hash) { return int(hash % fanout); }
+    static int bucketIndex(uint hash) { return int((hash / fanout) % fanout); }
+
+    const Bucket* bucketFor(const QString& key) const;
+
+    /**
+     * @brief m_branches is the first tree level, empty pointers represent empty branches
+     */
+    std::array<QSharedPointer<const Branch>, fanout> m_branches;
+
+    /**
+     * @brief m_size is the number of entries
+     */
+    int m_size;
+};
+
+#endif // PERSISTENTSTATEMAP_H
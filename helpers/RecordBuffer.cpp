@@ -0,0 +1,35 @@
+#include "RecordBuffer.h"
+
+#include <QtEndian>
+
+
+QByteArray RecordBuffer::encode(quint8 type, const QByteArray& payload) {
+    QByteArray record(headerSize, Qt::Uninitialized);
+    uchar* header = reinterpret_cast<uchar*>(record.data());
+    header[0] = type;
+    qToBigEndian<quint32>(quint32(payload.size()), header + 1);
+    qToBigEndian<quint16>(qChecksum(payload.constData(), uint(payload.size())), header + 5);
+    record.append(payload);
+    return record;
+}
+
+RecordBuffer::Status RecordBuffer::take(int maxPayloadSize, quint8& type, QByteArray& payload) {
+    const int available = m_data.size() - m_readOffset;
+    if (available < headerSize) return Incomplete;
+    const uchar* header = reinterpret_cast<const uchar*>(m_data.constData() + m_readOffset);
+    const quint32 size = qFromBigEndian<quint32>(header + 1);
+    if (size > quint32(maxPayloadSize)) return Corrupt;
+    if (available < headerSize + int(size)) return Incomplete;
+
+    type = header[0];
+    payload = m_data.mid(m_readOffset + headerSize, int(size));
+    if (qChecksum(payload.constData(), uint(payload.size())) != qFromBigEndian<quint16>(header + 5)) {
+        return Corrupt;
+    }
+    m_readOffset += headerSize + int(size);
+    if (m_readOffset > m_data.size() / 2) {
+        m_data.remove(0, m_readOffset);
+        m_readOffset = 0;
+    }
+    return Complete;
+}
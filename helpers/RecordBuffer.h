@@ -0,0 +1,64 @@
+#ifndef RECORDBUFFER_H
+#define RECORDBUFFER_H
+
+#include <QByteArray>
+
+
+/**
+ * @brief The RecordBuffer class splits a byte stream (i.e. of a TCP socket) into records
+ * with the format [u8 type][u32 payload size][u16 checksum][payload], integers are big endian.
+ *
+ * Received bytes are stored until a record is complete. Consumed bytes are only removed
+ * when they make up more than half of the buffer to not move the remaining bytes after each record.
+ */
+class RecordBuffer {
+
+public:
+    /**
+     * @brief The Status enum is the result of take()
+     */
+    enum Status {
+        Incomplete,  //!< more bytes are needed
+        Complete,  //!< a record was taken from the buffer
+        Corrupt,  //!< the checksum doesn't match or the payload is too large
+    };
+
+    /**
+     * @brief headerSize is the size of type, payload size and checksum of a record
+     */
+    static const int headerSize = 1 + 4 + 2;
+
+    /**
+     * @brief encode creates a record
+     * @param type the record type
+     * @param payload the payload
+     * @return the encoded record
+     */
+    static QByteArray encode(quint8 type, const QByteArray& payload = QByteArray());
+
+    /**
+     * @brief append adds received bytes
+     * @param bytes the bytes
+     */
+    void append(const QByteArray& bytes) { m_data.append(bytes); }
+
+    /**
+     * @brief take removes the next complete record from the buffer
+     * @param maxPayloadSize larger payloads are treated as corrupt
+     * @param type the type of the record is stored here
+     * @param payload the payload of the record is stored here
+     * @return Complete if a record was taken
+     */
+    Status take(int maxPayloadSize, quint8& type, QByteArray& payload);
+
+    /**
+     * @brief bufferedBytes returns the number of received bytes that are not consumed yet
+     */
+    int bufferedBytes() const { return m_data.size() - m_readOffset; }
+
+protected:
+    QByteArray m_data;
+    int m_readOffset = 0;  //!< offset of the first byte that has not been consumed
+};
+
+#endif // RECORDBUFFER_H
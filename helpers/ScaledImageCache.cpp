@@ -0,0 +1,126 @@
+#include "ScaledImageCache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QVector>
+#include <QPair>
+
+#include <algorithm>
+
+#include <QDebug>
+
+
+// create a shorter alias for the constants namespace:
+namespace SICC = ScaledImageCacheConstants;
+
+ScaledImageCache::ScaledImageCache(const QString& directory)
+    : m_directory(directory.endsWith("/") ? directory : directory + "/")
+    , m_memoryCache(SICC::memoryCacheBytes)
+    , m_accessCounter(0)
+    , m_diskCacheBytes(-1)
+{
+    QDir().mkpath(m_directory);
+}
+
+QByteArray ScaledImageCache::get(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight) {
+    const QString key = cacheKey(path, lastModified, maxWidth, maxHeight);
+    const QString fileName = fileNameForKey(key);
+    {
+        QMutexLocker locker(&m_mutex);
+        const QByteArray* cached = m_memoryCache.object(key);
+        if (cached) {
+            auto entryIt = m_diskEntries.find(fileName);
+            if (entryIt != m_diskEntries.end()) entryIt->lastAccess = ++m_accessCounter;
+            return *cached;
+        }
+    }
+
+    QFile file(m_directory + fileName);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    const QByteArray image = file.readAll();
+    file.close();
+    if (image.isEmpty()) return QByteArray();
+
+    QMutexLocker locker(&m_mutex);
+    m_memoryCache.insert(key, new QByteArray(image), image.size());
+    // the file times are not touched, the order is only tracked in memory:
+    loadDiskEntriesUnlocked();
+    auto entryIt = m_diskEntries.find(fileName);
+    if (entryIt != m_diskEntries.end()) entryIt->lastAccess = ++m_accessCounter;
+    return image;
+}
+
+void ScaledImageCache::insert(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight, const QByteArray& image) {
+    if (image.isEmpty()) return;
+    const QString key = cacheKey(path, lastModified, maxWidth, maxHeight);
+    const QString fileName = fileNameForKey(key);
+
+    // QSaveFile prevents other threads from reading a partially written file:
+    QSaveFile file(m_directory + fileName);
+    bool saved = false;
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(image);
+        saved = file.commit();
+    }
+    if (!saved) {
+        qWarning() << "Couldn't write scaled image to cache: " << file.errorString();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_memoryCache.insert(key, new QByteArray(image), image.size());
+    if (!saved) return;
+    loadDiskEntriesUnlocked();
+    // an existing file with the same key was replaced, its old size doesn't count anymore:
+    const DiskEntry replacedEntry = m_diskEntries.value(fileName, DiskEntry{0, 0});
+    m_diskEntries.insert(fileName, DiskEntry{image.size(), ++m_accessCounter});
+    m_diskCacheBytes += image.size() - replacedEntry.size;
+    if (m_diskCacheBytes > SICC::diskCacheBytes) {
+        trimDiskCacheUnlocked();
+    }
+}
+
+QString ScaledImageCache::cacheKey(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight) {
+    return path + "|" + QString::number(lastModified.toMSecsSinceEpoch())
+            + "|" + QString::number(maxWidth) + "|" + QString::number(maxHeight);
+}
+
+QString ScaledImageCache::fileNameForKey(const QString& key) {
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1);
+    return QString::fromLatin1(hash.toHex()) + ".jpg";
+}
+
+void ScaledImageCache::loadDiskEntriesUnlocked() {
+    if (m_diskCacheBytes >= 0) return;
+    // oldest files first, they get the lowest access counter:
+    const QFileInfoList files = QDir(m_directory).entryInfoList({"*.jpg"}, QDir::Files, QDir::Time | QDir::Reversed);
+    m_diskCacheBytes = 0;
+    for (const QFileInfo& info: files) {
+        m_diskEntries.insert(info.fileName(), DiskEntry{info.size(), ++m_accessCounter});
+        m_diskCacheBytes += info.size();
+    }
+}
+
+void ScaledImageCache::trimDiskCacheUnlocked() {
+    if (m_diskCacheBytes <= SICC::diskCacheBytes) return;
+    QVector<QPair<quint64, QString>> filesByAccess;
+    filesByAccess.reserve(m_diskEntries.size());
+    for (auto it = m_diskEntries.cbegin(); it != m_diskEntries.cend(); ++it) {
+        filesByAccess.append({it->lastAccess, it.key()});
+    }
+    // least recently used files first:
+    std::sort(filesByAccess.begin(), filesByAccess.end());
+
+    const qint64 targetBytes = qint64(SICC::diskCacheBytes * SICC::diskCacheTrimRatio);
+    for (const auto& file: filesByAccess) {
+        if (m_diskCacheBytes <= targetBytes) break;
+        const QString& fileName = file.second;
+        // a file that was already removed externally doesn't count anymore, too:
+        if (QFile::remove(m_directory + fileName) || !QFile::exists(m_directory + fileName)) {
+            m_diskCacheBytes -= m_diskEntries.take(fileName).size;
+        }
+    }
+}
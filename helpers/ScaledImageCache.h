@@ -0,0 +1,140 @@
+#ifndef SCALEDIMAGECACHE_H
+#define SCALEDIMAGECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+
+/**
+ * @brief The ScaledImageCacheConstants namespace contains all constants used in ScaledImageCache.
+ */
+namespace ScaledImageCacheConstants {
+    /**
+     * @brief memoryCacheBytes is the maximum size of the encoded images kept in memory
+     */
+    static const int memoryCacheBytes = 32 * 1024 * 1024;
+    /**
+     * @brief diskCacheBytes is the maximum size of the cache directory,
+     * the least recently used images are removed if it is exceeded
+     */
+    static const qint64 diskCacheBytes = 256 * 1024 * 1024;
+    /**
+     * @brief diskCacheTrimRatio is the part of diskCacheBytes that remains after trimming,
+     * to not trim again after every new image
+     */
+    static const double diskCacheTrimRatio = 0.8;
+}
+
+/**
+ * @brief The ScaledImageCache class stores encoded, scaled down versions of image files.
+ *
+ * Images are identified by the path and modification time of the original file and the
+ * requested maximum size, a modified original file therefore never returns an outdated image.
+ * The most recently used images are kept in memory, all others are stored as files
+ * in a cache directory and can be returned with a single read.
+ * The order in which the files were used is only tracked in memory, files from
+ * previous sessions are ordered by their modification time.
+ * All methods are thread-safe.
+ */
+class ScaledImageCache {
+
+    Q_DISABLE_COPY(ScaledImageCache)
+
+public:
+    /**
+     * @brief ScaledImageCache creates a cache that stores its files in the given directory
+     * @param directory path to the cache directory, it is created if it doesn't exist
+     */
+    explicit ScaledImageCache(const QString& directory);
+
+    /**
+     * @brief get returns a cached image
+     * @param path of the original image file
+     * @param lastModified modification time of the original file
+     * @param maxWidth maximum width of the scaled image
+     * @param maxHeight maximum height of the scaled image
+     * @return the encoded image or an empty array if it is not cached
+     */
+    QByteArray get(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight);
+
+    /**
+     * @brief insert adds an encoded image to the memory and disk cache
+     * @param path of the original image file
+     * @param lastModified modification time of the original file
+     * @param maxWidth maximum width of the scaled image
+     * @param maxHeight maximum height of the scaled image
+     * @param image the encoded, scaled image
+     */
+    void insert(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight, const QByteArray& image);
+
+protected:
+    /**
+     * @brief cacheKey returns the key of an image in the memory cache
+     * @return "path|modification time|width|height"
+     */
+    static QString cacheKey(const QString& path, const QDateTime& lastModified, int maxWidth, int maxHeight);
+
+    /**
+     * @brief fileNameForKey returns the name of the file containing an image in the cache directory
+     * @param key as returned by cacheKey()
+     * @return a hash of the key with the file extension
+     */
+    static QString fileNameForKey(const QString& key);
+
+    /**
+     * @brief loadDiskEntriesUnlocked reads the size and modification time of the files
+     * in the cache directory once (m_mutex has to be locked)
+     */
+    void loadDiskEntriesUnlocked();
+
+    /**
+     * @brief trimDiskCacheUnlocked removes the least recently used files if the cache directory
+     * is larger than allowed (m_mutex has to be locked)
+     */
+    void trimDiskCacheUnlocked();
+
+    /**
+     * @brief The DiskEntry struct describes a file in the cache directory.
+     */
+    struct DiskEntry {
+        qint64 size;  //!< size of the file in bytes
+        quint64 lastAccess;  //!< value of m_accessCounter when the file was used last
+    };
+
+    /**
+     * @brief m_directory is the path to the cache directory ending with a slash
+     */
+    const QString m_directory;
+
+    /**
+     * @brief m_mutex protects the members below
+     */
+    QMutex m_mutex;
+
+    /**
+     * @brief m_memoryCache contains the most recently used images, the cost is the size in bytes
+     */
+    QCache<QString, QByteArray> m_memoryCache;
+
+    /**
+     * @brief m_diskEntries contains the files in the cache directory by their name
+     */
+    QHash<QString, DiskEntry> m_diskEntries;
+
+    /**
+     * @brief m_accessCounter is incremented every time a file is used
+     */
+    quint64 m_accessCounter;
+
+    /**
+     * @brief m_diskCacheBytes is the size of the cache directory,
+     * -1 if m_diskEntries has not been loaded yet
+     */
+    qint64 m_diskCacheBytes;
+};
+
+#endif // SCALEDIMAGECACHE_H
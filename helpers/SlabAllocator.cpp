@@ -0,0 +1,154 @@
+#include "SlabAllocator.h"
+
+#include <QDebug>
+
+#include <cstdlib>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <malloc.h>
+#endif
+
+
+// create a shorter alias for the constants namespace:
+namespace SAC = SlabAllocatorConstants;
+
+namespace {
+
+// slabs are aligned to their size to find the slab of an object by masking its address:
+void* allocateSlabMemory() {
+#ifdef Q_OS_WIN
+    return _aligned_malloc(SAC::slabSize, SAC::slabSize);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, SAC::slabSize, SAC::slabSize) != 0) return nullptr;
+    return ptr;
+#endif
+}
+
+void freeSlabMemory(void* ptr) {
+#ifdef Q_OS_WIN
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+}  // namespace
+
+
+SlabAllocator::SlabAllocator(const QString& name)
+    : m_name(name)
+    , m_freeLists(sizeClassOf(SAC::maxObjectSize) + 1, nullptr)
+    , m_allocations(0)
+    , m_deallocations(0)
+    , m_heapAllocations(0)
+{
+
+}
+
+SlabAllocator::~SlabAllocator() {
+    if (m_allocations != m_deallocations) {
+        qWarning() << "[SlabAllocator]" << m_name << ":" << (m_allocations - m_deallocations) << "objects were not deleted.";
+    }
+    for (SlabHeader* slab: m_slabs) {
+        freeSlabMemory(slab);
+    }
+}
+
+void* SlabAllocator::allocate(std::size_t size) {
+    ++m_allocations;
+    if (size > SAC::maxObjectSize) {
+        ++m_heapAllocations;
+        return ::operator new(size);
+    }
+    const int sizeClass = sizeClassOf(size);
+    if (!m_freeLists[sizeClass] && !addSlab(sizeClass)) {
+        throw std::bad_alloc();
+    }
+    FreeChunk* chunk = m_freeLists[sizeClass];
+    m_freeLists[sizeClass] = chunk->next;
+    ++slabOf(chunk)->liveObjects;
+    return chunk;
+}
+
+void SlabAllocator::deallocate(void* ptr, std::size_t size) {
+    if (!ptr) return;
+    ++m_deallocations;
+    if (size > SAC::maxObjectSize) {
+        ::operator delete(ptr);
+        return;
+    }
+    const int sizeClass = sizeClassOf(size);
+    FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+    chunk->next = m_freeLists[sizeClass];
+    m_freeLists[sizeClass] = chunk;
+    --slabOf(chunk)->liveObjects;
+}
+
+int SlabAllocator::releaseEmptySlabs() {
+    QVector<SlabHeader*> remainingSlabs;
+    QVector<bool> sizeClassHasEmptySlab(m_freeLists.size(), false);
+    for (SlabHeader* slab: m_slabs) {
+        if (slab->liveObjects == 0) {
+            sizeClassHasEmptySlab[slab->sizeClass] = true;
+        } else {
+            remainingSlabs.append(slab);
+        }
+    }
+    const int releasedCount = m_slabs.size() - remainingSlabs.size();
+    if (releasedCount == 0) return 0;
+
+    // remove the chunks of the empty slabs from the free lists before releasing them:
+    for (int sizeClass = 0; sizeClass < m_freeLists.size(); ++sizeClass) {
+        if (!sizeClassHasEmptySlab[sizeClass]) continue;
+        FreeChunk** link = &m_freeLists[sizeClass];
+        while (*link) {
+            if (slabOf(*link)->liveObjects == 0) {
+                *link = (*link)->next;
+            } else {
+                link = &(*link)->next;
+            }
+        }
+    }
+    for (SlabHeader* slab: m_slabs) {
+        if (slab->liveObjects == 0) freeSlabMemory(slab);
+    }
+    m_slabs = remainingSlabs;
+    return releasedCount;
+}
+
+QVariantMap SlabAllocator::getStatistics() const {
+    QVariantMap statistics;
+    statistics["name"] = m_name;
+    statistics["allocations"] = m_allocations;
+    statistics["deallocations"] = m_deallocations;
+    statistics["liveObjects"] = m_allocations - m_deallocations;
+    statistics["heapAllocations"] = m_heapAllocations;
+    statistics["slabs"] = m_slabs.size();
+    statistics["reservedBytes"] = quint64(m_slabs.size()) * SAC::slabSize;
+    return statistics;
+}
+
+bool SlabAllocator::addSlab(int sizeClass) {
+    void* memory = allocateSlabMemory();
+    if (!memory) {
+        qCritical() << "[SlabAllocator]" << m_name << ": Could not allocate slab.";
+        return false;
+    }
+    SlabHeader* slab = new (memory) SlabHeader{sizeClass, 0};
+    m_slabs.append(slab);
+
+    // link all chunks of the slab, the first one at the front of the free list:
+    const std::size_t size = chunkSize(sizeClass);
+    char* const begin = static_cast<char*>(memory) + sizeof(SlabHeader);
+    const std::size_t chunkCount = (SAC::slabSize - sizeof(SlabHeader)) / size;
+    FreeChunk* next = m_freeLists[sizeClass];
+    for (std::size_t i = chunkCount; i > 0; --i) {
+        FreeChunk* chunk = reinterpret_cast<FreeChunk*>(begin + (i - 1) * size);
+        chunk->next = next;
+        next = chunk;
+    }
+    m_freeLists[sizeClass] = next;
+    return true;
+}
@@ -0,0 +1,119 @@
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+
+#include <QString>
+#include <QVector>
+#include <QVariantMap>
+
+#include <cstddef>
+
+
+/**
+ * @brief The SlabAllocatorConstants namespace contains all constants used in SlabAllocator.
+ */
+namespace SlabAllocatorConstants {
+    /**
+     * @brief slabSize is the size of a memory block that is requested from the system at once,
+     * slabs are aligned to this size to find the slab of an object by its address
+     */
+    static const std::size_t slabSize = 64 * 1024;
+    /**
+     * @brief granularity is the difference in bytes between the object size classes
+     */
+    static const std::size_t granularity = 32;
+    /**
+     * @brief maxObjectSize is the maximum size of an object in a slab,
+     * larger objects are allocated on the normal heap
+     */
+    static const std::size_t maxObjectSize = 4096;
+}
+
+
+/**
+ * @brief The SlabAllocator class allocates objects of similar size from large memory blocks (slabs)
+ * instead of requesting each one from the system.
+ *
+ * Each slab only contains objects of one size class. Freed objects are kept in a free list
+ * of their size class and are reused by the next allocation of that class.
+ * Slabs without objects are returned to the system with releaseEmptySlabs()
+ * (i.e. after all blocks of a project were deleted).
+ *
+ * It is not thread-safe, blocks and nodes are only created and deleted in the main thread.
+ */
+class SlabAllocator {
+
+    Q_DISABLE_COPY(SlabAllocator)
+
+public:
+    /**
+     * @brief SlabAllocator creates an allocator without any slabs
+     * @param name used in the statistics and warnings
+     */
+    explicit SlabAllocator(const QString& name);
+    ~SlabAllocator();
+
+    /**
+     * @brief allocate returns memory for an object
+     * @param size size of the object in bytes
+     * @return pointer to uninitialized memory, aligned for any type
+     */
+    void* allocate(std::size_t size);
+
+    /**
+     * @brief deallocate frees the memory of an object
+     * @param ptr pointer returned by allocate()
+     * @param size the same size that was passed to allocate()
+     */
+    void deallocate(void* ptr, std::size_t size);
+
+    /**
+     * @brief releaseEmptySlabs returns all slabs without objects to the system
+     * @return number of released slabs
+     */
+    int releaseEmptySlabs();
+
+    /**
+     * @brief getStatistics returns the allocation counters to verify the effect of the allocator
+     * @return map with allocations, deallocations, liveObjects, heapAllocations, slabs and reservedBytes
+     */
+    QVariantMap getStatistics() const;
+
+protected:
+    /**
+     * @brief The FreeChunk struct is stored in unused chunks to link them in a free list.
+     */
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    /**
+     * @brief The SlabHeader struct is stored at the beginning of each slab.
+     */
+    struct alignas(std::max_align_t) SlabHeader {
+        int sizeClass;
+        int liveObjects;
+    };
+
+    static int sizeClassOf(std::size_t size) { return int((size + SlabAllocatorConstants::granularity - 1) / SlabAllocatorConstants::granularity) - 1; }
+    static std::size_t chunkSize(int sizeClass) { return std::size_t(sizeClass + 1) * SlabAllocatorConstants::granularity; }
+    static SlabHeader* slabOf(void* ptr) {
+        return reinterpret_cast<SlabHeader*>(reinterpret_cast<quintptr>(ptr) & ~quintptr(SlabAllocatorConstants::slabSize - 1));
+    }
+
+    /**
+     * @brief addSlab requests a new slab from the system and adds its chunks to the free list
+     * @param sizeClass the size class of the objects in the new slab
+     * @return false if no memory is available
+     */
+    bool addSlab(int sizeClass);
+
+    const QString m_name;
+    QVector<FreeChunk*> m_freeLists;  //!< first unused chunk by size class
+    QVector<SlabHeader*> m_slabs;  //!< all slabs requested from the system
+
+    quint64 m_allocations;  //!< number of allocated objects
+    quint64 m_deallocations;  //!< number of freed objects
+    quint64 m_heapAllocations;  //!< number of objects too large for a slab
+};
+
+#endif // SLABALLOCATOR_H
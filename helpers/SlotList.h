@@ -0,0 +1,82 @@
+#ifndef SLOTLIST_H
+#define SLOTLIST_H
+
+#include <QHash>
+#include <QVector>
+
+
+/**
+ * @brief The SlotList class is an unordered set of items (i.e. blocks) in a dense array
+ * that supports adding, removing and finding an item in constant time.
+ *
+ * The slot of each item in the array is stored in a hash. An item is removed by moving
+ * the last item into its slot (swap-remove), so the order of the items changes.
+ */
+template<typename T>
+class SlotList {
+
+public:
+    typedef typename QVector<T>::const_iterator const_iterator;
+
+    /**
+     * @brief insert adds an item, nothing happens if it already exists
+     * @param item the item
+     * @return true if it was added
+     */
+    bool insert(const T& item) {
+        if (m_slots.contains(item)) return false;
+        m_slots.insert(item, m_items.size());
+        m_items.append(item);
+        return true;
+    }
+
+    /**
+     * @brief remove removes an item, nothing happens if it doesn't exist
+     * @param item the item
+     * @return true if it was removed
+     */
+    bool remove(const T& item) {
+        auto it = m_slots.find(item);
+        if (it == m_slots.end()) return false;
+        const int slot = it.value();
+        m_slots.erase(it);
+        const int lastSlot = m_items.size() - 1;
+        if (slot != lastSlot) {
+            // move the last item into the free slot:
+            m_items[slot] = m_items[lastSlot];
+            m_slots[m_items[slot]] = slot;
+        }
+        m_items.removeLast();
+        return true;
+    }
+
+    bool contains(const T& item) const { return m_slots.contains(item); }
+
+    int size() const { return m_items.size(); }
+    bool isEmpty() const { return m_items.isEmpty(); }
+
+    void reserve(int size) {
+        m_items.reserve(size);
+        m_slots.reserve(size);
+    }
+
+    void clear() {
+        m_items.clear();
+        m_slots.clear();
+    }
+
+    /**
+     * @brief items returns all items in the order of their slots
+     * @return the dense array of items
+     */
+    const QVector<T>& items() const { return m_items; }
+
+    const_iterator begin() const { return m_items.cbegin(); }
+    const_iterator end() const { return m_items.cend(); }
+
+protected:
+    QVector<T> m_items;  //!< all items without gaps
+    QHash<T, int> m_slots;  //!< slot of each item in m_items
+};
+
+#endif // SLOTLIST_H
@@ -2,14 +2,24 @@
 
 #include "core/helpers/ObjectWithAttributes.h"
 #include "core/helpers/utils.h"
+#include "core/helpers/cbor_stream_utils.h"
 
 #include <QCborArray>
+#include <QDebug>
 
 
+// initialize static member attributes:
+QVector<SmartAttribute*> SmartAttribute::s_pendingNotifications;
+
 SmartAttribute::SmartAttribute(ObjectWithAttributes* owa, QString name, bool persistent)
     : QObject(owa->parent())
-    , m_name(name)
+    // the interned name shares its string data with all attributes of the same name:
+    , m_name(AttributeTable::nameOf(AttributeTable::internName(name)))
     , m_persistent(persistent)
+    , m_coalesced(false)
+    , m_notificationPending(false)
+    , m_notificationsPaused(false)
+    , m_changedWhilePaused(false)
 {
     owa->registerAttribute(this);
 }
@@ -18,10 +28,87 @@ SmartAttribute::SmartAttribute(void*, QObject* parent, QString name, bool persis
     : QObject(parent)
     , m_name(name)
     , m_persistent(persistent)
+    , m_coalesced(false)
+    , m_notificationPending(false)
+    , m_notificationsPaused(false)
+    , m_changedWhilePaused(false)
 {
 
 }
 
+SmartAttribute::~SmartAttribute() {
+    if (m_notificationPending) {
+        // the entry is removed in the next flush:
+        const int index = s_pendingNotifications.indexOf(this);
+        if (index >= 0) s_pendingNotifications[index] = nullptr;
+    }
+}
+
+void SmartAttribute::setNotificationMode(NotificationMode mode) {
+    m_coalesced = mode == NotificationMode::Coalesced;
+    if (m_coalesced && !m_valueChangedSignal.isValid()) {
+        // look up the signal of the subclass once to be able to emit it later:
+        const int signalIndex = metaObject()->indexOfSignal("valueChanged()");
+        if (signalIndex < 0) {
+            qWarning() << "Attribute" << m_name << "has no valueChanged() signal.";
+            m_coalesced = false;
+            return;
+        }
+        m_valueChangedSignal = metaObject()->method(signalIndex);
+    }
+}
+
+void SmartAttribute::setNotificationsPaused(bool paused) {
+    if (paused == m_notificationsPaused) return;
+    m_notificationsPaused = paused;
+    if (!paused && m_changedWhilePaused) {
+        m_changedWhilePaused = false;
+        // notified with the other changes of this frame:
+        if (m_coalesced) deferValueChangedSlow();
+    }
+}
+
+void SmartAttribute::flushPendingNotifications() {
+    // attributes that are changed again by a connected slot are notified in the next frame:
+    const int count = s_pendingNotifications.size();
+    for (int i = 0; i < count; ++i) {
+        SmartAttribute* attr = s_pendingNotifications[i];
+        // entries of deleted attributes are nullptr:
+        if (!attr) continue;
+        s_pendingNotifications[i] = nullptr;
+        attr->m_notificationPending = false;
+        attr->m_valueChangedSignal.invoke(attr, Qt::DirectConnection);
+    }
+    s_pendingNotifications.remove(0, count);
+}
+
+void SmartAttribute::deferValueChangedSlow() {
+    if (m_notificationPending) return;
+    if (m_notificationsPaused) {
+        m_changedWhilePaused = true;
+        return;
+    }
+    // without a connection (i.e. no QML binding) there is nothing to notify:
+    if (!isSignalConnected(m_valueChangedSignal)) return;
+    m_notificationPending = true;
+    s_pendingNotifications.append(this);
+}
+
+void SmartAttribute::writeTo(QCborStreamWriter& writer) const {
+    QCborMap state;
+    writeTo(state);
+    for (auto it = state.constBegin(); it != state.constEnd(); ++it) {
+        it.key().toCbor(writer);
+        it.value().toCbor(writer);
+    }
+}
+
+void SmartAttribute::readFrom(const QString& key, QCborStreamReader& reader) {
+    QCborMap state;
+    state[key] = QCborValue::fromCbor(reader);
+    readFrom(state);
+}
+
 DoubleAttribute::DoubleAttribute(ObjectWithAttributes* block, QString name, double initialValue, double min, double max, bool persistent)
     : SmartAttribute(block, name, persistent)
     , m_value(initialValue)
@@ -48,11 +135,20 @@ void DoubleAttribute::readFrom(const QCborMap& state) {
     setValue(state[m_name].toDouble());
 }
 
+void DoubleAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    writer.append(m_value);
+}
+
+void DoubleAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(QCborValue::fromCbor(reader).toDouble());
+}
+
 void DoubleAttribute::setValue(double value) {
     value = limit(m_min, value, m_max);
     if (value == m_value) return;
     m_value = limit(m_min, value, m_max);
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 
@@ -82,11 +178,20 @@ void IntegerAttribute::readFrom(const QCborMap& state) {
     setValue(int(state[m_name].toInteger()));
 }
 
+void IntegerAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    writer.append(qint64(m_value));
+}
+
+void IntegerAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(int(QCborValue::fromCbor(reader).toInteger()));
+}
+
 void IntegerAttribute::setValue(int value) {
     value = limit(m_min, value, m_max);
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 
@@ -112,10 +217,19 @@ void StringAttribute::readFrom(const QCborMap& state) {
     setValue(state[m_name].toString());
 }
 
+void StringAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    writer.append(QStringView(m_value));
+}
+
+void StringAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(readCborString(reader));
+}
+
 void StringAttribute::setValue(QString value) {
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 
@@ -141,10 +255,19 @@ void BoolAttribute::readFrom(const QCborMap& state) {
     setValue(state[m_name].toBool());
 }
 
+void BoolAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    writer.append(m_value);
+}
+
+void BoolAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(QCborValue::fromCbor(reader).toBool());
+}
+
 void BoolAttribute::setValue(bool value) {
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 RgbAttribute::RgbAttribute(ObjectWithAttributes* block, QString name, const RGB& initialValue, bool persistent)
@@ -174,6 +297,30 @@ void RgbAttribute::readFrom(const QCborMap& state) {
     setValue({r, g, b});
 }
 
+void RgbAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QString(m_name + "r"));
+    writer.append(m_value.r);
+    writer.append(QString(m_name + "g"));
+    writer.append(m_value.g);
+    writer.append(QString(m_name + "b"));
+    writer.append(m_value.b);
+}
+
+void RgbAttribute::readFrom(const QString& key, QCborStreamReader& reader) {
+    // the components are applied together in finishReading():
+    m_pendingState[key] = QCborValue::fromCbor(reader);
+}
+
+void RgbAttribute::finishReading() {
+    if (m_pendingState.isEmpty()) return;
+    readFrom(m_pendingState);
+    m_pendingState = QCborMap();
+}
+
+QStringList RgbAttribute::stateKeys() const {
+    return {m_name + "r", m_name + "g", m_name + "b"};
+}
+
 double RgbAttribute::hue() const {
     if (val() == 0.0 || sat() == 0.0) {
         return m_tempHsv.h;
@@ -185,9 +332,11 @@ double RgbAttribute::hue() const {
 void RgbAttribute::setHue(double value) {
     HSV hsv(m_value);
     hsv.h = value;
-    m_value = RGB(hsv);
+    const RGB newValue(hsv);
+    if (newValue == m_value && value == m_tempHsv.h) return;
+    m_value = newValue;
     m_tempHsv.h = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 double RgbAttribute::sat() const {
@@ -204,9 +353,11 @@ void RgbAttribute::setSat(double value) {
         hsv = HSV(m_tempHsv.h, m_tempHsv.s, m_value.max());
     }
     hsv.s = value;
-    m_value = RGB(hsv);
+    const RGB newValue(hsv);
+    if (newValue == m_value && value == m_tempHsv.s) return;
+    m_value = newValue;
     m_tempHsv.s = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void RgbAttribute::setVal(double value) {
@@ -215,15 +366,17 @@ void RgbAttribute::setVal(double value) {
         hsv = HSV(m_tempHsv.h, m_tempHsv.s, 0);
     }
     hsv.v = value;
-    m_value = RGB(hsv);
-    emit valueChanged();
+    setValue(RGB(hsv));
+}
+
+void RgbAttribute::setValue(const RGB& value) {
+    if (value == m_value) return;
+    m_value = value;
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void RgbAttribute::setQColor(QColor value) {
-    m_value.r = value.redF();
-    m_value.g = value.greenF();
-    m_value.b = value.blueF();
-    emit valueChanged();
+    setValue({value.redF(), value.greenF(), value.blueF()});
 }
 
 QColor RgbAttribute::getGlow() const {
@@ -263,17 +416,38 @@ void HsvAttribute::readFrom(const QCborMap& state) {
     setValue({h, s, v});
 }
 
+void HsvAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QString(m_name + "h"));
+    writer.append(m_value.h);
+    writer.append(QString(m_name + "s"));
+    writer.append(m_value.s);
+    writer.append(QString(m_name + "v"));
+    writer.append(m_value.v);
+}
+
+void HsvAttribute::readFrom(const QString& key, QCborStreamReader& reader) {
+    // the components are applied together in finishReading():
+    m_pendingState[key] = QCborValue::fromCbor(reader);
+}
+
+void HsvAttribute::finishReading() {
+    if (m_pendingState.isEmpty()) return;
+    readFrom(m_pendingState);
+    m_pendingState = QCborMap();
+}
+
+QStringList HsvAttribute::stateKeys() const {
+    return {m_name + "h", m_name + "s", m_name + "v"};
+}
+
 void HsvAttribute::setValue(const HSV& value) {
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void HsvAttribute::setQColor(QColor value) {
-    m_value.h = value.hueF();
-    m_value.s = value.saturationF();
-    m_value.v = value.valueF();
-    emit valueChanged();
+    setValue({value.hueF(), value.saturationF(), value.valueF()});
 }
 
 void HsvAttribute::mixHtp(const HSV& other) {
@@ -307,25 +481,35 @@ void StringListAttribute::readFrom(const QCborMap& state) {
     setValue(deserializeBinary<QStringList>(state[m_name].toByteArray()));
 }
 
+void StringListAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    writer.append(serializeBinary(m_value));
+}
+
+void StringListAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(deserializeBinary<QStringList>(readCborByteArray(reader)));
+}
+
 void StringListAttribute::setValue(QStringList value) {
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void StringListAttribute::append(const QString& value) {
     m_value.append(value);
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void StringListAttribute::removeOne(const QString& value) {
-    m_value.removeOne(value);
-    emit valueChanged();
+    if (!m_value.removeOne(value)) return;
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void StringListAttribute::clear() {
+    if (m_value.isEmpty()) return;
     m_value.clear();
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 VariantListAttribute::VariantListAttribute(ObjectWithAttributes* block, QString name, const QVariantList& initialValue, bool persistent)
@@ -350,23 +534,33 @@ void VariantListAttribute::readFrom(const QCborMap& state) {
     setValue(state[m_name].toArray().toVariantList());
 }
 
+void VariantListAttribute::writeTo(QCborStreamWriter& writer) const {
+    writer.append(QStringView(m_name));
+    QCborArray::fromVariantList(m_value).toCborValue().toCbor(writer);
+}
+
+void VariantListAttribute::readFrom(const QString&, QCborStreamReader& reader) {
+    setValue(QCborValue::fromCbor(reader).toArray().toVariantList());
+}
+
 void VariantListAttribute::setValue(QVariantList value) {
     if (value == m_value) return;
     m_value = value;
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void VariantListAttribute::append(const QVariant& value) {
     m_value.append(value);
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void VariantListAttribute::removeOne(const QVariant& value) {
-    m_value.removeOne(value);
-    emit valueChanged();
+    if (!m_value.removeOne(value)) return;
+    if (!deferValueChanged()) emit valueChanged();
 }
 
 void VariantListAttribute::clear() {
+    if (m_value.isEmpty()) return;
     m_value.clear();
-    emit valueChanged();
+    if (!deferValueChanged()) emit valueChanged();
 }
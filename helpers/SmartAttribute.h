@@ -5,8 +5,12 @@
 
 #include <QObject>
 #include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
 #include <QColor>
 #include <QVariantList>
+#include <QMetaMethod>
+#include <QVector>
 
 class ObjectWithAttributes;
 
@@ -15,8 +19,74 @@ class SmartAttribute : public QObject
     Q_OBJECT
 
 public:
+    /**
+     * @brief The NotificationMode enum defines when the valueChanged() signal is emitted.
+     *
+     * Coalesced is meant for attributes that are only displayed in the GUI and change often.
+     * Attributes that C++ code reacts to should stay Immediate, their slots would be called
+     * one frame late otherwise. Blocks pause the notifications while their GUI is hidden
+     * or they are suspended. GUI items that are only outside of the viewport are still notified,
+     * at most once per frame, because they have to be up-to-date when they become visible.
+     */
+    enum class NotificationMode {
+        Immediate,  //!< on every change (default)
+        Coalesced  //!< at most once per Engine frame and only if something is connected to it
+    };
+
     explicit SmartAttribute(ObjectWithAttributes* owa, QString name, bool persistent);
     explicit SmartAttribute(void*, QObject* parent, QString name, bool persistent);
+    ~SmartAttribute() override;
+
+    /**
+     * @brief setNotificationMode sets when valueChanged() is emitted,
+     * the coalesced mode is useful for attributes that change every frame (i.e. animations)
+     * @param mode the notification mode
+     */
+    void setNotificationMode(NotificationMode mode);
+    NotificationMode notificationMode() const { return m_coalesced ? NotificationMode::Coalesced : NotificationMode::Immediate; }
+
+    /**
+     * @brief setNotificationsPaused stops notifying changes in coalesced mode while i.e. the GUI
+     * of the block is hidden, a change in the meantime is notified when they are resumed
+     * (QML bindings of hidden items are still connected and would be evaluated otherwise)
+     * @param paused true to pause the notifications
+     */
+    void setNotificationsPaused(bool paused);
+
+    /**
+     * @brief flushPendingNotifications emits valueChanged() of all coalesced attributes
+     * that changed since the last call, called by the Engine once per frame
+     */
+    static void flushPendingNotifications();
+
+    /**
+     * @brief writeTo writes the value as key-value pairs directly to the surrounding map
+     * of a CBOR stream without creating an intermediate QCborMap
+     * (the default implementation uses writeTo(QCborMap&))
+     * @param writer the stream writer, positioned inside a map
+     */
+    virtual void writeTo(QCborStreamWriter& writer) const;
+
+    /**
+     * @brief readFrom reads the value of one of the keys returned by stateKeys() from a CBOR stream
+     * (the default implementation uses readFrom(const QCborMap&), attributes with more than
+     * one key have to override it and finishReading())
+     * @param key the key that has just been read
+     * @param reader the stream reader, positioned on the value
+     */
+    virtual void readFrom(const QString& key, QCborStreamReader& reader);
+
+    /**
+     * @brief finishReading is called after all keys of this attribute have been read from a stream,
+     * attributes with more than one key apply their value here to notify the change only once
+     */
+    virtual void finishReading() {}
+
+    /**
+     * @brief stateKeys returns the keys used by this attribute in a state map
+     * @return list of keys
+     */
+    virtual QStringList stateKeys() const { return {m_name}; }
 
 public slots:
     virtual void writeTo(QCborMap& state) const = 0;
@@ -27,8 +97,45 @@ public slots:
     QObject* block() const { return parent(); }
 
 protected:
+    /**
+     * @brief deferValueChanged has to be called before valueChanged() is emitted
+     * @return true if the signal must not be emitted now because it is coalesced
+     */
+    bool deferValueChanged() {
+        if (!m_coalesced) return false;
+        deferValueChangedSlow();
+        return true;
+    }
+
+    void deferValueChangedSlow();
+
     QString m_name;
     bool m_persistent;
+    /**
+     * @brief m_coalesced is true if the notification mode is Coalesced
+     */
+    bool m_coalesced;
+    /**
+     * @brief m_notificationPending is true if this attribute is in s_pendingNotifications
+     */
+    bool m_notificationPending;
+    /**
+     * @brief m_notificationsPaused is true if changes are not notified (see setNotificationsPaused())
+     */
+    bool m_notificationsPaused;
+    /**
+     * @brief m_changedWhilePaused is true if the value changed while the notifications were paused
+     */
+    bool m_changedWhilePaused;
+    /**
+     * @brief m_valueChangedSignal is the valueChanged() signal of the subclass, only set in coalesced mode
+     */
+    QMetaMethod m_valueChangedSignal;
+
+    /**
+     * @brief s_pendingNotifications contains the coalesced attributes that changed in this frame
+     */
+    static QVector<SmartAttribute*> s_pendingNotifications;
 };
 
 class DoubleAttribute : public SmartAttribute
@@ -45,6 +152,9 @@ public:
     operator double() const { return m_value; }
     DoubleAttribute& operator=(double value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
     void minChanged();
@@ -58,10 +168,10 @@ public slots:
     void setValue(double value);
 
     double getMin() const { return m_min; }
-    void setMin(double value) { m_min = value; emit minChanged(); }
+    void setMin(double value) { if (value == m_min) return; m_min = value; emit minChanged(); }
 
     double getMax() const { return m_max; }
-    void setMax(double value) { m_max = value; emit maxChanged(); }
+    void setMax(double value) { if (value == m_max) return; m_max = value; emit maxChanged(); }
 
 protected:
     double m_value;
@@ -84,6 +194,9 @@ public:
     operator int() const { return m_value; }
     IntegerAttribute& operator=(int value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
     void minChanged();
@@ -97,10 +210,10 @@ public slots:
     void setValue(int value);
 
     int getMin() const { return m_min; }
-    void setMin(int value) { m_min = value; emit minChanged(); }
+    void setMin(int value) { if (value == m_min) return; m_min = value; emit minChanged(); }
 
     int getMax() const { return m_max; }
-    void setMax(int value) { m_max = value; emit maxChanged(); }
+    void setMax(int value) { if (value == m_max) return; m_max = value; emit maxChanged(); }
 
 protected:
     int m_value;
@@ -121,6 +234,9 @@ public:
     operator QString() const { return m_value; }
     StringAttribute& operator=(QString value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
 
@@ -148,6 +264,9 @@ public:
     operator bool() const { return m_value; }
     BoolAttribute& operator=(bool value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
 
@@ -188,6 +307,11 @@ public:
     operator RGB() const { return m_value; }
     RgbAttribute& operator=(const RGB& value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+    virtual void finishReading() override;
+    virtual QStringList stateKeys() const override;
+
 signals:
     void valueChanged();
 
@@ -196,14 +320,14 @@ public slots:
     virtual void readFrom(const QCborMap& state) override;
 
     const RGB& getValue() const { return m_value; }
-    void setValue(const RGB& value) { m_value = value; emit valueChanged(); }  // TODO: check if equal
+    void setValue(const RGB& value);
 
     double red() const { return m_value.r; }
-    void setRed(double value) { m_value.r = value; emit valueChanged(); }
+    void setRed(double value) { setValue({value, m_value.g, m_value.b}); }
     double green() const { return m_value.g; }
-    void setGreen(double value) { m_value.g = value; emit valueChanged(); }
+    void setGreen(double value) { setValue({m_value.r, value, m_value.b}); }
     double blue() const { return m_value.b; }
-    void setBlue(double value) { m_value.b = value; emit valueChanged(); }
+    void setBlue(double value) { setValue({m_value.r, m_value.g, value}); }
 
     double hue() const;
     void setHue(double value);
@@ -219,11 +343,15 @@ public slots:
 
     double max() const { return m_value.max(); }
 
-    void mixHtp(const RGB& other) { m_value.mixHtp(other); emit valueChanged(); }
+    void mixHtp(const RGB& other) { RGB value = m_value; value.mixHtp(other); setValue(value); }
 
 protected:
     RGB m_value;
     HSV m_tempHsv;
+    /**
+     * @brief m_pendingState contains the components read from a stream until finishReading() is called
+     */
+    QCborMap m_pendingState;
 };
 
 
@@ -242,6 +370,11 @@ public:
     operator HSV() const { return m_value; }
     HsvAttribute& operator=(const HSV& value) { setValue(value); return *this; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+    virtual void finishReading() override;
+    virtual QStringList stateKeys() const override;
+
 signals:
     void valueChanged();
 
@@ -250,14 +383,14 @@ public slots:
     virtual void readFrom(const QCborMap& state) override;
 
     const HSV& getValue() const { return m_value; }
-    void setValue(const HSV& value);  // TODO: check if equal
+    void setValue(const HSV& value);
 
     double hue() const { return m_value.h; }
-    void setHue(double value) { m_value.h = value; emit valueChanged(); }
+    void setHue(double value) { setValue({value, m_value.s, m_value.v}); }
     double sat() const { return m_value.s; }
-    void setSat(double value) { m_value.s = value; emit valueChanged(); }
+    void setSat(double value) { setValue({m_value.h, value, m_value.v}); }
     double val() const { return m_value.v; }
-    void setVal(double value) { m_value.v = value; emit valueChanged(); }
+    void setVal(double value) { setValue({m_value.h, m_value.s, value}); }
 
     QColor getQColor() const { return QColor::fromHsvF(m_value.h, m_value.s, m_value.v); }
     void setQColor(QColor value);
@@ -266,6 +399,10 @@ public slots:
 
 protected:
     HSV m_value;
+    /**
+     * @brief m_pendingState contains the components read from a stream until finishReading() is called
+     */
+    QCborMap m_pendingState;
 };
 
 
@@ -283,6 +420,9 @@ public:
     QStringList* operator->() { return &m_value; }
     const QStringList* operator->() const { return &m_value; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
 
@@ -317,6 +457,9 @@ public:
     QVariantList* operator->() { return &m_value; }
     const QVariantList* operator->() const { return &m_value; }
 
+    virtual void writeTo(QCborStreamWriter& writer) const override;
+    virtual void readFrom(const QString& key, QCborStreamReader& reader) override;
+
 signals:
     void valueChanged();
 
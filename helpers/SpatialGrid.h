@@ -0,0 +1,152 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <QHash>
+#include <QRectF>
+#include <QVector>
+
+#include <cmath>
+
+
+/**
+ * @brief The SpatialGrid class is an index of rectangular items (i.e. blocks) in a uniform grid
+ * to find all items in an area without checking every item.
+ *
+ * Each item is stored in all cells it overlaps. Moving an item within its cells
+ * only updates its bounds, the cells are only changed when it crosses a cell border.
+ */
+template<typename T>
+class SpatialGrid {
+
+public:
+    /**
+     * @brief SpatialGrid creates an empty grid
+     * @param cellSize width and height of a cell, should be in the range of a typical item size
+     */
+    explicit SpatialGrid(double cellSize)
+        : m_cellSize(cellSize)
+    {}
+
+    /**
+     * @brief insert adds an item or updates its bounds if it already exists
+     * @param item the item
+     * @param bounds the area it covers
+     */
+    void insert(T item, const QRectF& bounds) {
+        const CellRange cells = cellRange(bounds);
+        auto it = m_entries.find(item);
+        if (it != m_entries.end()) {
+            it->bounds = bounds;
+            if (it->cells == cells) return;
+            removeFromCells(item, it->cells);
+            it->cells = cells;
+        } else {
+            m_entries.insert(item, Entry{bounds, cells});
+        }
+        for (int x = cells.left; x <= cells.right; ++x) {
+            for (int y = cells.top; y <= cells.bottom; ++y) {
+                m_cells[cellKey(x, y)].append(item);
+            }
+        }
+    }
+
+    /**
+     * @brief remove removes an item, nothing happens if it doesn't exist
+     * @param item the item
+     */
+    void remove(T item) {
+        auto it = m_entries.find(item);
+        if (it == m_entries.end()) return;
+        removeFromCells(item, it->cells);
+        m_entries.erase(it);
+    }
+
+    bool contains(T item) const { return m_entries.contains(item); }
+
+    /**
+     * @brief bounds returns the bounds of an item
+     * @param item the item
+     * @return the bounds or an empty rect if it doesn't exist
+     */
+    QRectF bounds(T item) const { return m_entries.value(item).bounds; }
+
+    int size() const { return m_entries.size(); }
+
+    void clear() {
+        m_cells.clear();
+        m_entries.clear();
+    }
+
+    /**
+     * @brief forEachIn calls a function once for each item in the cells overlapping an area,
+     * the items still have to be checked against the exact area
+     * @param area the area to look in
+     * @param function called with the item and its bounds
+     */
+    template<typename Function>
+    void forEachIn(const QRectF& area, Function function) const {
+        const CellRange cells = cellRange(area);
+        const qint64 cellCount = qint64(cells.right - cells.left + 1) * (cells.bottom - cells.top + 1);
+        if (cellCount > m_cells.size()) {
+            // the area is larger than the occupied part of the grid (i.e. zoomed out):
+            for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+                function(it.key(), it->bounds);
+            }
+            return;
+        }
+        for (int x = cells.left; x <= cells.right; ++x) {
+            for (int y = cells.top; y <= cells.bottom; ++y) {
+                auto cell = m_cells.constFind(cellKey(x, y));
+                if (cell == m_cells.constEnd()) continue;
+                for (T item: cell.value()) {
+                    const CellRange& itemCells = m_entries[item].cells;
+                    // an item in multiple cells is only reported in the first cell it shares with the area:
+                    if (x != qMax(itemCells.left, cells.left) || y != qMax(itemCells.top, cells.top)) continue;
+                    function(item, m_entries[item].bounds);
+                }
+            }
+        }
+    }
+
+protected:
+    struct CellRange {
+        int left;
+        int top;
+        int right;
+        int bottom;
+        bool operator==(const CellRange& other) const {
+            return left == other.left && top == other.top && right == other.right && bottom == other.bottom;
+        }
+    };
+
+    struct Entry {
+        QRectF bounds;
+        CellRange cells;
+    };
+
+    CellRange cellRange(const QRectF& rect) const {
+        return CellRange{int(std::floor(rect.left() / m_cellSize)), int(std::floor(rect.top() / m_cellSize)),
+                         int(std::floor(rect.right() / m_cellSize)), int(std::floor(rect.bottom() / m_cellSize))};
+    }
+
+    static qint64 cellKey(int x, int y) {
+        return (qint64(x) << 32) | quint32(y);
+    }
+
+    void removeFromCells(T item, const CellRange& cells) {
+        for (int x = cells.left; x <= cells.right; ++x) {
+            for (int y = cells.top; y <= cells.bottom; ++y) {
+                auto cell = m_cells.find(cellKey(x, y));
+                if (cell == m_cells.end()) continue;
+                cell->removeOne(item);
+                if (cell->isEmpty()) m_cells.erase(cell);
+            }
+        }
+    }
+
+    const double m_cellSize;
+    QHash<qint64, QVector<T>> m_cells;
+    QHash<T, Entry> m_entries;
+};
+
+#endif // SPATIALGRID_H
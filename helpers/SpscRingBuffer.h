@@ -0,0 +1,90 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <vector>
+
+
+/**
+ * @brief The SpscRingBuffer class is a lock-free queue with a fixed capacity
+ * for exactly one producer thread and one consumer thread.
+ *
+ * push() must only be called by the producer and pop() only by the consumer.
+ * The elements are moved in and out of preallocated slots, so no memory is allocated
+ * when the queue is used (besides the one of the elements themselves).
+ */
+template<typename T>
+class SpscRingBuffer {
+
+    Q_DISABLE_COPY(SpscRingBuffer)
+
+public:
+    /**
+     * @brief SpscRingBuffer creates an empty queue
+     * @param capacity maximum number of elements in the queue
+     */
+    explicit SpscRingBuffer(std::size_t capacity)
+        : m_slots(capacity + 1)  // one slot always stays empty to distinguish full from empty
+        , m_head(0)
+        , m_tail(0)
+    {}
+
+    /**
+     * @brief push adds an element to the end of the queue (producer only)
+     * @param value element to move into the queue
+     * @return false if the queue is full, value is not modified in that case
+     */
+    bool push(T& value) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::size_t next = increment(tail);
+        if (next == m_head.load(std::memory_order_acquire)) return false;
+        m_slots[tail] = std::move(value);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief pop removes the first element of the queue (consumer only)
+     * @param value the element is moved to this variable
+     * @return false if the queue is empty
+     */
+    bool pop(T& value) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        value = std::move(m_slots[head]);
+        // release the resources of the element before the slot can be reused:
+        m_slots[head] = T();
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief isEmpty returns true if the queue is empty (exact only in the consumer thread)
+     * @return true if empty
+     */
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+protected:
+    std::size_t increment(std::size_t index) const {
+        return (index + 1) % m_slots.size();
+    }
+
+    std::vector<T> m_slots;
+
+    /**
+     * @brief m_head is the index of the next element to pop (written by the consumer only),
+     * head and tail are in different cache lines to prevent false sharing
+     */
+    alignas(64) std::atomic<std::size_t> m_head;
+
+    /**
+     * @brief m_tail is the index of the next free slot (written by the producer only)
+     */
+    alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+#endif // SPSCRINGBUFFER_H
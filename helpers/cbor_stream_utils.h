@@ -0,0 +1,54 @@
+#ifndef CBOR_STREAM_UTILS_H
+#define CBOR_STREAM_UTILS_H
+
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QString>
+#include <QByteArray>
+
+
+// This file includes helper functions to read and write CBOR streams
+// without creating intermediate QCborValue containers.
+
+/**
+ * @brief readCborString reads a (possibly chunked) text string and advances to the next item,
+ * if the current item is not a string it is skipped
+ * @param reader positioned on the item to read
+ * @return the string or an empty string
+ */
+inline QString readCborString(QCborStreamReader& reader) {
+    if (!reader.isString()) {
+        reader.next();
+        return QString();
+    }
+    QString result;
+    QCborStreamReader::StringResult<QString> chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        result += chunk.data;
+        chunk = reader.readString();
+    }
+    return result;
+}
+
+/**
+ * @brief readCborByteArray reads a (possibly chunked) byte string and advances to the next item,
+ * if the current item is not a byte string it is skipped
+ * @param reader positioned on the item to read
+ * @return the bytes or an empty array
+ */
+inline QByteArray readCborByteArray(QCborStreamReader& reader) {
+    if (!reader.isByteArray()) {
+        reader.next();
+        return QByteArray();
+    }
+    QByteArray result;
+    QCborStreamReader::StringResult<QByteArray> chunk = reader.readByteArray();
+    while (chunk.status == QCborStreamReader::Ok) {
+        result += chunk.data;
+        chunk = reader.readByteArray();
+    }
+    return result;
+}
+
+#endif // CBOR_STREAM_UTILS_H
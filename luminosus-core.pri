@@ -26,13 +26,22 @@ HEADERS += \
     $$PWD/conversation/ConversationActionInterface.h \
     $$PWD/conversation/SystemOutput.h \
     $$PWD/conversation/UserInput.h \
+    $$PWD/helpers/MappedFile.h \
     $$PWD/helpers/ObjectWithAttributes.h \
+    $$PWD/helpers/PersistentStateMap.h \
+    $$PWD/helpers/ScaledImageCache.h \
+    $$PWD/helpers/SpscRingBuffer.h \
+    $$PWD/helpers/SlabAllocator.h \
+    $$PWD/helpers/SlotList.h \
+    $$PWD/helpers/SpatialGrid.h \
+    $$PWD/helpers/cbor_stream_utils.h \
     $$PWD/helpers/constants.h \
     $$PWD/helpers/qstring_literal.h \
     $$PWD/helpers/utils.h \
     $$PWD/manager/StatusManager.h \
     $$PWD/qtquick_items/BarGraphItem.h \
     $$PWD/qtquick_items/BezierCurve.h \
+    $$PWD/qtquick_items/BlockOverviewItem.h \
     $$PWD/qtquick_items/ColoredPointsItem.h \
     $$PWD/qtquick_items/CustomImagePainter.h \
     $$PWD/qtquick_items/IrregularCircleItem.h \
@@ -57,7 +66,10 @@ HEADERS += \
     $$PWD/connections/NodeData.h \
     $$PWD/connections/Nodes.h \
     $$PWD/helpers/AsyncWebSocket.h \
+    $$PWD/helpers/AttributeTable.h \
+    $$PWD/helpers/ConnectedComponentIndex.h \
     $$PWD/helpers/QCircularBuffer.h \
+    $$PWD/helpers/RecordBuffer.h \
     $$PWD/helpers/SmartAttribute.h \
     $$PWD/helpers/application_setup.h \
     $$PWD/manager/AnchorManager.h \
@@ -67,10 +79,15 @@ HEADERS += \
     $$PWD/manager/FileSystemManager.h \
     $$PWD/manager/GuiManager.h \
     $$PWD/manager/HandoffManager.h \
+    $$PWD/manager/GuiItemPool.h \
     $$PWD/manager/KeyboardEmulator.h \
     $$PWD/manager/LogManager.h \
+    $$PWD/manager/ProjectHistory.h \
     $$PWD/manager/ProjectManager.h \
     $$PWD/manager/WebsocketConnection.h \
+    $$PWD/manager/WebsocketBroadcaster.h \
+    $$PWD/manager/WebsocketFileServer.h \
+    $$PWD/manager/NodeDataStreamer.h \
     $$PWD/qtquick_items/scenegraph/paintedrectangleitem.h \
     $$PWD/qtquick_items/scenegraph/shadowedborderrectanglematerial.h \
     $$PWD/qtquick_items/scenegraph/shadowedbordertexturematerial.h \
@@ -87,11 +104,16 @@ SOURCES += \
     $$PWD/conversation/Command.cpp \
     $$PWD/conversation/SystemOutput.cpp \
     $$PWD/conversation/UserInput.cpp \
+    $$PWD/helpers/MappedFile.cpp \
+    $$PWD/helpers/SlabAllocator.cpp \
     $$PWD/helpers/ObjectWithAttributes.cpp \
+    $$PWD/helpers/PersistentStateMap.cpp \
+    $$PWD/helpers/ScaledImageCache.cpp \
     $$PWD/helpers/qstring_literal.cpp \
     $$PWD/manager/StatusManager.cpp \
     $$PWD/qtquick_items/BarGraphItem.cpp \
     $$PWD/qtquick_items/BezierCurve.cpp \
+    $$PWD/qtquick_items/BlockOverviewItem.cpp \
     $$PWD/qtquick_items/ColoredPointsItem.cpp \
     $$PWD/qtquick_items/CustomImagePainter.cpp \
     $$PWD/qtquick_items/IrregularCircleItem.cpp \
@@ -115,6 +137,9 @@ SOURCES += \
     $$PWD/connections/NodeData.cpp \
     $$PWD/connections/Nodes.cpp \
     $$PWD/helpers/AsyncWebSocket.cpp \
+    $$PWD/helpers/AttributeTable.cpp \
+    $$PWD/helpers/ConnectedComponentIndex.cpp \
+    $$PWD/helpers/RecordBuffer.cpp \
     $$PWD/helpers/SmartAttribute.cpp \
     $$PWD/helpers/application_setup.cpp \
     $$PWD/manager/AnchorManager.cpp \
@@ -124,10 +149,15 @@ SOURCES += \
     $$PWD/manager/FileSystemManager.cpp \
     $$PWD/manager/GuiManager.cpp \
     $$PWD/manager/HandoffManager.cpp \
+    $$PWD/manager/GuiItemPool.cpp \
     $$PWD/manager/KeyboardEmulator.cpp \
     $$PWD/manager/LogManager.cpp \
+    $$PWD/manager/ProjectHistory.cpp \
     $$PWD/manager/ProjectManager.cpp \
     $$PWD/manager/WebsocketConnection.cpp \
+    $$PWD/manager/WebsocketBroadcaster.cpp \
+    $$PWD/manager/WebsocketFileServer.cpp \
+    $$PWD/manager/NodeDataStreamer.cpp \
     $$PWD/qtquick_items/scenegraph/paintedrectangleitem.cpp \
     $$PWD/qtquick_items/scenegraph/shadowedborderrectanglematerial.cpp \
     $$PWD/qtquick_items/scenegraph/shadowedbordertexturematerial.cpp \
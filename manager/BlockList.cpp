@@ -3,15 +3,80 @@
 #include "core/CoreController.h"
 #include "core/helpers/qstring_literal.h"
 
-#include <QCborArray>
-#include <QCborMap>
 #include <QJsonArray>
+#include <QJsonObject>
 #include <QJsonDocument>
 
+#include <algorithm>
+
+
+namespace BlockListConstants {
+    // scores of the different kinds of matches, higher is better:
+    const int exactMatchBonus = 200;
+    const int nameInUiPrefixScore = 800;
+    const int typeNamePrefixScore = 750;
+    const int wordPrefixScore = 600;
+    const int categoryPrefixScore = 400;
+    const int nameSubstringScore = 300;
+    const int categorySubstringScore = 200;
+    const int fuzzyMatchScore = 100;
+    /**
+     * @brief minSubstringQueryLength is the minimum length of a query to look for substrings and fuzzy matches
+     */
+    const int minSubstringQueryLength = 3;
+}
+
+// create a shorter alias for the constants namespace:
+namespace BLC = BlockListConstants;
+
+namespace {
+
+/**
+ * @brief words splits a name into lower case words at non-alphanumeric characters
+ * and camel case boundaries (i.e. "DmxOutput 2" -> "dmx", "output", "2")
+ */
+QStringList words(const QString& name) {
+    QStringList result;
+    QString word;
+    for (int i = 0; i < name.size(); ++i) {
+        const QChar c = name[i];
+        if (!c.isLetterOrNumber()) {
+            if (!word.isEmpty()) result.append(word);
+            word.clear();
+            continue;
+        }
+        if (c.isUpper() && i > 0 && name[i - 1].isLower() && !word.isEmpty()) {
+            result.append(word);
+            word.clear();
+        }
+        word.append(c.toLower());
+    }
+    if (!word.isEmpty()) result.append(word);
+    return result;
+}
+
+/**
+ * @brief fuzzyMatchSpan checks if all characters of the query appear in the text in the same order
+ * @return the length of the shortest part of the text starting at the first match that contains them, or -1
+ */
+int fuzzyMatchSpan(const QString& text, const QString& query) {
+    int start = -1;
+    int pos = 0;
+    for (const QChar c: query) {
+        pos = text.indexOf(c, pos);
+        if (pos < 0) return -1;
+        if (start < 0) start = pos;
+        ++pos;
+    }
+    return pos - start;
+}
+
+}  // namespace
+
 
 BlockList::BlockList()
     : QObject(nullptr)
-    , m_jsonBlockModelDeveloperMode(false)
+    , m_searchIndexIsValid(false)
 {
     checkAvailableDependencies();
 }
@@ -47,38 +112,73 @@ QString BlockList::getNameInUi(QString name) const {
 QString BlockList::getJsonBlockModel(bool developerMode) const {
 	// available blocks do not change at runtime
     // -> create model only if it doesn't already exist:
-    if (m_jsonBlockModel.isEmpty() || m_jsonBlockModelDeveloperMode != developerMode) {
-		QCborArray model;
-        for (const BlockInfo& info: m_orderedBlockList) {
-            if (!blockIsVisible(info, developerMode)) continue;
-			QCborMap jsonInfo;
-            jsonInfo["name"_q] = info.typeName;
-            jsonInfo["nameInUi"_q] = info.nameInUi;
-            jsonInfo["category"_q] = QCborArray::fromStringList(info.category);
-			model.append(jsonInfo);
-		}
-        m_jsonBlockModel = QJsonDocument(model.toJsonArray()).toJson();
-        m_jsonBlockModelDeveloperMode = developerMode;
+    QString& model = m_jsonBlockModels[developerMode ? 1 : 0];
+    if (model.isEmpty()) {
+        updateSearchIndex();
+        QByteArray json = "[";
+        for (const SearchEntry& entry: m_searchEntries) {
+            if (!(developerMode ? entry.visibleInDeveloperMode : entry.visible)) continue;
+            if (json.size() > 1) json.append(',');
+            json.append(entry.json);
+        }
+        json.append(']');
+        model = QString::fromUtf8(json);
 	}
-	return m_jsonBlockModel;
+	return model;
 }
 
 QString BlockList::getSearchResult(QString query, bool developerMode) const {
-	QString queryLow = query.toLower();
-	QCborArray result;
-    for (const BlockInfo& info: m_orderedBlockList) {
-        if (!blockIsVisible(info, developerMode)) continue;
-		// check for query:
-		if (blockMatchesQuery(info, queryLow)) {
-			// block matches query -> add it to result:
-			QCborMap jsonInfo;
-            jsonInfo["name"_q] = info.typeName;
-            jsonInfo["nameInUi"_q] = info.nameInUi;
-            jsonInfo["category"_q] = QCborArray::fromStringList(info.category);
-			result.append(jsonInfo);
-		}
-	}
-    return QJsonDocument(result.toJsonArray()).toJson();
+    const QString queryLow = query.trimmed().toLower();
+    if (queryLow.isEmpty()) return getJsonBlockModel(developerMode);
+    updateSearchIndex();
+
+    QVector<int> scores(m_searchEntries.size(), 0);
+
+    // prefixes of names and words, all tokens with this prefix are next to each other:
+    auto it = std::lower_bound(m_searchTokens.constBegin(), m_searchTokens.constEnd(), queryLow,
+                               [](const SearchToken& token, const QString& prefix) { return token.token < prefix; });
+    for (; it != m_searchTokens.constEnd() && it->token.startsWith(queryLow); ++it) {
+        const int score = it->score + (it->token.size() == queryLow.size() ? BLC::exactMatchBonus : 0);
+        scores[it->entry] = std::max(scores[it->entry], score);
+    }
+
+    if (queryLow.size() >= BLC::minSubstringQueryLength) {
+        for (int i = 0; i < m_searchEntries.size(); ++i) {
+            if (scores[i] > 0) continue;
+            const SearchEntry& entry = m_searchEntries[i];
+            if (entry.nameInUi.contains(queryLow) || entry.typeName.contains(queryLow)) {
+                scores[i] = BLC::nameSubstringScore;
+            } else if (entry.category.contains(queryLow)) {
+                scores[i] = BLC::categorySubstringScore;
+            } else {
+                // fuzzy: all characters in the same order, the closer together the better:
+                const int span = fuzzyMatchSpan(entry.nameInUi, queryLow);
+                if (span > 0 && span <= queryLow.size() * 3) {
+                    scores[i] = BLC::fuzzyMatchScore - (span - queryLow.size());
+                }
+            }
+        }
+    }
+
+    QVector<int> matches;
+    for (int i = 0; i < m_searchEntries.size(); ++i) {
+        if (scores[i] <= 0) continue;
+        const SearchEntry& entry = m_searchEntries[i];
+        if (!(developerMode ? entry.visibleInDeveloperMode : entry.visible)) continue;
+        matches.append(i);
+    }
+    // best matches first, otherwise in the usual order:
+    std::stable_sort(matches.begin(), matches.end(), [&scores](int lhs, int rhs) {
+        return scores[lhs] > scores[rhs];
+    });
+
+    QByteArray json = "[";
+    for (int i: matches) {
+        if (json.size() > 1) json.append(',');
+        json.append(m_searchEntries[i].json);
+    }
+    json.append(']');
+    return QString::fromUtf8(json);
 }
 
 QStringList BlockList::getAllBlockTypes() const {
@@ -99,8 +199,11 @@ bool BlockList::addBlock(const BlockInfo& info) {
         }
     }
     m_blockNames[info.typeName] = info;
-    m_orderedBlockList.append(info);
-    std::sort(m_orderedBlockList.begin(), m_orderedBlockList.end());
+    // insert after all blocks with the same or a lower order hint:
+    m_orderedBlockList.insert(std::upper_bound(m_orderedBlockList.begin(), m_orderedBlockList.end(), info), info);
+    m_searchIndexIsValid = false;
+    m_jsonBlockModels[0].clear();
+    m_jsonBlockModels[1].clear();
     return true;
 }
 
@@ -124,30 +227,6 @@ void BlockList::checkAvailableDependencies() {
     m_visibilityRequirements.insert(VisibilityRequirement::StandaloneVersion);
 }
 
-bool BlockList::blockMatchesQuery(const BlockInfo& info, const QString& query) const {
-	// depending on length of query:
-	if (query.size() < 3) {
-		// if query is shorter than 3 characters, look only for beginning of names:
-		if (info.typeName.toLower().startsWith(query)) {
-			return true;
-		} else if (info.nameInUi.toLower().startsWith(query)) {
-			return true;
-		} else if (!info.category.isEmpty() && info.category[0].toLower().startsWith(query)) {
-			return true;
-		}
-	} else {
-		// if query is 3 chars or longer, checks the whole strings for a match:
-		if (info.typeName.toLower().contains(query)) {
-			return true;
-		} else if (info.nameInUi.toLower().contains(query)) {
-			return true;
-		} else if (!info.category.isEmpty() && info.category[0].toLower().contains(query)) {
-			return true;
-		}
-	}
-    return false;
-}
-
 bool BlockList::blockIsVisible(const BlockInfo& info, bool developerMode) const {
     // check visibility:
     for (VisibilityRequirement visibility: info.visibilityRequirements) {
@@ -160,3 +239,41 @@ bool BlockList::blockIsVisible(const BlockInfo& info, bool developerMode) const
     }
     return true;
 }
+
+void BlockList::updateSearchIndex() const {
+    if (m_searchIndexIsValid) return;
+    m_searchEntries.clear();
+    m_searchTokens.clear();
+    m_searchEntries.reserve(m_orderedBlockList.size());
+
+    for (const BlockInfo& info: m_orderedBlockList) {
+        const int index = m_searchEntries.size();
+        SearchEntry entry;
+        entry.typeName = info.typeName.toLower();
+        entry.nameInUi = info.nameInUi.toLower();
+        entry.category = info.category.isEmpty() ? QString() : info.category[0].toLower();
+        entry.visible = blockIsVisible(info, false);
+        entry.visibleInDeveloperMode = blockIsVisible(info, true);
+
+        QJsonObject jsonInfo;
+        jsonInfo["name"_q] = info.typeName;
+        jsonInfo["nameInUi"_q] = info.nameInUi;
+        jsonInfo["category"_q] = QJsonArray::fromStringList(info.category);
+        entry.json = QJsonDocument(jsonInfo).toJson(QJsonDocument::Compact);
+
+        m_searchTokens.append({entry.nameInUi, index, BLC::nameInUiPrefixScore});
+        m_searchTokens.append({entry.typeName, index, BLC::typeNamePrefixScore});
+        for (const QString& word: words(info.nameInUi) + words(info.typeName)) {
+            m_searchTokens.append({word, index, BLC::wordPrefixScore});
+        }
+        for (const QString& word: words(entry.category)) {
+            m_searchTokens.append({word, index, BLC::categoryPrefixScore});
+        }
+        if (!entry.category.isEmpty()) {
+            m_searchTokens.append({entry.category, index, BLC::categoryPrefixScore});
+        }
+        m_searchEntries.append(entry);
+    }
+    std::sort(m_searchTokens.begin(), m_searchTokens.end());
+    m_searchIndexIsValid = true;
+}
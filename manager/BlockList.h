@@ -56,7 +56,8 @@ public slots:
     QString getJsonBlockModel(bool developerMode) const;
 
 	/**
-	 * @brief getSearchResult creates a JSON array of all blocks that match the query
+	 * @brief getSearchResult creates a JSON array of all blocks that match the query,
+	 * the best matches first (exact names, name prefixes, word prefixes, substrings, fuzzy matches)
 	 * @param query to find matching blocks
 	 * @return the string of a JSON array
 	 */
@@ -80,17 +81,35 @@ private:
 	 */
     void checkAvailableDependencies();
 
-	/**
-	 * @brief blockMatchesQuery checks if a block matches a query
-	 * (i.e. the query is part of the name etc.)
-	 * @param blockInfo the block
-	 * @param query i.e. text from a search field (should be all lower case)
-	 * @return true if the block matches that query
-	 */
-	bool blockMatchesQuery(const BlockInfo& info, const QString& query) const;
-
     bool blockIsVisible(const BlockInfo& info, bool developerMode) const;
 
+    /**
+     * @brief updateSearchIndex creates the search index of all blocks if it is not valid
+     */
+    void updateSearchIndex() const;
+
+    /**
+     * @brief The SearchEntry struct contains the normalized strings and the serialized model of a block.
+     */
+    struct SearchEntry {
+        QString typeName;  //!< lower case
+        QString nameInUi;  //!< lower case
+        QString category;  //!< lower case main category
+        bool visible;  //!< if it is visible without developer mode
+        bool visibleInDeveloperMode;
+        QByteArray json;  //!< JSON object of this block in the model
+    };
+
+    /**
+     * @brief The SearchToken struct is a word or name of a block that can be found by its prefix.
+     */
+    struct SearchToken {
+        QString token;  //!< lower case
+        int entry;  //!< index in m_searchEntries
+        int score;  //!< the rank of a match of this token
+        bool operator<(const SearchToken& other) const { return token < other.token; }
+    };
+
 
 protected:
 	/**
@@ -111,16 +130,28 @@ protected:
     QVector<BlockInfo> m_orderedBlockList;
 
 	/**
-	 * @brief m_jsonBlockModel is the cached result of getJsonBlockModel for all blocks
+	 * @brief m_jsonBlockModels are the cached results of getJsonBlockModel for all blocks,
+	 * without and with developer mode
 	 *
 	 * Is mutable because it is a cached result that doesn't change the objects state.
 	 */
-	mutable QString m_jsonBlockModel;
+	mutable QString m_jsonBlockModels[2];
+
+    /**
+     * @brief m_searchEntries contains an entry for each block in m_orderedBlockList in the same order
+     */
+    mutable QVector<SearchEntry> m_searchEntries;
+
+    /**
+     * @brief m_searchTokens contains the names and words of all blocks sorted alphabetically
+     * to find all tokens with a prefix by binary search
+     */
+    mutable QVector<SearchToken> m_searchTokens;
 
     /**
-     * @brief m_jsonBlockModelDeveloperMode true if developer mode was enabled when model was created
+     * @brief m_searchIndexIsValid is false if a block was added after the index was created
      */
-    mutable bool m_jsonBlockModelDeveloperMode;
+    mutable bool m_searchIndexIsValid;
 };
 
 
@@ -3,21 +3,35 @@
 #include "core/CoreController.h"
 #include "core/manager/BlockList.h"
 #include "core/manager/GuiManager.h"
+#include "core/manager/ProjectManager.h"
 #include "core/connections/Nodes.h"
 #include "core/helpers/SmartAttribute.h"
+#include "core/helpers/cbor_stream_utils.h"
+#include "core/helpers/SlabAllocator.h"
+#include "core/block_basics/BlockBase.h"
 #include "core/block_basics/GroupBlock.h"
+#include "core/qtquick_items/BlockOverviewItem.h"
 
 #include <QQmlEngine>
 #include <QQuickItem>
 #include <QQuickWindow>
 #include <QRandomGenerator>
+#include <QSet>
 
 
+// create a shorter alias for the constants namespace:
+namespace BMC = BlockManagerConstants;
+
 BlockManager::BlockManager(CoreController* controller)
     : QObject(dynamic_cast<QObject*>(controller))
     , m_blockList(BlockList::getInstance())
     , m_displayedGroup("")
     , m_blocksInDisplayedGroup()
+    , m_displayedBlocksIndex(BMC::spatialIndexCellSize)
+    , m_fullVisibilityUpdateNeeded(false)
+    , m_overviewScaleThreshold(BMC::defaultOverviewScaleThreshold)
+    , m_overviewIsActive(false)
+    , m_overviewNeedsUpdate(false)
 	, m_focusedBlock(nullptr)
     , m_controller(controller)
     , m_startChannel(1)
@@ -42,53 +56,119 @@ BlockManager::BlockManager(CoreController* controller)
 NodeBase* BlockManager::getNodeByUid(QString uid) {
     QString blockUid = uid.split("|").at(0);
     int nodeId = uid.split("|").at(1).toInt();
-    if (m_currentBlocksByUid.count(blockUid) == 0) return nullptr;
-    BlockInterface* block = m_currentBlocksByUid[blockUid];
+    BlockInterface* block = getBlockByUid(blockUid);
+    if (!block) return nullptr;
     return block->getNodeById(nodeId);
 }
 
 void BlockManager::updateBlockVisibility(QQuickItem* workspace) {
-    if (!m_hideBlocksOutsideViewports) return;
     if (!workspace) return;
+
+    // level of detail: far zoomed out, all blocks are drawn as rectangles by a single item:
+    const double scale = workspace->scale();
+    const bool overviewShouldBeActive = m_overviewIsActive
+            ? scale < m_overviewScaleThreshold + BMC::overviewScaleHysteresis
+            : scale < m_overviewScaleThreshold;
+    if (overviewShouldBeActive != m_overviewIsActive) {
+        setOverviewActive(overviewShouldBeActive, workspace);
+    }
+    if (m_overviewIsActive) {
+        updateSpatialIndex();
+        // GUI items of blocks added in the meantime:
+        for (BlockInterface* block: m_shownBlocks) {
+            if (block->getGuiItem()) block->getGuiItem()->setVisible(false);
+        }
+        m_shownBlocks.clear();
+        if (m_overviewNeedsUpdate) updateOverview();
+        return;
+    }
+
+    if (!m_hideBlocksOutsideViewports) return;
     const qreal left = workspace->x() * (-1) - 300;  // offset in negative direction
-    const qreal right = left + workspace->width() + 400;
     const qreal top = workspace->y() * (-1) - 300;  // offset in negative direction
-    const qreal bottom = top + workspace->height() + 400;
+    const QRectF showArea(left, top, workspace->width() + 400, workspace->height() + 400);
+    // blocks are hidden when they leave a larger area to not create and hide
+    // blocks near the border again and again:
+    const qreal hysteresis = BMC::visibilityHysteresis;
+    const QRectF hideArea = showArea.adjusted(-hysteresis, -hysteresis, hysteresis, hysteresis);
 
-    QVector<BlockInterface*> visibleBlocks;
+    updateSpatialIndex();
 
-    // check which block is inside the viewport and should be visible:
-    for (BlockInterface* block: m_blocksInDisplayedGroup) {
-        if (!block) continue;
-        QQuickItem* guiItem = block->getGuiItem();
-        if (block->renderIfNotVisible()) {
+    if (m_fullVisibilityUpdateNeeded) {
+        m_fullVisibilityUpdateNeeded = false;
+        m_shownBlocks.clear();
+        for (BlockInterface* block: m_blocksInDisplayedGroup) {
+            if (!block) continue;
+            QQuickItem* guiItem = block->getGuiItem();
             if (!guiItem) continue;
-            guiItem->setVisible(true);
-            continue;
+            if (block->renderIfNotVisible()) {
+                guiItem->setVisible(true);
+            } else if (!block->guiShouldBeHidden()) {
+                guiItem->setVisible(false);
+            }
         }
-        if (block->guiShouldBeHidden()) continue;
+    }
 
-        if (block->getGuiX() > right || (block->getGuiX() + block->getGuiWidth()) < left
-                || block->getGuiY() > bottom || (block->getGuiY() + block->getGuiHeight()) < top) {
-            // block is not in viewport
-            if (!guiItem) continue;
-            guiItem->setVisible(false);
-        } else {
-            // block is inside viewport
-            if (!guiItem) {
-                block->createGuiItem();
-                guiItem = block->getGuiItem();
-                if (!guiItem) continue;
+    auto isInHideArea = [this, &hideArea](BlockInterface* block) {
+        return hideArea.intersects(m_displayedBlocksIndex.bounds(block));
+    };
+
+    // hide blocks that left the viewport, except the ones connected to inputs of visible blocks
+    // because their output nodes are responsible for drawing the connection lines:
+    QVector<BlockInterface*> leavingBlocks;
+    for (BlockInterface* block: m_shownBlocks) {
+        if (isInHideArea(block)) continue;
+        bool drawsVisibleConnection = false;
+        for (NodeBase* node: block->getNodes()) {
+            if (!node || !node->isOutput()) continue;
+            for (NodeBase* inputNode: node->getConnectedNodes()) {
+                if (!inputNode) continue;
+                BlockInterface* inputBlock = inputNode->getBlock();
+                if (m_shownBlocks.contains(inputBlock) && isInHideArea(inputBlock)) {
+                    drawsVisibleConnection = true;
+                    break;
+                }
             }
-            guiItem->setVisible(true);
-            visibleBlocks.append(block);
+            if (drawsVisibleConnection) break;
         }
+        if (!drawsVisibleConnection) leavingBlocks.append(block);
+    }
+    for (BlockInterface* block: leavingBlocks) {
+        m_shownBlocks.remove(block);
+        QQuickItem* guiItem = block->getGuiItem();
+        if (guiItem) guiItem->setVisible(false);
     }
 
-    // iterate over all visible blocks and make the blocks connected to their input nodes
-    // also visible because their output nodes are responsible for drawing the connection lines:
-    for (BlockInterface* block: visibleBlocks) {
-        block->makeBlocksConnectedToInputsVisible();
+    // show blocks that entered the viewport:
+    QVector<BlockInterface*> enteringBlocks;
+    m_displayedBlocksIndex.forEachIn(showArea, [this, &showArea, &enteringBlocks](BlockInterface* block, const QRectF& bounds) {
+        if (!showArea.intersects(bounds) || m_shownBlocks.contains(block)) return;
+        if (block->guiShouldBeHidden()) return;
+        enteringBlocks.append(block);
+    });
+    for (BlockInterface* block: enteringBlocks) {
+        QQuickItem* guiItem = block->getGuiItem();
+        if (!guiItem) {
+            block->createGuiItem();
+            guiItem = block->getGuiItem();
+            if (!guiItem) continue;
+        }
+        guiItem->setVisible(true);
+        m_shownBlocks.insert(block);
+    }
+
+    // make the blocks connected to the input nodes of new visible blocks also visible:
+    for (BlockInterface* block: enteringBlocks) {
+        for (NodeBase* node: block->getNodes()) {
+            if (!node || node->isOutput()) continue;
+            for (NodeBase* outputNode: node->getConnectedNodes()) {
+                if (!outputNode) continue;
+                BlockInterface* otherBlock = outputNode->getBlock();
+                if (!otherBlock || !otherBlock->getGuiItem()) continue;
+                otherBlock->getGuiItem()->setVisible(true);
+                if (m_displayedBlocksIndex.contains(otherBlock)) m_shownBlocks.insert(otherBlock);
+            }
+        }
     }
 }
 
@@ -106,6 +186,10 @@ bool BlockManager::isInViewport(QQuickItem* workspace, BlockInterface* block) co
 
 void BlockManager::setHideBlocksOutsideViewports(bool value) {
     m_hideBlocksOutsideViewports = value;
+    // the shown blocks are not tracked anymore:
+    m_fullVisibilityUpdateNeeded = true;
+    // the overview hides all GUI items anyway:
+    if (m_overviewIsActive) return;
 
     if (!m_hideBlocksOutsideViewports) {  // FIXME: showing all blocks on double click is slow for many blocks
         for (BlockInterface* block: m_blocksInDisplayedGroup) {
@@ -121,6 +205,90 @@ void BlockManager::setHideBlocksOutsideViewports(bool value) {
     }
 }
 
+void BlockManager::setOverviewScaleThreshold(double value) {
+    if (value == m_overviewScaleThreshold) return;
+    m_overviewScaleThreshold = value;
+    emit overviewScaleThresholdChanged();
+    updateBlockVisibility(m_controller->guiManager()->getWorkspaceItem());
+}
+
+void BlockManager::setOverviewActive(bool active, QQuickItem* workspace) {
+    m_overviewIsActive = active;
+    if (active) {
+        if (!m_overviewItem) {
+            m_overviewItem = new BlockOverviewItem(workspace);
+        }
+        m_overviewItem->setParentItem(workspace);
+        m_overviewItem->setVisible(true);
+        // suspend the GUI items, hidden items are not rendered or synchronized with the scene graph:
+        for (BlockInterface* block: m_blocksInDisplayedGroup) {
+            if (!block || block->renderIfNotVisible()) continue;
+            if (block->getGuiItem()) block->getGuiItem()->setVisible(false);
+        }
+        m_shownBlocks.clear();
+        m_overviewNeedsUpdate = true;
+    } else {
+        if (m_overviewItem) {
+            m_overviewItem->setVisible(false);
+            // release the geometry while it is not needed:
+            m_overviewItem->setContent({}, {}, {});
+        }
+        if (m_hideBlocksOutsideViewports) {
+            // all GUI items are hidden, the next update shows the ones in the viewport again:
+            m_fullVisibilityUpdateNeeded = true;
+        } else {
+            // there is no viewport update that would show them again:
+            for (BlockInterface* block: m_blocksInDisplayedGroup) {
+                if (!block || block->guiShouldBeHidden()) continue;
+                if (block->getGuiItem()) block->getGuiItem()->setVisible(true);
+            }
+        }
+    }
+    emit overviewActiveChanged();
+}
+
+void BlockManager::updateOverview() {
+    m_overviewNeedsUpdate = false;
+    if (!m_overviewItem) return;
+
+    auto boundsOf = [this](BlockInterface* block) {
+        if (m_displayedBlocksIndex.contains(block)) return m_displayedBlocksIndex.bounds(block);
+        return QRectF(block->getGuiX(), block->getGuiY(), block->getGuiWidth(), block->getGuiHeight());
+    };
+
+    QVector<QRectF> rects;
+    QVector<QColor> colors;
+    QVector<QLineF> lines;
+    rects.reserve(m_blocksInDisplayedGroup.size());
+    colors.reserve(m_blocksInDisplayedGroup.size());
+    // the color depends on the block type to be able to distinguish them:
+    QHash<QString, QColor> colorByType;
+    for (BlockInterface* block: m_blocksInDisplayedGroup) {
+        if (!block) continue;
+        const QRectF bounds = boundsOf(block);
+        rects.append(bounds);
+        const QString typeName = block->getBlockInfo().typeName;
+        auto colorIt = colorByType.find(typeName);
+        if (colorIt == colorByType.end()) {
+            colorIt = colorByType.insert(typeName, QColor::fromHsv(int(qHash(typeName) % 360), 90, 120));
+        }
+        colors.append(block == m_focusedBlock ? colorIt->lighter(170) : *colorIt);
+
+        // lines from the right side of this block to the left side of the connected blocks:
+        for (NodeBase* node: block->getNodes()) {
+            if (!node || !node->isOutput()) continue;
+            for (NodeBase* inputNode: node->getConnectedNodes()) {
+                if (!inputNode) continue;
+                BlockInterface* inputBlock = inputNode->getBlock();
+                if (!inputBlock || inputBlock->getGroup() != m_displayedGroup) continue;
+                const QRectF inputBounds = boundsOf(inputBlock);
+                lines.append(QLineF(bounds.right(), bounds.center().y(), inputBounds.left(), inputBounds.center().y()));
+            }
+        }
+    }
+    m_overviewItem->setContent(rects, colors, lines);
+}
+
 QString BlockManager::getDisplayedGroupLabel() {
     if (getDisplayedGroup() == "") return "Root";
     BlockInterface* groupBlock = getBlockByUid(getDisplayedGroup());
@@ -135,8 +303,7 @@ QString BlockManager::getDisplayedGroupLabel() {
 }
 
 void BlockManager::setDisplayedGroup(QString group) {
-    for (QPointer<BlockInterface>& block: m_blocksInDisplayedGroup) {
-        if (block.isNull()) continue;
+    for (BlockInterface* block: m_blocksInDisplayedGroup) {
 #ifdef RT_MIDI_AVAILABLE
         // don't destroy, only hide GUI item because MIDI mapping depends on it:
         QQuickItem* guiItem = block->getGuiItem();
@@ -146,14 +313,20 @@ void BlockManager::setDisplayedGroup(QString group) {
 #endif
     }
     m_blocksInDisplayedGroup.clear();
+    m_displayedBlocksIndex.clear();
+    m_blocksWithChangedGeometry.clear();
+    m_shownBlocks.clear();
+    m_fullVisibilityUpdateNeeded = true;
 
+    const QString previousGroup = m_displayedGroup;
     m_displayedGroup = group;
-    for (QPointer<BlockInterface>& block: m_currentBlocks) {
-        if (block.isNull()) continue;
-        if (block->getGroup() == group) {
-            m_blocksInDisplayedGroup.push_back(block);
-            emit block->positionChanged();
-        }
+    for (BlockInterface* block: getBlocksInGroup(previousGroup)) {
+        updateSuspendedState(block);
+    }
+    for (BlockInterface* block: getBlocksInGroup(group)) {
+        updateSuspendedState(block);
+        addToDisplayedGroup(block);
+        emit block->positionChanged();
     }
     updateBlockVisibility(m_controller->guiManager()->getWorkspaceItem());
     emit displayedGroupChanged();
@@ -170,24 +343,59 @@ void BlockManager::goToParentGroup() {
 }
 
 void BlockManager::setGroupOfBlock(BlockInterface* block, QString group) {
-    if (block->getGroup() == group) return;
-    if (block->getGroup() == getDisplayedGroup()) {
-        m_blocksInDisplayedGroup.removeAll(block);
+    setGroupOfBlocks({block}, group);
+}
+
+void BlockManager::setGroupOfBlocks(const QVector<BlockInterface*>& blocks, QString group) {
+    bool displayedGroupChanged = false;
+    bool edited = false;
+    for (BlockInterface* block: blocks) {
+        if (!block || block->getGroup() == group) continue;
+        if (block->getGroup() == getDisplayedGroup()) {
+            removeFromDisplayedGroup(block);
 #ifdef RT_MIDI_AVAILABLE
-        // don't destroy, only hide GUI item because MIDI mapping depends on it:
-        QQuickItem* guiItem = block->getGuiItem();
-        if (guiItem) guiItem->setVisible(false);
+            // don't destroy, only hide GUI item because MIDI mapping depends on it:
+            QQuickItem* guiItem = block->getGuiItem();
+            if (guiItem) guiItem->setVisible(false);
 #else
-        block->destroyGuiItem();
+            block->destroyGuiItem();
 #endif
+        }
+        block->setGroup(group);
+        if (group == getDisplayedGroup()) {
+            addToDisplayedGroup(block);
+            displayedGroupChanged = true;
+        }
+        edited = true;
     }
-    block->setGroup(group);
-    if (group == getDisplayedGroup()) {
-        m_blocksInDisplayedGroup.append(block);
+    if (edited) onProjectEdited();
+    if (displayedGroupChanged) {
         updateBlockVisibility(m_controller->guiManager()->getWorkspaceItem());
     }
 }
 
+QVector<BlockInterface*> BlockManager::getConnectedBlocks(BlockInterface* block) {
+    return m_connectedComponents.componentOf(block);
+}
+
+void BlockManager::onBlocksConnected(BlockInterface* block, BlockInterface* otherBlock) {
+    m_connectedComponents.onConnected(block, otherBlock);
+}
+
+void BlockManager::onBlocksDisconnected(BlockInterface* block, BlockInterface* otherBlock) {
+    auto neighboursOf = [](BlockInterface* block) {
+        QVector<BlockInterface*> neighbours;
+        for (const QPointer<NodeBase>& node: block->getNodes()) {
+            if (!node) continue;
+            for (const QPointer<NodeBase>& otherNode: node->getConnectedNodes()) {
+                if (otherNode) neighbours.append(otherNode->getBlock());
+            }
+        }
+        return neighbours;
+    };
+    m_connectedComponents.onDisconnected(block, otherBlock, neighboursOf);
+}
+
 BlockInterface* BlockManager::restoreBlock(const QCborMap& blockState, bool animated, bool connectOnAdd) {
 	QString blockType = blockState["name"].toString();
 	QString uid = blockState["uid"].toString();
@@ -204,16 +412,125 @@ BlockInterface* BlockManager::restoreBlock(const QCborMap& blockState, bool anim
     block->setState(internalState);
     block->setNodeMergeModes(blockState["nodeMergeModes"].toMap());
 
+    placeRestoredBlock(block, blockState["posX"].toDouble(), blockState["posY"].toDouble(),
+                       blockState["width"].toDouble(), blockState["height"].toDouble(),
+                       animated, connectOnAdd);
+
+	// focus the block if it was previously focused:
+	if (blockState["focused"].toBool()) {
+		focusBlock(block);
+    }
+
+	// return a pointer to the block instance:
+	return block;
+}
+
+BlockInterface* BlockManager::restoreBlock(QCborStreamReader& reader, bool animated) {
+    if (!reader.isMap()) {
+        qWarning() << "Block state is not a map.";
+        reader.next();
+        return nullptr;
+    }
+
+    QString blockType;
+    QString uid;
+    double posX = 0.0;
+    double posY = 0.0;
+    double width = 0.0;
+    double height = 0.0;
+    bool focused = false;
+    QString label;
+    QCborMap nodeMergeModes;
+    BlockInterface* block = nullptr;
+    bool creationFailed = false;
+    // only used if the internal state appears before the type and uid:
+    QCborMap bufferedInternalState;
+
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        if (!reader.isString()) {
+            // skip key and value:
+            reader.next();
+            reader.next();
+            continue;
+        }
+        const QString key = readCborString(reader);
+        if (key == "name") {
+            blockType = readCborString(reader);
+        } else if (key == "uid") {
+            uid = readCborString(reader);
+        } else if (key == "posX") {
+            posX = QCborValue::fromCbor(reader).toDouble();
+        } else if (key == "posY") {
+            posY = QCborValue::fromCbor(reader).toDouble();
+        } else if (key == "width") {
+            width = QCborValue::fromCbor(reader).toDouble();
+        } else if (key == "height") {
+            height = QCborValue::fromCbor(reader).toDouble();
+        } else if (key == "focused") {
+            focused = QCborValue::fromCbor(reader).toBool();
+        } else if (key == "label") {
+            label = readCborString(reader);
+        } else if (key == "nodeMergeModes") {
+            nodeMergeModes = QCborValue::fromCbor(reader).toMap();
+        } else if (key == "internalState" && !blockType.isEmpty() && !uid.isEmpty() && label.isEmpty()
+                   && !block && !creationFailed) {
+            // the usual case: create the block and stream the state directly into it
+            block = createBlockInstance(blockType, uid);
+            if (block) {
+                block->readState(reader);
+            } else {
+                creationFailed = true;
+                reader.next();
+            }
+        } else if (key == "internalState") {
+            bufferedInternalState = QCborValue::fromCbor(reader).toMap();
+        } else {
+            reader.next();
+        }
+    }
+    reader.leaveContainer();
+
+    // downward comptability for "label", it is merged into the internal state
+    // before it is applied like in restoreBlock(QCborMap):
+    if (!block && !creationFailed) {
+        block = createBlockInstance(blockType, uid);
+        if (block) {
+            if (!label.isEmpty()) bufferedInternalState["label"_q] = label;
+            block->setState(bufferedInternalState);
+        }
+    } else if (block && !label.isEmpty()) {
+        // the label came after the streamed state (only in old files), apply the merged state again:
+        QCborMap internalState = block->getState();
+        internalState["label"_q] = label;
+        block->setState(internalState);
+    }
+    if (!block) {
+        qWarning() << "Could not create block instance of type: " << blockType;
+        return nullptr;
+    }
+    block->setNodeMergeModes(nodeMergeModes);
+
+    placeRestoredBlock(block, posX, posY, width, height, animated, /*connectOnAdd*/ false);
+
+    if (focused) {
+        focusBlock(block);
+    }
+    return block;
+}
+
+void BlockManager::placeRestoredBlock(BlockInterface* block, double posX, double posY, double width, double height,
+                                      bool animated, bool connectOnAdd) {
     // determ final position of the block:
     double dp = m_controller->guiManager()->getGuiScaling();
-    int finalX = int(blockState["posX"].toDouble() * dp);
-    int finalY = int(blockState["posY"].toDouble() * dp);
+    int finalX = int(posX * dp);
+    int finalY = int(posY * dp);
 
     // ------ GUI:
     block->setGuiX(finalX);
     block->setGuiY(finalY);
-    block->setGuiWidth(blockState["width"].toDouble() * dp);
-    block->setGuiHeight(blockState["height"].toDouble() * dp);
+    block->setGuiWidth(width * dp);
+    block->setGuiHeight(height * dp);
     block->setGuiParentItem(m_controller->guiManager()->getWorkspaceItem());
 #ifdef RT_MIDI_AVAILABLE
     // always create GUI because MIDI mapping depends on it:
@@ -222,22 +539,22 @@ BlockInterface* BlockManager::restoreBlock(const QCborMap& blockState, bool anim
     if (guiItem) {
         guiItem->setVisible(false);
         if (block->getGroup() == getDisplayedGroup()) {
-            m_blocksInDisplayedGroup.push_back(block);
             if (isInViewport(m_controller->guiManager()->getWorkspaceItem(), block)
                     || block->renderIfNotVisible()) {
                 guiItem->setVisible(true);
             }
+            addToDisplayedGroup(block);
         }
     }
 #else
+    if (block->renderIfNotVisible()) {
+        block->createGuiItem();
+    }
     if (block->getGroup() == getDisplayedGroup()) {
-        m_blocksInDisplayedGroup.push_back(block);
         if (isInViewport(m_controller->guiManager()->getWorkspaceItem(), block)) {
             block->createGuiItem();
         }
-    }
-    if (block->renderIfNotVisible()) {
-        block->createGuiItem();
+        addToDisplayedGroup(block);
     }
 #endif
     // ------ End GUI
@@ -271,14 +588,46 @@ BlockInterface* BlockManager::restoreBlock(const QCborMap& blockState, bool anim
         block->setGuiX(finalX);
         block->setGuiY(finalY);
 	}
+    // the position is not always notified if the block has no GUI item:
+    if (m_displayedBlocksIndex.contains(block) || block->getGroup() == getDisplayedGroup()) {
+        m_blocksWithChangedGeometry.insert(block);
+    }
+}
 
-	// focus the block if it was previously focused:
-	if (blockState["focused"].toBool()) {
-		focusBlock(block);
+void BlockManager::addToDisplayedGroup(BlockInterface* block) {
+    m_blocksInDisplayedGroup.insert(block);
+    m_overviewNeedsUpdate = true;
+    // blocks that are always rendered are not culled:
+    if (block->renderIfNotVisible()) return;
+    m_blocksWithChangedGeometry.insert(block);
+    const QQuickItem* guiItem = block->getGuiItemConst();
+    if (guiItem && guiItem->isVisible()) {
+        // track it to be able to hide it when it is not in the viewport:
+        m_shownBlocks.insert(block);
     }
+}
 
-	// return a pointer to the block instance:
-	return block;
+void BlockManager::removeFromDisplayedGroup(BlockInterface* block) {
+    m_blocksInDisplayedGroup.remove(block);
+    m_overviewNeedsUpdate = true;
+    m_displayedBlocksIndex.remove(block);
+    m_blocksWithChangedGeometry.remove(block);
+    m_shownBlocks.remove(block);
+}
+
+void BlockManager::updateSpatialIndex() {
+    if (!m_blocksWithChangedGeometry.isEmpty()) m_overviewNeedsUpdate = true;
+    for (BlockInterface* block: m_blocksWithChangedGeometry) {
+        m_displayedBlocksIndex.insert(block, QRectF(block->getGuiX(), block->getGuiY(),
+                                                    block->getGuiWidth(), block->getGuiHeight()));
+    }
+    m_blocksWithChangedGeometry.clear();
+}
+
+void BlockManager::onBlockGeometryChanged() {
+    BlockInterface* block = static_cast<BlockInterface*>(sender());
+    if (!block || block->renderIfNotVisible() || block->getGroup() != getDisplayedGroup()) return;
+    m_blocksWithChangedGeometry.insert(block);
 }
 
 BlockInterface* BlockManager::addNewBlock(QString blockType, int randomOffset) {
@@ -296,8 +645,8 @@ BlockInterface* BlockManager::addNewBlock(QString blockType, int randomOffset) {
     block->setGuiY(blockListPos.y());
     block->setGuiParentItem(m_controller->guiManager()->getWorkspaceItem());
     block->setGroup(getDisplayedGroup());
-    m_blocksInDisplayedGroup.push_back(block);
     block->createGuiItem();
+    addToDisplayedGroup(block);
     // ------ End GUI
 
     if (randomOffset < 0) {
@@ -333,6 +682,7 @@ BlockInterface* BlockManager::addNewBlock(QString blockType, int randomOffset) {
     if (!getFocusedBlock()) {
         focusBlock(block);
     }
+    onProjectEdited();
 
 	// return a pointer to the block instance:
     return block;
@@ -345,12 +695,44 @@ BlockInterface* BlockManager::addBlockByNameQml(QString blockType) {
 }
 
 void BlockManager::deleteAllBlocks(bool immediate) {
-    // iterate over copy because map will be modified:
-    for (auto uid: m_currentBlocksByUid.keys()) {
-        deleteBlock(uid, /*forced*/ true, /*noRestore*/ true, /*immediate*/ immediate);
+    // clear all lists at once instead of removing each block from them,
+    // a GroupBlock then doesn't move its members to the parent group in onRemove():
+    std::vector<QPointer<BlockInterface>> blocks;
+    blocks.swap(m_currentBlocks);
+    m_slotByUid.clear();
+    m_blocksByGroup.clear();
+    m_connectedComponents.clear();
+    m_blocksInDisplayedGroup.clear();
+    m_displayedBlocksIndex.clear();
+    m_blocksWithChangedGeometry.clear();
+    m_shownBlocks.clear();
+    m_overviewNeedsUpdate = true;
+
+    for (BlockInterface* block: blocks) {
+        // the block could have been deleted by the removal of another one:
+        if (!block) continue;
+        releaseBlock(block, immediate);
+        if (immediate) {
+            delete block;
+        } else {
+            block->deleteLater();
+        }
+    }
+    emit blockInstanceCountChanged();
+    if (immediate) {
+        // all blocks and their nodes are deleted now, release their memory in bulk:
+        BlockBase::allocator().releaseEmptySlabs();
+        NodeBase::allocator().releaseEmptySlabs();
     }
 }
 
+QVariantMap BlockManager::getAllocationStatistics() const {
+    QVariantMap statistics;
+    statistics["blocks"] = BlockBase::allocator().getStatistics();
+    statistics["nodes"] = NodeBase::allocator().getStatistics();
+    return statistics;
+}
+
 void BlockManager::deleteBlock(BlockInterface* block, bool forced, bool noRestore, bool immediate) {
 	// check if it is allowed to remove the block:
     if (!forced && !block->mayBeRemoved()) return;
@@ -359,18 +741,9 @@ void BlockManager::deleteBlock(BlockInterface* block, bool forced, bool noRestor
         // store state to be able to restore it:
         m_lastDeletedBlockStates.append(getBlockState(block));
     }
-	// if block has Qt keyboard focus
-    if (block->getGuiItemConst() && block->getGuiItemConst()->property("activeFocus").toBool()) {
-        m_controller->guiManager()->setKeyboardFocusToWorkspace();
-	}
-
-    block->onRemove();
-    defocusBlock(block);
-    block->disconnectAllNodes();
-    block->destroyGuiItem(immediate);
-    m_currentBlocks.erase(std::find(m_currentBlocks.begin(), m_currentBlocks.end(), block));
-    m_currentBlocksByUid.remove(block->getUid());
-    m_blocksInDisplayedGroup.removeAll(block);
+    releaseBlock(block, immediate);
+    unregisterBlock(block);
+    removeFromDisplayedGroup(block);
     // TODO: check if deleteLater is better (but: blocks have to be deleted before new project is loaded!)
     // deleting it instantly leads to GUI warnings "cannot read property" because block is already deleted
     //block->deleteLater();
@@ -380,13 +753,83 @@ void BlockManager::deleteBlock(BlockInterface* block, bool forced, bool noRestor
         block->deleteLater();
     }
     emit blockInstanceCountChanged();
+    onProjectEdited();
 }
 
 void BlockManager::deleteBlock(QString uid, bool forced, bool noRestore, bool immediate) {
-    BlockInterface* block = m_currentBlocksByUid[uid];
+    BlockInterface* block = getBlockByUid(uid);
+    if (!block) {
+        qWarning() << "Tried to delete block that doesn't exist:" << uid;
+        return;
+    }
     deleteBlock(block, forced, noRestore, immediate);
 }
 
+void BlockManager::releaseBlock(BlockInterface* block, bool immediate) {
+	// if block has Qt keyboard focus
+    if (block->getGuiItemConst() && block->getGuiItemConst()->property("activeFocus").toBool()) {
+        m_controller->guiManager()->setKeyboardFocusToWorkspace();
+	}
+
+    block->onRemove();
+    defocusBlock(block);
+    block->disconnectAllNodes();
+    block->destroyGuiItem(immediate);
+    // a GUI item of this block in the pool would reference a deleted block:
+    m_controller->guiManager()->itemPool()->discardItemsOf(block, immediate);
+}
+
+void BlockManager::registerBlock(BlockInterface* block) {
+    m_slotByUid.insert(block->getUid(), int(m_currentBlocks.size()));
+    m_currentBlocks.push_back(block);
+    m_blocksByGroup[block->getGroup()].insert(block);
+    updateSuspendedState(block);
+}
+
+void BlockManager::updateSuspendedState(BlockInterface* block) {
+    if (!block->getBlockInfo().visualizationOnly) return;
+    block->setSuspended(block->getGroup() != m_displayedGroup);
+}
+
+void BlockManager::unregisterBlock(BlockInterface* block) {
+    auto it = m_slotByUid.find(block->getUid());
+    if (it == m_slotByUid.end() || m_currentBlocks[std::size_t(it.value())] != block) return;
+    const std::size_t slot = std::size_t(it.value());
+    m_slotByUid.erase(it);
+    const std::size_t lastSlot = m_currentBlocks.size() - 1;
+    if (slot != lastSlot) {
+        // move the last block into the free slot:
+        m_currentBlocks[slot] = m_currentBlocks[lastSlot];
+        if (m_currentBlocks[slot]) m_slotByUid[m_currentBlocks[slot]->getUid()] = int(slot);
+    }
+    m_currentBlocks.pop_back();
+
+    auto groupIt = m_blocksByGroup.find(block->getGroup());
+    if (groupIt != m_blocksByGroup.end()) {
+        groupIt->remove(block);
+        if (groupIt->isEmpty()) m_blocksByGroup.erase(groupIt);
+    }
+}
+
+QVector<BlockInterface*> BlockManager::getBlocksInGroup(const QString& group) const {
+    auto it = m_blocksByGroup.constFind(group);
+    if (it == m_blocksByGroup.constEnd()) return {};
+    return it->items();
+}
+
+void BlockManager::onBlockGroupChanged(BlockInterface* block, const QString& oldGroup) {
+    // blocks change their group during creation before they are registered:
+    const int slot = m_slotByUid.value(block->getUid(), -1);
+    if (slot < 0 || m_currentBlocks[std::size_t(slot)] != block) return;
+    auto oldIt = m_blocksByGroup.find(oldGroup);
+    if (oldIt != m_blocksByGroup.end()) {
+        oldIt->remove(block);
+        if (oldIt->isEmpty()) m_blocksByGroup.erase(oldIt);
+    }
+    m_blocksByGroup[block->getGroup()].insert(block);
+    updateSuspendedState(block);
+}
+
 void BlockManager::deleteFocusedBlock() {
     if (!m_focusedBlock) return;
     m_focusedBlock->deletedByUser();
@@ -401,7 +844,7 @@ void BlockManager::duplicateFocusedBlock() {
     state["posX"_q] = state["posX"_q].toDouble() + (std::rand() % 50);
     state["posY"_q] = state["posY"_q].toDouble() + (std::rand() % 50);
     restoreBlock(state, /*animated*/ true, /*connectOnAdd*/ true);
-
+    onProjectEdited();
 }
 
 void BlockManager::copyFocusedBlock() {
@@ -419,8 +862,12 @@ void BlockManager::pasteBlock() {
     double dp = m_controller->guiManager()->getGuiScaling();
     state["posX"_q] = spawn.x() / dp;
     state["posY"_q] = spawn.y() / dp;
-    BlockInterface* block = restoreBlock(state, /*animated*/ true, /*connectOnAdd*/ true);
-    setGroupOfBlock(block, getDisplayedGroup());
+    // paste into the displayed group, restoreBlock() assigns it before the GUI item is created:
+    QCborMap internalState = state["internalState"_q].toMap();
+    internalState["group"_q] = getDisplayedGroup();
+    state["internalState"_q] = internalState;
+    restoreBlock(state, /*animated*/ true, /*connectOnAdd*/ true);
+    onProjectEdited();
 }
 
 void BlockManager::restoreDeletedBlock() {
@@ -430,10 +877,87 @@ void BlockManager::restoreDeletedBlock() {
 	QCborMap state = m_lastDeletedBlockStates.last();
 	m_lastDeletedBlockStates.pop_back();
 	restoreBlock(state);
+    onProjectEdited();
+}
+
+void BlockManager::applyStateDelta(const QCborMap& changedBlocks, const QStringList& removedBlocks) {
+    for (const QString& uid: removedBlocks) {
+        BlockInterface* block = getBlockByUid(uid);
+        if (!block) continue;
+        deleteBlock(block, /*forced*/ true, /*noRestore*/ true);
+    }
+
+    const double dp = m_controller->guiManager()->getGuiScaling();
+    // connections from unchanged blocks to blocks that have to be recreated:
+    QStringList incomingConnections;
+
+    for (auto it = changedBlocks.constBegin(); it != changedBlocks.constEnd(); ++it) {
+        const QString uid = it.key().toString();
+        const QCborMap blockState = it.value().toMap();
+        BlockInterface* block = getBlockByUid(uid);
+        if (block && block->getBlockInfo().typeName != blockState["name"_q].toString()) {
+            // block type changed, it can't be updated in place:
+            for (NodeBase* node: block->getNodes()) {
+                if (!node || node->isOutput()) continue;
+                for (NodeBase* outputNode: node->getConnectedNodes()) {
+                    if (!outputNode) continue;
+                    incomingConnections.append(outputNode->getUid() + "->" + node->getUid());
+                }
+            }
+            deleteBlock(block, /*forced*/ true, /*noRestore*/ true);
+            block = nullptr;
+        }
+        if (!block) {
+            restoreBlock(blockState, /*animated*/ false);
+            continue;
+        }
+
+        // update existing block in place:
+        const QCborMap internalState = blockState["internalState"_q].toMap();
+        // change group before setState() to keep the list of displayed blocks in sync:
+        setGroupOfBlock(block, internalState["group"_q].toString());
+        if (!internalState["guiItemHidden"_q].toBool() && block->guiShouldBeHidden()) {
+            block->unhideGui();
+        }
+        block->setState(internalState);
+        block->setNodeMergeModes(blockState["nodeMergeModes"_q].toMap());
+        block->setGuiX(blockState["posX"_q].toDouble() * dp);
+        block->setGuiY(blockState["posY"_q].toDouble() * dp);
+        block->setGuiWidth(blockState["width"_q].toDouble() * dp);
+        block->setGuiHeight(blockState["height"_q].toDouble() * dp);
+        if (block->getGroup() == getDisplayedGroup()) m_blocksWithChangedGeometry.insert(block);
+    }
+
+    // update outgoing connections after all blocks exist:
+    for (auto it = changedBlocks.constBegin(); it != changedBlocks.constEnd(); ++it) {
+        BlockInterface* block = getBlockByUid(it.key().toString());
+        if (!block) continue;
+        QSet<QString> targetConnections;
+        for (QCborValueRef connection: it.value().toMap().value("connections"_q).toArray()) {
+            targetConnections.insert(connection.toString());
+        }
+        QSet<QString> currentConnections;
+        for (QCborValueRef connection: block->getConnections()) {
+            currentConnections.insert(connection.toString());
+        }
+        for (const QString& connection: currentConnections) {
+            if (!targetConnections.contains(connection)) setConnectionState(connection, false);
+        }
+        for (const QString& connection: targetConnections) {
+            if (!currentConnections.contains(connection)) setConnectionState(connection, true);
+        }
+    }
+    for (const QString& connection: incomingConnections) {
+        setConnectionState(connection, true);
+    }
+
+    updateBlockVisibility(m_controller->guiManager()->getWorkspaceItem());
 }
 
 BlockInterface* BlockManager::getBlockByUid(const QString& uid) {
-    return m_currentBlocksByUid.value(uid, nullptr);
+    const int slot = m_slotByUid.value(uid, -1);
+    if (slot < 0) return nullptr;
+    return m_currentBlocks[std::size_t(slot)];
 }
 
 QCborMap BlockManager::getBlockState(BlockInterface* block) const {
@@ -451,6 +975,35 @@ QCborMap BlockManager::getBlockState(BlockInterface* block) const {
     return blockState;
 }
 
+void BlockManager::writeBlockState(BlockInterface* block, QCborStreamWriter& writer) const {
+    double dp = m_controller->guiManager()->getGuiScaling();
+    writer.startMap(8);
+    writer.append("name"_q);
+    writer.append(block->getBlockInfo().typeName);
+    writer.append("uid"_q);
+    writer.append(block->getUid());
+    writer.append("posX"_q);
+    writer.append(block->getGuiX() / dp);
+    writer.append("posY"_q);
+    writer.append(block->getGuiY() / dp);
+    writer.append("width"_q);
+    writer.append(block->getGuiWidth() / dp);
+    writer.append("height"_q);
+    writer.append(block->getGuiHeight() / dp);
+    writer.append("nodeMergeModes"_q);
+    block->getNodeMergeModes().toCborValue().toCbor(writer);
+    writer.append("internalState"_q);
+    block->writeState(writer);
+    writer.endMap();
+}
+
+QByteArray BlockManager::encodeBlockState(BlockInterface* block) const {
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writeBlockState(block, writer);
+    return data;
+}
+
 QPoint BlockManager::getBlocksMidpoint() const {
     double avgX = 0;
     double avgY = 0;
@@ -488,6 +1041,13 @@ void BlockManager::destroyAllGuiItemsExcept(BlockInterface* exception) {
     }
 }
 
+void BlockManager::onProjectEdited() {
+    // blocks are already edited while the project manager is created:
+    ProjectManager* projectManager = m_controller->projectManager();
+    if (!projectManager) return;
+    projectManager->history()->scheduleCommit();
+}
+
 QPoint BlockManager::getSpawnPosition(int randomOffset) const {
     QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
     int windowWidth = int(workspace->width());
@@ -518,6 +1078,20 @@ QPoint BlockManager::getBlockListPosition() const {
 	return blockListPos;
 }
 
+void BlockManager::setConnectionState(const QString& connection, bool connected) {
+    const int separator = connection.indexOf("->");
+    if (separator < 0) return;
+    NodeBase* outputNode = getNodeByUid(connection.left(separator));
+    NodeBase* inputNode = getNodeByUid(connection.mid(separator + 2));
+    if (!outputNode || !inputNode) return;
+    const bool isConnected = outputNode->getConnectedNodes().contains(inputNode);
+    if (connected && !isConnected) {
+        outputNode->connectTo(inputNode);
+    } else if (!connected && isConnected) {
+        outputNode->disconnectFrom(inputNode);
+    }
+}
+
 void BlockManager::focusBlock(BlockInterface* block) {
 	if (block == m_focusedBlock) {
 		// block already has internal focus, but maybe it lost keyboard focus:
@@ -529,6 +1103,7 @@ void BlockManager::focusBlock(BlockInterface* block) {
     }
     block->onFocus();
     m_focusedBlock = block;
+    m_overviewNeedsUpdate = true;
     focusChanged();
 }
 
@@ -536,6 +1111,7 @@ void BlockManager::defocusBlock(BlockInterface* block) {
     if (block != m_focusedBlock) return;
     block->defocus();
     m_focusedBlock = nullptr;
+    m_overviewNeedsUpdate = true;
 	focusChanged();
 }
 
@@ -622,13 +1198,13 @@ BlockInterface* BlockManager::createBlockInstance(QString blockType, QString uid
 	// create an instance:
 	BlockInterface* block = m_blockList.getBlockInfoByName(blockType).createInstanceOnHeap(m_controller, uid);
 	// add instance to lists:
-    if (m_currentBlocksByUid.find(block->getUid()) != m_currentBlocksByUid.end()) {
+    if (m_slotByUid.contains(block->getUid())) {
         qWarning() << "Tried to add block with UID already in use.";
         block->deleteLater();
         return nullptr;
     }
-	m_currentBlocks.push_back(block);
-	m_currentBlocksByUid[block->getUid()] = block;
+    registerBlock(block);
+    connect(block, SIGNAL(positionChanged()), this, SLOT(onBlockGeometryChanged()));
     emit blockInstanceCountChanged();
 	// return a pointer to the block instance:
 	return block;
@@ -3,10 +3,17 @@
 
 #include "core/manager/BlockList.h"
 #include "core/helpers/QCircularBuffer.h"
+#include "core/helpers/SpatialGrid.h"
+#include "core/helpers/SlotList.h"
+#include "core/helpers/ConnectedComponentIndex.h"
 #include "core/helpers/utils.h"
 
 #include <QObject>
 #include <QPointer>
+#include <QSet>
+#include <QVariantMap>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
 #include <vector>
 #include <QTimer>
 
@@ -19,6 +26,7 @@
 class CoreController;
 class BlockInterface;
 class NodeBase;
+class BlockOverviewItem;
 
 /**
  * @brief The BlockManagerConstants namespace contains all constants used in BlockManager.
@@ -34,6 +42,29 @@ namespace BlockManagerConstants {
      * if not other value is specified
      */
     static const int defaultBlockPositionOffset = 400;
+
+    /**
+     * @brief spatialIndexCellSize is the size of a cell in the index used to find blocks in the viewport
+     */
+    static const int spatialIndexCellSize = 512;
+
+    /**
+     * @brief visibilityHysteresis is the distance in pixels a visible block has to be outside
+     * of the area in which blocks are shown before it is hidden again
+     */
+    static const int visibilityHysteresis = 200;
+
+    /**
+     * @brief defaultOverviewScaleThreshold is the default workspace scale below which blocks
+     * are drawn as simple rectangles instead of their GUI items
+     */
+    static constexpr double defaultOverviewScaleThreshold = 0.35;
+
+    /**
+     * @brief overviewScaleHysteresis is the amount the scale has to be above the threshold
+     * to show the GUI items of the blocks again
+     */
+    static constexpr double overviewScaleHysteresis = 0.05;
 }
 
 
@@ -49,6 +80,9 @@ class BlockManager : public QObject
     Q_PROPERTY(QString displayedGroup READ getDisplayedGroup NOTIFY displayedGroupChanged)
     Q_PROPERTY(QString displayedGroupLabel READ getDisplayedGroupLabel NOTIFY displayedGroupChanged)
 
+    Q_PROPERTY(bool overviewActive READ isOverviewActive NOTIFY overviewActiveChanged)
+    Q_PROPERTY(double overviewScaleThreshold READ getOverviewScaleThreshold WRITE setOverviewScaleThreshold NOTIFY overviewScaleThresholdChanged)
+
     friend class BlockBase;
 
 public:
@@ -95,9 +129,21 @@ public slots:
      */
     int getBlockInstanceCount() const { return int(m_currentBlocks.size()); }
 
+    /**
+     * @brief getAllocationStatistics returns the counters of the slab allocators of blocks and nodes
+     * @return map with the statistics of the "blocks" and "nodes" allocators
+     */
+    QVariantMap getAllocationStatistics() const;
+
     /**
      * @brief updateBlockVisibility sets "visible" property of blocks that are not in the
      * current viewport to false
+     *
+     * Only blocks that enter or leave the viewport are changed. They are found using a spatial
+     * index of the block bounds that is updated when blocks move.
+     *
+     * If the workspace is scaled below the overview threshold, the GUI items are hidden
+     * and all blocks are drawn as simple rectangles by a single BlockOverviewItem instead.
      * @param workspace a pointer to the GUI items that represents the viewport
      */
     void updateBlockVisibility(QQuickItem* workspace);
@@ -117,6 +163,19 @@ public slots:
      */
     void setHideBlocksOutsideViewports(bool value);
 
+    /**
+     * @brief isOverviewActive returns if the blocks are currently drawn as simple rectangles
+     * @return true if the overview is shown instead of the GUI items
+     */
+    bool isOverviewActive() const { return m_overviewIsActive; }
+
+    double getOverviewScaleThreshold() const { return m_overviewScaleThreshold; }
+    /**
+     * @brief setOverviewScaleThreshold sets the workspace scale below which the overview is shown
+     * @param value scale, 0 to never show the overview
+     */
+    void setOverviewScaleThreshold(double value);
+
     QString getDisplayedGroup() const { return m_displayedGroup; }
     QString getDisplayedGroupLabel();
     void setDisplayedGroup(QString group);
@@ -134,6 +193,15 @@ public slots:
     BlockInterface* restoreBlock(const QCborMap& blockState, bool animated = true, bool connectOnAdd = false);
 
 public:
+    /**
+     * @brief restoreBlock restores a block from a state written by writeBlockState()
+     * (or any other CBOR map with the same content) directly from a CBOR stream
+     * @param reader the stream reader, positioned on the block state map, it is advanced past it
+     * @param animated true if the block should "fly" to the right position
+     * @return a pointer to the created Block or nullptr
+     */
+    BlockInterface* restoreBlock(QCborStreamReader& reader, bool animated = true);
+
     template<typename T>
     T* addNewBlock(int randomOffset = -1) {
         BlockInterface* block = addNewBlock(T::info().typeName, randomOffset);
@@ -157,6 +225,7 @@ public slots:
 	/**
      * @brief deleteAllBlocks deletes all blocks (forced)
      * @param immediate if true, blocks are deleted immediatley (never use when a signal from the same blocks is involved, i.e. in BlockBase::deletedByUser()!)
+     * and the memory used for them is returned to the system
 	 */
     void deleteAllBlocks(bool immediate=false);
 	/**
@@ -202,6 +271,16 @@ public slots:
 	 */
 	void restoreDeletedBlock();
 
+    /**
+     * @brief applyStateDelta updates the current blocks in place to match the given states,
+     * missing blocks are created and blocks with a different type are recreated
+     * (used to restore a previous project version without reloading the whole project)
+     * @param changedBlocks maps block UIDs to block states as returned by getBlockState()
+     * with an additional array "connections" containing the outgoing connections of the block
+     * @param removedBlocks UIDs of the blocks to delete
+     */
+    void applyStateDelta(const QCborMap& changedBlocks, const QStringList& removedBlocks);
+
 	/**
 	 * @brief getCurrentBlocks returns a list of all existing block instances
 	 * @return a list of pointers to blocks
@@ -219,9 +298,58 @@ public slots:
 public:
     template<typename T>
     T* getBlockByUid(const QString& uid) const  {
-        return qobject_cast<T*>(m_currentBlocksByUid.value(uid, nullptr));
+        const int slot = m_slotByUid.value(uid, -1);
+        if (slot < 0) return nullptr;
+        return qobject_cast<T*>(m_currentBlocks[std::size_t(slot)]);
     }
 
+    /**
+     * @brief getBlocksInGroup returns all blocks that are a direct member of a group
+     * without iterating over all blocks
+     * @param group UID of the group ("" for the root group)
+     * @return a copy of the list, it is not changed when blocks are moved while iterating
+     */
+    QVector<BlockInterface*> getBlocksInGroup(const QString& group) const;
+
+    /**
+     * @brief setGroupOfBlocks moves multiple blocks to a group with a single visibility update
+     * @param blocks the blocks to move
+     * @param group UID of the new group
+     */
+    void setGroupOfBlocks(const QVector<BlockInterface*>& blocks, QString group);
+
+    /**
+     * @brief getConnectedBlocks returns all blocks that are directly or indirectly connected to a block
+     * using the ConnectedComponentIndex
+     * @param block the block
+     * @return the connected blocks including the block itself
+     */
+    QVector<BlockInterface*> getConnectedBlocks(BlockInterface* block);
+
+    /**
+     * @brief onBlockGroupChanged updates the group lists after the group of a block changed,
+     * called by the block itself
+     * @param block the block
+     * @param oldGroup UID of the previous group
+     */
+    void onBlockGroupChanged(BlockInterface* block, const QString& oldGroup);
+
+    /**
+     * @brief onBlocksConnected updates the connected components after two nodes were connected,
+     * called by NodeBase
+     * @param block block of one of the nodes
+     * @param otherBlock block of the other node
+     */
+    void onBlocksConnected(BlockInterface* block, BlockInterface* otherBlock);
+
+    /**
+     * @brief onBlocksDisconnected updates the connected components after two nodes were disconnected,
+     * called by NodeBase
+     * @param block block of one of the nodes
+     * @param otherBlock block of the other node
+     */
+    void onBlocksDisconnected(BlockInterface* block, BlockInterface* otherBlock);
+
 public slots:
 	/**
 	 * @brief getBlockState returns the state of a block (including position etc. and internal state)
@@ -230,6 +358,24 @@ public slots:
 	 */
 	QCborMap getBlockState(BlockInterface* block) const;
 
+public:
+    /**
+     * @brief writeBlockState writes the state of a block directly to a CBOR stream
+     * (same content as getBlockState() except the focus, without intermediate QCborMaps)
+     * @param block pointer to the block
+     * @param writer the stream writer, the state is written as a single map item
+     */
+    void writeBlockState(BlockInterface* block, QCborStreamWriter& writer) const;
+
+    /**
+     * @brief encodeBlockState returns the CBOR encoded state of a block as written by writeBlockState()
+     * @param block pointer to the block
+     * @return the encoded state
+     */
+    QByteArray encodeBlockState(BlockInterface* block) const;
+
+public slots:
+
     /**
      * @brief getBlocksMidpoint return the geometric middle point of all blocks
      * (used to bring blocks back to viewport)
@@ -295,6 +441,10 @@ signals:
 
     void displayedGroupChanged();
 
+    void overviewActiveChanged();
+
+    void overviewScaleThresholdChanged();
+
 private:
 	/**
 	 * @brief createBlockInstance creates a block instance and adds it to the correct lists
@@ -304,6 +454,10 @@ private:
 	 * @return a pointer to the created Block
 	 */
     BlockInterface* createBlockInstance(QString blockType, QString uid = "");
+    /**
+     * @brief onProjectEdited lets the project history create a version after an edit
+     */
+    void onProjectEdited();
 	/**
 	 * @brief getSpawnPosition returns the preferred creation / spawn position in the GUI
      * @return a position on the "WorkspacePlane"
@@ -315,6 +469,79 @@ private:
      * @return a position on the "WorkspacePlane"
 	 */
 	QPoint getBlockListPosition() const;
+    /**
+     * @brief setConnectionState connects or disconnects two nodes described by a
+     * connection string ("outputNodeUid->inputNodeUid") if they are not already in that state
+     * @param connection the connection string
+     * @param connected true to connect, false to disconnect
+     */
+    void setConnectionState(const QString& connection, bool connected);
+    /**
+     * @brief placeRestoredBlock sets the geometry of a restored block, creates its GUI
+     * and moves it to its final position
+     * @param block the restored block with its internal state already set
+     * @param posX x position (dpi independent)
+     * @param posY y position (dpi independent)
+     * @param width width (dpi independent)
+     * @param height height (dpi independent)
+     * @param animated true if the block should "fly" to the right position
+     * @param connectOnAdd true if the block should be connected to the focused node
+     */
+    void placeRestoredBlock(BlockInterface* block, double posX, double posY, double width, double height,
+                            bool animated, bool connectOnAdd);
+    /**
+     * @brief registerBlock adds a new block to the list of current blocks and its group
+     * @param block the block, its UID must not be in use
+     */
+    void registerBlock(BlockInterface* block);
+    /**
+     * @brief unregisterBlock removes a block from the list of current blocks and its group
+     * in constant time
+     * @param block the block
+     */
+    void unregisterBlock(BlockInterface* block);
+    /**
+     * @brief updateSuspendedState suspends a visualization-only block if its group is not displayed
+     * and resumes it otherwise
+     * @param block the block
+     */
+    void updateSuspendedState(BlockInterface* block);
+    /**
+     * @brief releaseBlock disconnects a block and removes its GUI item before it is deleted
+     * @param block the block
+     * @param immediate true if the GUI item should be deleted immediately
+     */
+    void releaseBlock(BlockInterface* block, bool immediate);
+    /**
+     * @brief addToDisplayedGroup adds a block to the list and the spatial index of displayed blocks
+     * @param block a block that is in the displayed group
+     */
+    void addToDisplayedGroup(BlockInterface* block);
+    /**
+     * @brief removeFromDisplayedGroup removes a block from the list and the spatial index of displayed blocks
+     * @param block the block
+     */
+    void removeFromDisplayedGroup(BlockInterface* block);
+    /**
+     * @brief updateSpatialIndex updates the bounds of all blocks that moved since the last call
+     */
+    void updateSpatialIndex();
+    /**
+     * @brief setOverviewActive switches between GUI items and the overview of the displayed blocks
+     * @param active true to show the overview
+     * @param workspace a pointer to the GUI items that represents the viewport
+     */
+    void setOverviewActive(bool active, QQuickItem* workspace);
+    /**
+     * @brief updateOverview passes the current bounds and connections of the displayed blocks to the overview item
+     */
+    void updateOverview();
+
+private slots:
+    /**
+     * @brief onBlockGeometryChanged marks the sending block to be updated in the spatial index
+     */
+    void onBlockGeometryChanged();
 
 
 protected:
@@ -323,13 +550,22 @@ protected:
 	 */
     BlockList& m_blockList;
 	/**
-	 * @brief m_currentBlocks is the list of all currently existing block instances
+	 * @brief m_currentBlocks is the list of all currently existing block instances,
+	 * a removed block is replaced by the last one to keep it dense (see unregisterBlock())
 	 */
 	std::vector<QPointer<BlockInterface>> m_currentBlocks;
 	/**
-	 * @brief m_currentBlocksByUid maps the uid to the pointer of an existing block instance
+	 * @brief m_slotByUid maps the uid of an existing block instance to its index in m_currentBlocks
 	 */
-    QHash<QString, QPointer<BlockInterface>> m_currentBlocksByUid;
+    QHash<QString, int> m_slotByUid;
+    /**
+     * @brief m_blocksByGroup contains the blocks of each group by the UID of the group
+     */
+    QHash<QString, SlotList<BlockInterface*>> m_blocksByGroup;
+    /**
+     * @brief m_connectedComponents knows which blocks are connected to each other
+     */
+    ConnectedComponentIndex m_connectedComponents;
     /**
      * @brief m_displayedGroup is the UID of the currently displayed group
      */
@@ -337,7 +573,41 @@ protected:
     /**
      * @brief m_blocksInDisplayedGroup contains all blocks of the currently displayed group
      */
-    QVector<QPointer<BlockInterface>> m_blocksInDisplayedGroup;
+    SlotList<BlockInterface*> m_blocksInDisplayedGroup;
+    /**
+     * @brief m_displayedBlocksIndex contains the bounds of all blocks in m_blocksInDisplayedGroup
+     * except the ones that are always rendered
+     */
+    SpatialGrid<BlockInterface*> m_displayedBlocksIndex;
+    /**
+     * @brief m_blocksWithChangedGeometry contains the displayed blocks whose bounds in the index are outdated
+     */
+    QSet<BlockInterface*> m_blocksWithChangedGeometry;
+    /**
+     * @brief m_shownBlocks contains the displayed blocks that have been made visible by updateBlockVisibility()
+     */
+    QSet<BlockInterface*> m_shownBlocks;
+    /**
+     * @brief m_fullVisibilityUpdateNeeded is true if the visibility of all displayed blocks
+     * has to be set again (i.e. after all blocks have been shown)
+     */
+    bool m_fullVisibilityUpdateNeeded;
+    /**
+     * @brief m_overviewScaleThreshold is the workspace scale below which the overview is shown
+     */
+    double m_overviewScaleThreshold;
+    /**
+     * @brief m_overviewIsActive is true if the overview is shown instead of the GUI items
+     */
+    bool m_overviewIsActive;
+    /**
+     * @brief m_overviewNeedsUpdate is true if the displayed blocks changed since the overview was updated
+     */
+    bool m_overviewNeedsUpdate;
+    /**
+     * @brief m_overviewItem draws the displayed blocks as rectangles, created when needed
+     */
+    QPointer<BlockOverviewItem> m_overviewItem;
 	/**
 	 * @brief m_focusedBlock is a pointer to the currently focused block
 	 * (or nullptr if no block is focused)
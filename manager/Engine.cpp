@@ -1,5 +1,7 @@
 #include "Engine.h"
 
+#include "core/helpers/SmartAttribute.h"
+
 
 Engine::Engine(QObject* parent, int fps)
 	: QObject(parent)
@@ -25,4 +27,7 @@ void Engine::tick() {
 	// call signals in logical order:
 	emit updateBlocks(timeSinceLastFrame);
 	emit updateOutput(timeSinceLastFrame);
+
+    // notify the GUI once about all coalesced attribute changes of this frame:
+    SmartAttribute::flushPendingNotifications();
 }
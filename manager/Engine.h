@@ -56,7 +56,8 @@ private slots:
 
 	/**
 	 * @brief tick is the internal function called every frame
-	 * and emits the signals in the correct order
+	 * and emits the signals in the correct order,
+	 * afterwards the coalesced attribute notifications are flushed
 	 */
 	void tick();
 
@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 #include <QCborMap>
 #include <QCborArray>
 #include <QJsonObject>
@@ -10,11 +11,63 @@
 #include <QJsonDocument>
 #include <QString>
 #include <QStandardPaths>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QDateTime>
+#include <QCborStreamReader>
+#include <QMutexLocker>
+#include <QThread>
 #include <QDebug>
 
 
+// create a shorter alias for the constants namespace:
+namespace FSMC = FileSystemManagerConstants;
+
+namespace {
+
+// suffix of the cache keys of header only entries:
+const QString headerCacheSuffix = "#header";
+
+QCborMap decodeCborMap(const QByteArray& content) {
+    QCborMap cborMap = QCborValue::fromCbor(content).toMap();
+    if (cborMap.isEmpty()) {
+        // backward compatibility / migration path: check if file is in JSON format:
+        QJsonDocument loadDoc(QJsonDocument::fromJson(content));
+        cborMap = QCborMap::fromJsonObject(loadDoc.object());
+    }
+    return cborMap;
+}
+
+QCborMap decodeCborMapHeader(const QByteArray& content) {
+    QCborStreamReader reader(content);
+    QCborMap header;
+    if (!reader.isMap()) {
+        // i.e. JSON, decode everything and remove the arrays:
+        const QCborMap cborMap = decodeCborMap(content);
+        for (auto it = cborMap.constBegin(); it != cborMap.constEnd(); ++it) {
+            if (!it.value().isArray()) header[it.key()] = it.value();
+        }
+        return header;
+    }
+    reader.enterContainer();
+    while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+        const QCborValue key = QCborValue::fromCbor(reader);
+        if (reader.isArray()) {
+            // skip arrays without decoding them:
+            reader.next();
+        } else {
+            header[key] = QCborValue::fromCbor(reader);
+        }
+    }
+    return header;
+}
+
+}  // namespace
+
 FileSystemManager::FileSystemManager()
 	: QObject()
+    , m_cborMapCache(FSMC::maxCachedCborMaps)
+    , m_fileWatcher(nullptr)
 {
     if (QSysInfo::productType() == "android") {
         //m_dataRoot = "file:///sdcard/luminosus_data/";
@@ -29,6 +82,9 @@ FileSystemManager::FileSystemManager()
     QDir().mkpath(m_dataRoot + "projects");
     QDir().mkpath(m_dataRoot + "combinations");
     qDebug() << "App data directory: " << m_dataRoot;
+#if !defined(Q_OS_IOS) && !defined(Q_OS_ANDROID)
+    setFileWatcherEnabled(true);
+#endif
 }
 
 QString FileSystemManager::saveFile(QString dir, QString filename, QByteArray content) const {
@@ -41,13 +97,19 @@ QString FileSystemManager::saveFile(QString dir, QString filename, QByteArray co
 }
 
 QString FileSystemManager::saveLocalFile(QString path, QByteArray content) const {
-    QFile saveFile(path);
+    // the content is written to a temporary file that replaces the existing one when it is complete,
+    // the existing file is never truncated because it could still be mapped (see mapFile()):
+    QSaveFile saveFile(path);
     if (!saveFile.open(QIODevice::WriteOnly)) {
         qWarning() << "Couldn't write to file " + path + ": " << saveFile.errorString();
         return {};
     }
     saveFile.write(content);
-    saveFile.close();
+    if (!saveFile.commit()) {
+        qWarning() << "Couldn't write to file " + path + ": " << saveFile.errorString();
+        return {};
+    }
+    invalidateCache(path);
     return path;
 }
 
@@ -81,19 +143,28 @@ QByteArray FileSystemManager::loadLocalFile(QString path) const {
     return content;
 }
 
-QCborMap FileSystemManager::loadCborMap(QString dir, QString filename) const {
-    QByteArray content = loadFile(dir, filename);
-    QCborMap cborMap = QCborValue::fromCbor(content).toMap();
-    if (cborMap.isEmpty()) {
-        // backward compatibility / migration path: check if file is in JSON format:
-        QJsonDocument loadDoc(QJsonDocument::fromJson(content));
-        cborMap = QCborMap::fromJsonObject(loadDoc.object());
+QSharedPointer<const MappedFile> FileSystemManager::mapFile(QString dir, QString filename) const {
+    QString path = getDataDir(dir) + filename;
+    return mapLocalFile(path);
+}
+
+QSharedPointer<const MappedFile> FileSystemManager::mapLocalFile(QString path) const {
+    if (!path.startsWith("assets-library:") && !QDir().exists(path)) {
+        qWarning() << "File " + path + " does not exist.";
+        return QSharedPointer<const MappedFile>(new MappedFile(QString()));
     }
-    return cborMap;
+    return QSharedPointer<const MappedFile>(new MappedFile(path));
+}
+
+QCborMap FileSystemManager::loadCborMap(QString dir, QString filename) const {
+    // the content is decoded directly from the mapped file without copying it first:
+    const QSharedPointer<const MappedFile> file = mapFile(dir, filename);
+    return decodeCborMap(file->bytes());
 }
 
 QCborArray FileSystemManager::loadCborArray(QString dir, QString filename) const {
-    QByteArray content = loadFile(dir, filename);
+    const QSharedPointer<const MappedFile> file = mapFile(dir, filename);
+    const QByteArray content = file->bytes();
     QCborArray cborArray = QCborValue::fromCbor(content).toArray();
     if (cborArray.isEmpty()) {
         // backward compatibility / migration path: check if file is in JSON format:
@@ -103,6 +174,14 @@ QCborArray FileSystemManager::loadCborArray(QString dir, QString filename) const
     return cborArray;
 }
 
+QCborMap FileSystemManager::loadCborMapCached(QString dir, QString filename) const {
+    return cachedCborMap(getDataDir(dir) + filename, /*headerOnly*/ false);
+}
+
+QCborMap FileSystemManager::loadCborMapHeaderCached(QString dir, QString filename) const {
+    return cachedCborMap(getDataDir(dir) + filename, /*headerOnly*/ true);
+}
+
 bool FileSystemManager::fileExists(QString dir, QString filename) const {
     QString path = getDataDir(dir) + filename;
 	return QDir().exists(path);
@@ -110,7 +189,30 @@ bool FileSystemManager::fileExists(QString dir, QString filename) const {
 
 QStringList FileSystemManager::getFilenames(QString dir, QString filter) const {
 	QString path = getDataDir(dir);
-	return QDir(path).entryList(QStringList {filter});
+    const QString key = QDir::cleanPath(path) + "\n" + filter;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        auto cached = m_listingCache.constFind(key);
+        if (cached != m_listingCache.constEnd() && cached->watched && m_fileWatcher) {
+            // the watcher removes the entry if the directory changes:
+            return cached->filenames;
+        }
+    }
+    // the path is watched before it is read to not miss a change in between:
+    const bool watched = watchPath(QDir::cleanPath(path));
+    // the modification time of a directory changes when files are added or removed:
+    const qint64 lastModified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    QMutexLocker locker(&m_cacheMutex);
+    auto cached = m_listingCache.constFind(key);
+    if (cached != m_listingCache.constEnd() && cached->lastModified == lastModified) {
+        return cached->filenames;
+    }
+    // the directory is not read while the mutex is locked:
+    locker.unlock();
+    const QStringList filenames = QDir(path).entryList(QStringList {filter});
+    locker.relock();
+    m_listingCache.insert(key, CachedListing {lastModified, watched, filenames});
+    return filenames;
 }
 
 void FileSystemManager::deleteFile(QString dir, QString filename) const {
@@ -121,6 +223,7 @@ void FileSystemManager::deleteFile(QString dir, QString filename) const {
 void FileSystemManager::deleteLocalFile(QString path) const {
     if (!QDir().exists(path)) return;
     QFile::remove(path);
+    invalidateCache(path);
 }
 
 void FileSystemManager::importFile(QString inputPath, QString dir, bool overwrite) const {
@@ -133,6 +236,7 @@ void FileSystemManager::importFile(QString inputPath, QString dir, bool overwrit
         }
     }
     QFile::copy(inputPath, outputPath);
+    invalidateCache(outputPath);
     // if inputPath is a resource file (":/...") fix the permissions:
     if (inputPath.startsWith(":")) {
         QFile(outputPath).setPermissions(QFile::ReadOwner|QFile::WriteOwner
@@ -197,3 +301,98 @@ QString FileSystemManager::getDataDir(QString dir) const {
 QString FileSystemManager::getDir(QString dir, QString filename) const {
     return getDataDir(dir) + filename;
 }
+
+void FileSystemManager::setFileWatcherEnabled(bool enabled) {
+    if (enabled == getFileWatcherEnabled()) return;
+    if (enabled) {
+        // existing entries are not watched and are still checked by modification time:
+        QFileSystemWatcher* fileWatcher = new QFileSystemWatcher(this);
+        connect(fileWatcher, &QFileSystemWatcher::fileChanged, this, &FileSystemManager::onWatchedFileChanged);
+        connect(fileWatcher, &QFileSystemWatcher::directoryChanged, this, &FileSystemManager::onWatchedDirectoryChanged);
+        QMutexLocker locker(&m_cacheMutex);
+        m_fileWatcher = fileWatcher;
+    } else {
+        // entries stay valid, they are checked by modification time from now on:
+        QMutexLocker locker(&m_cacheMutex);
+        m_fileWatcher->deleteLater();
+        m_fileWatcher = nullptr;
+    }
+}
+
+void FileSystemManager::invalidateCache(QString path) const {
+    QMutexLocker locker(&m_cacheMutex);
+    removeCachedEntries(path, QDir::cleanPath(QFileInfo(path).path()));
+}
+
+void FileSystemManager::onWatchedFileChanged(const QString& path) {
+    // the watcher stops watching a file when it is replaced or removed,
+    // it is added again when it is cached the next time
+    QMutexLocker locker(&m_cacheMutex);
+    removeCachedEntries(path, QString());
+}
+
+void FileSystemManager::onWatchedDirectoryChanged(const QString& path) {
+    QMutexLocker locker(&m_cacheMutex);
+    removeCachedEntries(QString(), QDir::cleanPath(path));
+}
+
+QCborMap FileSystemManager::cachedCborMap(const QString& path, bool headerOnly) const {
+    const QString key = headerOnly ? path + headerCacheSuffix : path;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const CachedCborMap* cached = m_cborMapCache.object(key);
+        if (cached && cached->watched && m_fileWatcher) {
+            // the watcher removes the entry if the file changes:
+            return cached->content;
+        }
+    }
+
+    // the file is watched before it is read to not miss a change in between:
+    const bool watched = watchPath(path);
+    const QFileInfo fileInfo(path);
+    if (!fileInfo.exists()) {
+        QMutexLocker locker(&m_cacheMutex);
+        m_cborMapCache.remove(key);
+        qWarning() << "File " + path + " does not exist.";
+        return QCborMap();
+    }
+    const qint64 lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        const CachedCborMap* cached = m_cborMapCache.object(key);
+        if (cached && cached->lastModified == lastModified && cached->size == fileInfo.size()) {
+            return cached->content;
+        }
+    }
+
+    // the file is decoded without locking the mutex:
+    const QSharedPointer<const MappedFile> file = mapLocalFile(path);
+    const QCborMap content = headerOnly ? decodeCborMapHeader(file->bytes()) : decodeCborMap(file->bytes());
+    QMutexLocker locker(&m_cacheMutex);
+    m_cborMapCache.insert(key, new CachedCborMap {lastModified, fileInfo.size(), watched, content});
+    return content;
+}
+
+void FileSystemManager::removeCachedEntries(const QString& filePath, const QString& directory) const {
+    if (!filePath.isEmpty()) {
+        m_cborMapCache.remove(filePath);
+        m_cborMapCache.remove(filePath + headerCacheSuffix);
+    }
+    if (directory.isEmpty()) return;
+    const QString listingPrefix = directory + "\n";
+    for (auto it = m_listingCache.begin(); it != m_listingCache.end();) {
+        if (it.key().startsWith(listingPrefix)) {
+            it = m_listingCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool FileSystemManager::watchPath(const QString& path) const {
+    // the watcher is not thread-safe, entries of other threads are checked by modification time:
+    if (!m_fileWatcher || QThread::currentThread() != thread()) return false;
+    if (m_fileWatcher->files().contains(path) || m_fileWatcher->directories().contains(path)) return true;
+    // this fails i.e. if the system limit of watched files is reached:
+    return m_fileWatcher->addPath(path);
+}
@@ -1,18 +1,41 @@
 #ifndef FILESYSTEMMANAGER_H
 #define FILESYSTEMMANAGER_H
 
+#include "core/helpers/MappedFile.h"
+
 #include <QObject>
 #include <QCborMap>
 #include <QCborArray>
 #include <QString>
 #include <QByteArray>
+#include <QSharedPointer>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
 
 #include <iostream>
 
+// forward declaration to reduce dependencies
+class QFileSystemWatcher;
+
+
+/**
+ * @brief The FileSystemManagerConstants namespace contains all constants used in FileSystemManager.
+ */
+namespace FileSystemManagerConstants {
+    /**
+     * @brief maxCachedCborMaps is the maximum number of decoded files kept in the cache
+     */
+    static const int maxCachedCborMaps = 200;
+}
+
 
 /**
  * @brief The FileSystemManager class simplifies the file system access.
  * It can also read and write QJson objects to and from files.
+ *
+ * Decoded files and directory listings are cached. The caches can be used from any thread,
+ * but only entries created in the thread of this object are invalidated by the file system watcher.
  */
 class FileSystemManager : public QObject {
 
@@ -36,7 +59,8 @@ public:
 
     /**
      * @brief saveFile saves a QByteArray to a file in the local file system
-     * It overwrites the file if it already exists.
+     * It replaces the file if it already exists, views on the old content
+     * returned by mapFile() stay valid.
      * @param path target directory and filename in the local file system
      * @param content to be written
      * @return path of new file if the file was successfully written
@@ -77,6 +101,24 @@ public:
      * @return the object read from the file or an emtpy object if the file does not exists
      */
     QByteArray loadLocalFile(QString path) const;
+
+    /**
+     * @brief mapFile maps a file in the data dir to memory instead of reading it,
+     * use this for large files that only need to be read once (i.e. to decode or send them)
+     * @param dir sub dir inside the app data dir
+     * @param filename of the file to be read
+     * @return the mapped file, the content stays valid as long as the pointer exists,
+     * check MappedFile::isValid() to know if the file could be opened
+     */
+    QSharedPointer<const MappedFile> mapFile(QString dir, QString filename) const;
+
+    /**
+     * @brief mapLocalFile maps a file in the local file system to memory instead of reading it
+     * (see mapFile())
+     * @param path including directory and filename in the local file system
+     * @return the mapped file, the content stays valid as long as the pointer exists
+     */
+    QSharedPointer<const MappedFile> mapLocalFile(QString path) const;
 	/**
 	 * @brief loadJsonObject loads a QCborMap from a file.
 	 * It returns an empty object if the file does not exist.
@@ -94,6 +136,26 @@ public:
 	 */
     QCborArray loadCborArray(QString dir, QString filename) const;
 
+    /**
+     * @brief loadCborMapCached returns the same as loadCborMap() but keeps the decoded content
+     * in a cache, the file is only read again if its modification time or size changed
+     * (or if the file system watcher reported a change, see setFileWatcherEnabled())
+     * @param dir sub dir inside the app data dir
+     * @param filename of the file to be read
+     * @return the object read from the file or an emtpy object if the file does not exists
+     */
+    QCborMap loadCborMapCached(QString dir, QString filename) const;
+
+    /**
+     * @brief loadCborMapHeaderCached returns only the top level entries of a CBOR map file
+     * that are not arrays (i.e. the settings of a project without the blocks and connections),
+     * the arrays are skipped without decoding them, the result is cached like in loadCborMapCached()
+     * @param dir sub dir inside the app data dir
+     * @param filename of the file to be read
+     * @return the header entries or an emtpy object if the file does not exists
+     */
+    QCborMap loadCborMapHeaderCached(QString dir, QString filename) const;
+
 	/**
 	 * @brief fileExists checks if a file exits in the app data dir
 	 * @param dir sub dir inside the app data dir
@@ -104,7 +166,7 @@ public:
 
 	/**
 	 * @brief getFilenames returns a list of all files and dirs in the path
-	 * that match the filter pattern
+	 * that match the filter pattern (the result is cached until the directory changes)
 	 * @param dir sub dir inside the app data dir
 	 * @param filter string to match the files (i.e. "*.txt")
 	 * @return list of files and dirs
@@ -169,12 +231,98 @@ public slots:
      */
     QString getDir(QString dir, QString filename) const;
 
+    /**
+     * @brief setFileWatcherEnabled sets how cached file contents and directory listings
+     * are invalidated
+     * @param enabled true to use a QFileSystemWatcher (cache hits don't access the file system),
+     * false to compare the modification time (and size of files) on each access
+     */
+    void setFileWatcherEnabled(bool enabled);
+    bool getFileWatcherEnabled() const { return m_fileWatcher != nullptr; }
+
+    /**
+     * @brief invalidateCache removes the cached content of a file and the cached listing
+     * of its directory (called automatically for changes made by this class)
+     * @param path including directory and filename in the local file system
+     */
+    void invalidateCache(QString path) const;
+
+private slots:
+    void onWatchedFileChanged(const QString& path);
+    void onWatchedDirectoryChanged(const QString& path);
+
 protected:
+    /**
+     * @brief The CachedCborMap struct is an entry of the decoded file cache.
+     */
+    struct CachedCborMap {
+        qint64 lastModified;
+        qint64 size;
+        bool watched;  // true if changes are reported by m_fileWatcher
+        QCborMap content;
+    };
+
+    /**
+     * @brief The CachedListing struct is an entry of the directory listing cache.
+     */
+    struct CachedListing {
+        qint64 lastModified;
+        bool watched;  // true if changes are reported by m_fileWatcher
+        QStringList filenames;
+    };
+
+    /**
+     * @brief cachedCborMap returns the decoded content of a file from the cache
+     * or reads it if the cached content is outdated
+     * @param path including directory and filename in the local file system
+     * @param headerOnly true to only decode the top level entries that are not arrays
+     * @return the decoded content
+     */
+    QCborMap cachedCborMap(const QString& path, bool headerOnly) const;
+
+    /**
+     * @brief removeCachedEntries removes the cached content of a file
+     * and the cached listings of a directory, m_cacheMutex has to be locked
+     * @param filePath path of the file or an empty string
+     * @param directory cleaned path of the directory or an empty string
+     */
+    void removeCachedEntries(const QString& filePath, const QString& directory) const;
+
+    /**
+     * @brief watchPath adds a path to the file system watcher if it is enabled
+     * and if it is called from the thread of this object
+     * @param path of a file or directory
+     * @return true if the path is watched
+     */
+    bool watchPath(const QString& path) const;
+
+
 	/**
 	 * @brief m_dataRoot is the path to the app data directory
 	 */
     QString m_dataRoot;
 
+    /**
+     * @brief m_cacheMutex protects m_cborMapCache and m_listingCache
+     */
+    mutable QMutex m_cacheMutex;
+
+    /**
+     * @brief m_cborMapCache contains decoded files by path
+     * (header only entries have the suffix "#header")
+     */
+    mutable QCache<QString, CachedCborMap> m_cborMapCache;
+
+    /**
+     * @brief m_listingCache contains directory listings by "directory path\nfilter"
+     */
+    mutable QHash<QString, CachedListing> m_listingCache;
+
+    /**
+     * @brief m_fileWatcher is used to invalidate the caches if enabled, otherwise nullptr
+     */
+    QFileSystemWatcher* m_fileWatcher;
+
 };
 
 #endif // FILESYSTEMMANAGER_H
@@ -0,0 +1,127 @@
+#include "GuiItemPool.h"
+
+#include <QQmlEngine>
+#include <QQmlComponent>
+#include <QQuickItem>
+#include <QTimer>
+#include <QUrl>
+
+#include <algorithm>
+
+
+// create a shorter alias for the constants namespace:
+namespace GIPC = GuiItemPoolConstants;
+
+GuiItemPool::GuiItemPool(QQmlEngine* engine, QObject* parent)
+    : QObject(parent)
+    , m_engine(engine)
+{
+
+}
+
+GuiItemPool::~GuiItemPool() {
+    for (const QVector<PooledItem>& items: m_items) {
+        for (const PooledItem& pooled: items) {
+            delete pooled.item.data();
+        }
+    }
+}
+
+QQmlComponent* GuiItemPool::component(const QString& qmlFile) {
+    QQmlComponent* component = m_components.value(qmlFile);
+    if (!component) {
+        // components with errors are cached, too, the errors are reported when creating an item:
+        component = new QQmlComponent(m_engine, QUrl(qmlFile), this);
+        m_components.insert(qmlFile, component);
+    }
+    return component;
+}
+
+QQuickItem* GuiItemPool::takeItem(const QString& qmlFile, QObject* block, bool rebindable) {
+    ++m_usageCounts[qmlFile];
+    auto it = m_items.find(qmlFile);
+    if (it == m_items.end()) return nullptr;
+    QVector<PooledItem>& items = it.value();
+
+    // prefer the item of the same block, its bindings don't have to be updated:
+    int index = -1;
+    for (int i = 0; i < items.size(); ++i) {
+        if (items[i].block == block) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 && rebindable && !items.isEmpty()) {
+        index = items.size() - 1;
+    }
+    if (index < 0) return nullptr;
+
+    const PooledItem pooled = items[index];
+    items.remove(index);
+    if (pooled.block) m_fileOfPooledBlock.remove(pooled.block);
+    return pooled.item;
+}
+
+bool GuiItemPool::recycleItem(const QString& qmlFile, QQuickItem* item, QObject* block, bool rebindable) {
+    if (!item || !block || qmlFile.isEmpty()) return false;
+    QVector<PooledItem>& items = m_items[qmlFile];
+    if (items.size() >= GIPC::maxPooledItemsPerFile) return false;
+    // a block has at most one item in the pool:
+    discardItemsOf(block);
+    item->setVisible(false);
+    item->setParentItem(nullptr);
+    if (rebindable) {
+        // the QML file handles a missing block, the bindings are updated again when it is reused:
+        item->setProperty("block", QVariant::fromValue<QObject*>(nullptr));
+    }
+    items.append(PooledItem{item, block});
+    m_fileOfPooledBlock.insert(block, qmlFile);
+    return true;
+}
+
+void GuiItemPool::discardItemsOf(QObject* block, bool immediate) {
+    auto fileIt = m_fileOfPooledBlock.find(block);
+    if (fileIt == m_fileOfPooledBlock.end()) return;
+    QVector<PooledItem>& items = m_items[fileIt.value()];
+    m_fileOfPooledBlock.erase(fileIt);
+    for (int i = 0; i < items.size(); ++i) {
+        if (items[i].block != block) continue;
+        if (immediate) {
+            delete items[i].item.data();
+        } else if (items[i].item) {
+            items[i].item->deleteLater();
+        }
+        items.remove(i);
+        return;
+    }
+}
+
+void GuiItemPool::prewarm(const QStringList& qmlFiles) {
+    const bool wasEmpty = m_filesToPrewarm.isEmpty();
+    for (const QString& qmlFile: qmlFiles) {
+        if (qmlFile.isEmpty() || m_components.contains(qmlFile)) continue;
+        m_filesToPrewarm.append(qmlFile);
+        // remember them even if they are not used in this session:
+        m_usageCounts[qmlFile] += 0;
+    }
+    if (wasEmpty && !m_filesToPrewarm.isEmpty()) {
+        QTimer::singleShot(GIPC::prewarmIntervalMs, this, SLOT(prewarmNext()));
+    }
+}
+
+QStringList GuiItemPool::getMostUsedFiles(int count) const {
+    QStringList files = m_usageCounts.keys();
+    std::sort(files.begin(), files.end(), [this](const QString& lhs, const QString& rhs) {
+        return m_usageCounts.value(lhs) > m_usageCounts.value(rhs);
+    });
+    return files.mid(0, count);
+}
+
+void GuiItemPool::prewarmNext() {
+    if (m_filesToPrewarm.isEmpty()) return;
+    // compile one file per frame to not block the GUI:
+    component(m_filesToPrewarm.takeFirst());
+    if (!m_filesToPrewarm.isEmpty()) {
+        QTimer::singleShot(GIPC::prewarmIntervalMs, this, SLOT(prewarmNext()));
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef GUIITEMPOOL_H
+#define GUIITEMPOOL_H
+
+#include <QObject>
+#include <QPointer>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+
+// forward declaration to reduce dependencies
+class QQmlEngine;
+class QQmlComponent;
+class QQuickItem;
+
+
+/**
+ * @brief The GuiItemPoolConstants namespace contains all constants used in GuiItemPool.
+ */
+namespace GuiItemPoolConstants {
+    /**
+     * @brief maxPooledItemsPerFile is the maximum number of unused GUI items kept per QML file
+     */
+    static const int maxPooledItemsPerFile = 32;
+    /**
+     * @brief prewarmedFileCount is the number of the most used QML files to compile at startup
+     */
+    static const int prewarmedFileCount = 24;
+    /**
+     * @brief prewarmIntervalMs is the time between compiling two QML files at startup
+     */
+    static const int prewarmIntervalMs = 8;
+}
+
+
+/**
+ * @brief The GuiItemPool class caches compiled QML components and unused GUI items of blocks.
+ *
+ * A GUI item that is destroyed is kept in the pool (detached from the scene) and reused
+ * when the same block needs a GUI item again. It is only reused for another block
+ * of the same type if its QML file only depends on the "block" property
+ * (see BlockInfo::guiItemIsRebindable). The "block" property of such an item is cleared
+ * while it is pooled, so that it doesn't update its bindings for the old block.
+ * Node items register themselves again when their "node" property changes (i.e. InputNode.qml).
+ */
+class GuiItemPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GuiItemPool(QQmlEngine* engine, QObject* parent = nullptr);
+    ~GuiItemPool() override;
+
+    /**
+     * @brief component returns the compiled component of a QML file, it is created on first use
+     * @param qmlFile URL of the QML file
+     * @return the component, owned by this pool
+     */
+    QQmlComponent* component(const QString& qmlFile);
+
+    /**
+     * @brief takeItem removes an unused GUI item from the pool,
+     * the caller has to set its properties and parent
+     * @param qmlFile URL of the QML file
+     * @param block the block the item is needed for
+     * @param rebindable true if an item of another block may be returned
+     * @return the item or nullptr if there is no matching one
+     */
+    QQuickItem* takeItem(const QString& qmlFile, QObject* block, bool rebindable);
+
+    /**
+     * @brief recycleItem adds an unused GUI item to the pool
+     * @param qmlFile URL of the QML file the item was created from
+     * @param item the item
+     * @param block the block that used the item
+     * @param rebindable true if the "block" property of the item can be cleared,
+     * otherwise it still points to the block (the item is deleted before the block)
+     * @return false if the pool is full, the caller has to delete the item in that case
+     */
+    bool recycleItem(const QString& qmlFile, QQuickItem* item, QObject* block, bool rebindable);
+
+    /**
+     * @brief discardItemsOf deletes the pooled item of a block, has to be called before the block is deleted
+     * @param block the block
+     * @param immediate if false, the item is deleted later (i.e. when a signal of the item is involved)
+     */
+    void discardItemsOf(QObject* block, bool immediate = true);
+
+    /**
+     * @brief prewarm compiles the components of the given files spread over the next frames
+     * @param qmlFiles URLs of QML files
+     */
+    void prewarm(const QStringList& qmlFiles);
+
+    /**
+     * @brief getMostUsedFiles returns the QML files for which the most GUI items were requested
+     * @param count maximum number of files to return
+     * @return URLs of the QML files, the most used first
+     */
+    QStringList getMostUsedFiles(int count) const;
+
+private slots:
+    void prewarmNext();
+
+protected:
+    struct PooledItem {
+        QPointer<QQuickItem> item;
+        QPointer<QObject> block;
+    };
+
+    QQmlEngine* const m_engine;  //!< engine to create components with
+    QHash<QString, QQmlComponent*> m_components;  //!< compiled components by QML file
+    QHash<QString, QVector<PooledItem>> m_items;  //!< unused GUI items by QML file
+    QHash<QObject*, QString> m_fileOfPooledBlock;  //!< the QML file of the pooled item of a block
+    QHash<QString, int> m_usageCounts;  //!< number of requested GUI items by QML file
+    QStringList m_filesToPrewarm;  //!< QML files that are compiled in the next frames
+};
+
+#endif // GUIITEMPOOL_H
@@ -6,6 +6,7 @@
 #include "core/helpers/utils.h"
 #include "core/helpers/qstring_literal.h"
 
+#include <QCborArray>
 #include <QQuickWindow>
 #include <QQuickItem>
 #include <QGuiApplication>
@@ -16,6 +17,7 @@
 GuiManager::GuiManager(CoreController* controller, QQmlApplicationEngine* qmlEngine)
     : m_controller(controller)
     , m_qmlEngine(qmlEngine)
+    , m_itemPool(qmlEngine)
     , m_backgroundName(LuminosusConstants::defaultBackgroundName)
     , m_overrideGuiScaling(false)
     , m_overrideGraphicsLevel(false)
@@ -37,6 +39,7 @@ void GuiManager::writeTo(QCborMap& appState) const {
     appState["overrideGraphicsLevel"_q] = getOverrideGraphicsLevel();
     appState["graphicsLevel"_q] = getGraphicsLevel();
     appState["snapToGrid"_q] = getSnapToGrid();
+    appState["prewarmedQmlFiles"_q] = QCborArray::fromStringList(m_itemPool.getMostUsedFiles(GuiItemPoolConstants::prewarmedFileCount));
 }
 
 void GuiManager::readFrom(const QCborMap& appState) {
@@ -51,6 +54,12 @@ void GuiManager::readFrom(const QCborMap& appState) {
         setGraphicsLevel(int(appState["graphicsLevel"].toInteger()));
     }
     setSnapToGrid(appState["snapToGrid"].toBool());
+    // compile the QML files of the blocks used most in the last session:
+    QStringList prewarmedQmlFiles;
+    for (QCborValueRef qmlFile: appState["prewarmedQmlFiles"_q].toArray()) {
+        prewarmedQmlFiles.append(qmlFile.toString());
+    }
+    m_itemPool.prewarm(prewarmedQmlFiles);
 }
 
 void GuiManager::setBackgroundName(QString value) {
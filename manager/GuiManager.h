@@ -1,6 +1,8 @@
 #ifndef GUIMANAGER_H
 #define GUIMANAGER_H
 
+#include "core/manager/GuiItemPool.h"
+
 #include <QObject>
 #include <QCborMap>
 #include <QQmlApplicationEngine>
@@ -60,6 +62,12 @@ public slots:
      */
     QQmlApplicationEngine* qmlEngine() { return m_qmlEngine; }
 
+    /**
+     * @brief itemPool returns the cache of QML components and unused GUI items of blocks
+     * @return the GuiItemPool instance
+     */
+    GuiItemPool* itemPool() { return &m_itemPool; }
+
     QString getBackgroundName() const { return m_backgroundName; }
     void setBackgroundName(QString value);
 
@@ -209,6 +217,7 @@ protected:
     CoreController* const m_controller;  //!< a pointer to the CoreController
 
     QQmlApplicationEngine* m_qmlEngine;  //!< QQmlApplicationEngine object, created in main.cpp
+    GuiItemPool m_itemPool;  //!< cache of QML components and unused GUI items of blocks
 
     QString m_backgroundName;  //!< the file name of the background image
     bool m_overrideGuiScaling;  //!< true if GUI scaling is overriden by user
@@ -1,154 +1,622 @@
 #include "HandoffManager.h"
 
 #include "core/CoreController.h"
+#include "core/manager/BlockManager.h"
 #include "core/manager/ProjectManager.h"
 #include "core/manager/FileSystemManager.h"
+#include "core/manager/AnchorManager.h"
+#include "core/manager/GuiManager.h"
 #include "core/helpers/qstring_literal.h"
+#include "core/helpers/cbor_stream_utils.h"
+#include "core/helpers/utils.h"
 
-#include <QJsonDocument>
-#include <QCborMap>
-#include <QDataStream>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QDateTime>
+#include <QUuid>
+#include <QtEndian>
 
 
 // create a shorter alias for the constants namespace:
 namespace PMC = ProjectManagerConstants;
-
-
-namespace HandoffManagerConstants {
-    static const quint16 PORT = 51235;
-    static const QByteArray requestControlMessage = QString("request_control").toLatin1();
-}
+namespace HMC = HandoffManagerConstants;
 
 
 HandoffManager::HandoffManager(CoreController* controller)
     : QObject(controller)
     , m_controller(controller)
     , m_clientSocket(this)
+    , m_reconnectTimer(this)
     , m_tcpServer(this)
+    , m_abandonTimer(this)
 {
+    connect(&m_clientSocket, SIGNAL(connected()), this, SLOT(onUploadConnected()));
+    connect(&m_clientSocket, SIGNAL(disconnected()), this, SLOT(onUploadConnectionLost()));
+    connect(&m_clientSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
+            this, &HandoffManager::onUploadConnectionLost);
+    connect(&m_clientSocket, SIGNAL(readyRead()), this, SLOT(processRecordsFromReceiver()));
+    connect(&m_clientSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(continueUpload()));
+
+    m_reconnectTimer.setSingleShot(true);
+    m_reconnectTimer.setInterval(HMC::reconnectDelayMs);
+    connect(&m_reconnectTimer, SIGNAL(timeout()), this, SLOT(connectUpload()));
+
+    m_abandonTimer.setInterval(HMC::resumeTimeoutMs / 4);
+    connect(&m_abandonTimer, SIGNAL(timeout()), this, SLOT(checkAbandonedTransfers()));
+
     connect(&m_tcpServer, SIGNAL(newConnection()), this, SLOT(clientConnected()));
-    qDebug() << "HandoffManager listening:" << m_tcpServer.listen(QHostAddress::Any, HandoffManagerConstants::PORT);
+    qDebug() << "HandoffManager listening:" << m_tcpServer.listen(QHostAddress::Any, HMC::PORT);
 }
 
 void HandoffManager::takeControl(QString ip) {
-    writeData(ip, HandoffManagerConstants::requestControlMessage);
+    QTcpSocket* socket = new QTcpSocket(this);
+    connect(socket, &QTcpSocket::connected, this, [socket]() {
+        socket->write(encodeRecord(RequestControlRecord));
+        socket->disconnectFromHost();
+    });
+    connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this, [socket]() {
+        qWarning() << "Handoff control request failed:" << socket->errorString();
+        socket->deleteLater();
+    });
+    socket->connectToHost(ip, HMC::PORT);
 }
 
 void HandoffManager::uploadTo(QString ip) {
-    QCborMap projectState = m_controller->projectManager()->getCurrentProjectState();
-    writeData(ip, projectState.toCborValue().toCbor());
-    // load / import project should not be used from JS callback
-    // because blocks are deleted immediately (?)
-    QTimer::singleShot(0, [&](){ m_controller->projectManager()->importProjectFile(":/examples/No Project.lpr", /*load=*/ true); });
+    if (m_upload.active) {
+        qWarning() << "Another handoff is in progress.";
+        return;
+    }
+    // the history entries are collected to be able to send only changed blocks later:
+    QHash<QString, QByteArray> entries;
+    const QByteArray data = m_controller->projectManager()->encodeCurrentProjectState(&entries);
+    if (data.isEmpty()) {
+        qWarning() << "Couldn't encode project for handoff.";
+        return;
+    }
+    m_upload = OutgoingTransfer();
+    m_upload.host = ip;
+    m_upload.transferId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    m_upload.fileName = m_controller->projectManager()->getCurrentProjectName();
+    m_upload.data = data;
+    m_upload.entries = entries;
+    m_upload.active = true;
+    connectUpload();
 }
 
-bool HandoffManager::connectToHost(QString host) {
-    m_clientSocket.connectToHost(host, HandoffManagerConstants::PORT);
-    return m_clientSocket.waitForConnected();
+QCborMap HandoffManager::blockHashes(const QHash<QString, QByteArray>& entries) {
+    QCborMap hashes;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        hashes[it.key()] = QCryptographicHash::hash(it.value(), QCryptographicHash::Sha1).left(HMC::blockHashSize);
+    }
+    return hashes;
 }
 
-QByteArray IntToArray(qint32 source) {
-    // Use qint32 to ensure that the number have 4 bytes
-    // Avoid use of cast, this is the Qt way to serialize objects
-    QByteArray temp;
-    QDataStream data(&temp, QIODevice::ReadWrite);
-    data << source;
-    return temp;
+// ---------------------------- Records ------------------------------
+
+QByteArray HandoffManager::encodeRecord(RecordType type, const QByteArray& payload) {
+    return RecordBuffer::encode(type, payload);
 }
 
-bool HandoffManager::writeData(QByteArray data) {
-    if (m_clientSocket.state() == QAbstractSocket::ConnectedState) {
-        m_clientSocket.write(IntToArray(data.size()));  // write size of data
-        m_clientSocket.write(data);  // write the data itself
-        return m_clientSocket.waitForBytesWritten();
-    } else {
-        return false;
+// ---------------------------- Client ------------------------------
+
+void HandoffManager::connectUpload() {
+    if (!m_upload.active) return;
+    m_clientSocket.abort();
+    m_clientBuffer = RecordBuffer();
+    m_upload.resumeReceived = false;
+    m_upload.endSent = false;
+    m_clientSocket.connectToHost(m_upload.host, HMC::PORT);
+}
+
+void HandoffManager::onUploadConnected() {
+    if (!m_upload.active) return;
+    if (m_upload.prepared) {
+        // resuming, the content of the transfer is already known:
+        sendBegin();
+        return;
     }
+    QCborMap request;
+    request["fileName"_q] = m_upload.fileName;
+    m_clientSocket.write(encodeRecord(HashRequestRecord, request.toCborValue().toCbor()));
 }
 
-bool HandoffManager::writeData(QString host, QByteArray data) {
-    if (connectToHost(host)) {
-        return writeData(data);
+void HandoffManager::prepareUpload(const QCborMap& receiverHashes) {
+    if (!receiverHashes.isEmpty()) {
+        // the receiver has the same project open, only send the blocks that differ:
+        const QCborMap hashes = blockHashes(m_upload.entries);
+        QCborMap changed;
+        for (auto it = m_upload.entries.constBegin(); it != m_upload.entries.constEnd(); ++it) {
+            if (receiverHashes.value(it.key()) == hashes.value(it.key())) continue;
+            changed[it.key()] = ProjectHistory::decodeEntry(it.value());
+        }
+        QCborArray removed;
+        for (auto it = receiverHashes.constBegin(); it != receiverHashes.constEnd(); ++it) {
+            if (!m_upload.entries.contains(it.key().toString())) removed.append(it.key());
+        }
+        QCborMap delta;
+        delta["fileName"_q] = m_upload.fileName;
+        delta["displayedGroup"_q] = m_controller->blockManager()->getDisplayedGroup();
+        delta["anchors"_q] = m_controller->anchorManager()->getState();
+        delta["backgroundName"_q] = m_controller->guiManager()->getBackgroundName();
+        delta["changed"_q] = changed;
+        delta["removed"_q] = removed;
+        m_upload.fullData = m_upload.data;
+        m_upload.data = delta.toCborValue().toCbor();
+        m_upload.delta = true;
+        qInfo() << "Handoff sends" << changed.size() << "changed and" << removed.size() << "removed blocks.";
     }
-    return false;
+    m_upload.entries.clear();
+    m_upload.checksum = QCryptographicHash::hash(m_upload.data, QCryptographicHash::Sha1);
+    m_upload.prepared = true;
+    sendBegin();
+}
+
+void HandoffManager::restartWithFullProject() {
+    qInfo() << "Handoff receiver rejected the changes, sending the whole project.";
+    // the receiver dropped the delta transfer, a new one is started on the same connection:
+    m_upload.transferId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    m_upload.data = m_upload.fullData;
+    m_upload.fullData.clear();
+    m_upload.delta = false;
+    m_upload.checksum = QCryptographicHash::hash(m_upload.data, QCryptographicHash::Sha1);
+    m_upload.offset = 0;
+    m_upload.acknowledgedOffset = 0;
+    m_upload.resumeReceived = false;
+    m_upload.endSent = false;
+    sendBegin();
 }
 
+void HandoffManager::sendBegin() {
+    QCborMap begin;
+    begin["transferId"_q] = m_upload.transferId;
+    begin["size"_q] = m_upload.data.size();
+    begin["checksum"_q] = m_upload.checksum;
+    begin["delta"_q] = m_upload.delta;
+    m_clientSocket.write(encodeRecord(BeginRecord, begin.toCborValue().toCbor()));
+}
+
+void HandoffManager::onUploadConnectionLost() {
+    if (!m_upload.active || m_reconnectTimer.isActive()) return;
+    ++m_upload.reconnectAttempts;
+    if (m_upload.reconnectAttempts > HMC::maxReconnectAttempts) {
+        qWarning() << "Handoff to" << m_upload.host << "failed:" << m_clientSocket.errorString();
+        m_upload = OutgoingTransfer();
+        return;
+    }
+    qInfo() << "Handoff interrupted, resuming in" << HMC::reconnectDelayMs << "ms.";
+    m_reconnectTimer.start();
+}
+
+void HandoffManager::processRecordsFromReceiver() {
+    m_clientBuffer.append(m_clientSocket.readAll());
+    quint8 type = 0;
+    QByteArray payload;
+    RecordBuffer::Status status;
+    while ((status = m_clientBuffer.take(HMC::maxRecordSize, type, payload)) == RecordBuffer::Complete) {
+        if (!m_upload.active) continue;
+        if (type == HashesRecord) {
+            if (m_upload.prepared) {
+                // hashes after the end of a delta mean that it couldn't be applied:
+                if (m_upload.delta && m_upload.endSent) restartWithFullProject();
+                continue;
+            }
+            prepareUpload(QCborValue::fromCbor(payload).toMap()["hashes"_q].toMap());
+        } else if (type == ResumeRecord) {
+            const qint64 offset = QCborValue::fromCbor(payload).toMap()["offset"_q].toInteger();
+            m_upload.offset = limit(qint64(0), offset, qint64(m_upload.data.size()));
+            if (m_upload.offset > m_upload.acknowledgedOffset) {
+                // the receiver made progress since the last connection:
+                m_upload.reconnectAttempts = 0;
+            }
+            m_upload.acknowledgedOffset = m_upload.offset;
+            m_upload.resumeReceived = true;
+            continueUpload();
+        } else if (type == DoneRecord) {
+            m_upload = OutgoingTransfer();
+            m_clientSocket.disconnectFromHost();
+            // load / import project should not be used from JS callback
+            // because blocks are deleted immediately (?)
+            QTimer::singleShot(0, this, [this](){ m_controller->projectManager()->importProjectFile(":/examples/No Project.lpr", /*load=*/ true); });
+        }
+    }
+    if (status == RecordBuffer::Corrupt) {
+        qWarning() << "Received corrupt handoff record.";
+        // reconnect, the transfer continues at the offset the receiver reports:
+        m_clientSocket.abort();
+        onUploadConnectionLost();
+    }
+}
+
+void HandoffManager::continueUpload() {
+    if (!m_upload.active || !m_upload.resumeReceived || m_upload.endSent) return;
+    if (m_clientSocket.state() != QAbstractSocket::ConnectedState) return;
+
+    // only write as much as the socket can send soon, the rest is written
+    // when bytesWritten() is emitted:
+    while (m_upload.offset < m_upload.data.size()
+           && m_clientSocket.bytesToWrite() < HMC::maxBytesToWrite) {
+        const int size = int(qMin(qint64(HMC::chunkSize), m_upload.data.size() - m_upload.offset));
+        QByteArray payload(8, Qt::Uninitialized);
+        qToBigEndian<quint64>(quint64(m_upload.offset), reinterpret_cast<uchar*>(payload.data()));
+        payload.append(m_upload.data.constData() + m_upload.offset, size);
+        m_clientSocket.write(encodeRecord(ChunkRecord, payload));
+        m_upload.offset += size;
+    }
+    if (m_upload.offset >= m_upload.data.size()) {
+        m_clientSocket.write(encodeRecord(EndRecord));
+        m_upload.endSent = true;
+    }
+}
+
+// ---------------------------- Server ------------------------------
+
 void HandoffManager::clientConnected() {
     while (m_tcpServer.hasPendingConnections()) {
         QTcpSocket* socket = m_tcpServer.nextPendingConnection();
-        connect(socket, SIGNAL(readyRead()), this, SLOT(processRawPacketsFromClient()));
+        connect(socket, SIGNAL(readyRead()), this, SLOT(processRecordsFromClient()));
         connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
-        QByteArray* buffer = new QByteArray();
-        qint32* s = new qint32(0);
-        m_buffers.insert(socket, buffer);
-        m_sizes.insert(socket, s);
+        m_buffers.insert(socket, RecordBuffer());
     }
 }
 
 void HandoffManager::clientDisconnected() {
     QTcpSocket* socket = static_cast<QTcpSocket*>(sender());
-    QByteArray* buffer = m_buffers.value(socket);
-    qint32* s = m_sizes.value(socket);
+    m_buffers.remove(socket);
+    // the transfer is kept until it is resumed or abandoned:
+    m_socketTransfers.remove(socket);
     socket->deleteLater();
-    delete buffer;
-    delete s;
 }
 
+void HandoffManager::processRecordsFromClient() {
+    QTcpSocket* socket = static_cast<QTcpSocket*>(sender());
+    if (!m_buffers.contains(socket)) return;
+    m_buffers[socket].append(socket->readAll());
+    quint8 type = 0;
+    QByteArray payload;
+    RecordBuffer::Status status;
+    while ((status = m_buffers[socket].take(HMC::maxRecordSize, type, payload)) == RecordBuffer::Complete) {
+        processRecord(socket, type, payload);
+        // the socket could have been aborted while processing the record:
+        if (!m_buffers.contains(socket)) return;
+    }
+    if (status == RecordBuffer::Corrupt) {
+        qWarning() << "Received corrupt handoff record from" << socket->peerAddress().toString();
+        socket->abort();
+    }
+}
 
-qint32 ArrayToInt(QByteArray source) {
-    qint32 temp;
-    QDataStream data(&source, QIODevice::ReadWrite);
-    data >> temp;
-    return temp;
+void HandoffManager::processRecord(QTcpSocket* socket, quint8 type, const QByteArray& payload) {
+    switch (type) {
+    case RequestControlRecord:
+        uploadTo(socket->peerAddress().toString());
+        break;
+    case BeginRecord:
+        beginIncomingTransfer(socket, payload);
+        break;
+    case ChunkRecord:
+        appendChunk(socket, payload);
+        break;
+    case EndRecord:
+        endIncomingTransfer(socket);
+        break;
+    case HashRequestRecord:
+        sendBlockHashes(socket, payload);
+        break;
+    default:
+        qWarning() << "Unknown handoff record type:" << type;
+        break;
+    }
 }
 
-void HandoffManager::processRawPacketsFromClient() {
-    QTcpSocket* socket = static_cast<QTcpSocket*>(sender());
-    QByteArray* buffer = m_buffers.value(socket);
-    qint32* s = m_sizes.value(socket);
-    qint32 size = *s;
-    while (socket->bytesAvailable() > 0) {
-        buffer->append(socket->readAll());
-        while ((size == 0 && buffer->size() >= 4) || (size > 0 && buffer->size() >= size)) {
-            // while can process data, process it
-            if (size == 0 && buffer->size() >= 4) {
-                // if size of data has been received completely, then store it on our global variable
-                size = ArrayToInt(buffer->mid(0, 4));
-                *s = size;
-                buffer->remove(0, 4);
-            } if (size > 0 && buffer->size() >= size) {
-                // if data has been received completely, then emit our SIGNAL with the data
-                QByteArray data = buffer->mid(0, size);
-                buffer->remove(0, size);
-                size = 0;
-                *s = size;
-                processData(socket->peerAddress().toString(), data);
-            }
+void HandoffManager::beginIncomingTransfer(QTcpSocket* socket, const QByteArray& payload) {
+    const QCborMap begin = QCborValue::fromCbor(payload).toMap();
+    const QString transferId = begin["transferId"_q].toString();
+    const qint64 size = begin["size"_q].toInteger();
+    if (transferId.isEmpty() || size <= 0 || size > HMC::maxTransferSize) {
+        qWarning() << "Received invalid handoff request.";
+        socket->abort();
+        return;
+    }
+
+    auto it = m_incomingTransfers.find(transferId);
+    if (it == m_incomingTransfers.end() || it->expectedSize != size) {
+        IncomingTransfer transfer;
+        transfer.hash = QSharedPointer<QCryptographicHash>::create(QCryptographicHash::Sha1);
+        transfer.expectedSize = size;
+        transfer.expectedChecksum = begin["checksum"_q].toByteArray();
+        transfer.delta = begin["delta"_q].toBool();
+        if (transfer.delta) {
+            // a delta is small and applied at once when it is complete:
+            transfer.parseState = ParseStopped;
         }
+        it = m_incomingTransfers.insert(transferId, transfer);
+    } else {
+        qInfo() << "Resuming handoff at" << it->data.size() << "of" << size << "bytes.";
     }
+    it->lastActivity = QDateTime::currentMSecsSinceEpoch();
+    m_socketTransfers.insert(socket, transferId);
+    if (!m_abandonTimer.isActive()) m_abandonTimer.start();
+
+    QCborMap resume;
+    resume["offset"_q] = it->data.size();
+    socket->write(encodeRecord(ResumeRecord, resume.toCborValue().toCbor()));
 }
 
-void HandoffManager::processData(QString ip, QByteArray data) {
-    if (data == HandoffManagerConstants::requestControlMessage) {
-        uploadTo(ip);
-    } else {
-        receivedProject(data);
+void HandoffManager::appendChunk(QTcpSocket* socket, const QByteArray& payload) {
+    const QString transferId = m_socketTransfers.value(socket);
+    auto it = m_incomingTransfers.find(transferId);
+    if (it == m_incomingTransfers.end() || payload.size() < 8) {
+        qWarning() << "Received handoff chunk without transfer.";
+        socket->abort();
+        return;
+    }
+    IncomingTransfer& transfer = *it;
+    transfer.lastActivity = QDateTime::currentMSecsSinceEpoch();
+
+    const qint64 offset = qint64(qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(payload.constData())));
+    const int chunkSize = payload.size() - 8;
+    if (offset > transfer.data.size() || offset + chunkSize > transfer.expectedSize) {
+        // chunks are sent in order, a gap means the sender is confused,
+        // reconnecting makes it continue at the right offset:
+        qWarning() << "Received handoff chunk at unexpected offset.";
+        socket->abort();
+        return;
+    }
+    // skip the part that was already received before the transfer was resumed:
+    const int skip = int(transfer.data.size() - offset);
+    if (skip >= chunkSize) return;
+    const char* newData = payload.constData() + 8 + skip;
+    const int newSize = chunkSize - skip;
+    if (transfer.data.isEmpty()) transfer.data.reserve(int(qMin(transfer.expectedSize, HMC::maxReserveSize)));
+    transfer.data.append(newData, newSize);
+    transfer.hash->addData(newData, newSize);
+
+    if (!transfer.parseScheduled) {
+        processIncomingTransfer(transferId);
     }
 }
 
-void HandoffManager::receivedProject(QByteArray data) {
-    QCborValue val = QCborValue::fromCbor(data);
-    if (!val.isMap()) {
-        qWarning() << "Received project state is invalid.";
+void HandoffManager::endIncomingTransfer(QTcpSocket* socket) {
+    const QString transferId = m_socketTransfers.value(socket);
+    auto it = m_incomingTransfers.find(transferId);
+    if (it == m_incomingTransfers.end()) return;
+    IncomingTransfer& transfer = *it;
+
+    if (transfer.data.size() != transfer.expectedSize
+            || transfer.hash->result() != transfer.expectedChecksum) {
+        qWarning() << "Received handoff project is corrupt, restarting transfer.";
+        if (transfer.streamed) {
+            // the partially restored project must not be saved, the previous one is loaded again:
+            m_controller->projectManager()->abortStreamedProject();
+        }
+        m_incomingTransfers.erase(it);
+        m_socketTransfers.remove(socket);
+        socket->abort();
         return;
     }
-    QCborMap projectState = val.toMap();
-    QString fileName = projectState["fileName"_q].toString();
-    if (fileName.isEmpty()) {
-        qWarning() << "Couldn't find filename in project state.";
+    if (transfer.delta && !deltaIsApplicable(transfer.data)) {
+        qWarning() << "Received handoff delta doesn't match the current project anymore, requesting whole project.";
+        m_incomingTransfers.erase(it);
+        m_socketTransfers.remove(socket);
+        // empty hashes make the sender transfer the whole project:
+        QCborMap answer;
+        answer["hashes"_q] = QCborMap();
+        socket->write(encodeRecord(HashesRecord, answer.toCborValue().toCbor()));
         return;
     }
-    // TODO: check version
-    m_controller->dao()->saveFile(PMC::subdirectory, fileName + PMC::fileEnding, projectState);
-    m_controller->projectManager()->setCurrentProject(fileName, false, true, /*reload*/ true);
+    transfer.complete = true;
+    socket->write(encodeRecord(DoneRecord));
+
+    // save the file to be able to load it again later:
+    const QString fileName = transfer.projectState["fileName"_q].toString();
+    if (!fileName.isEmpty()) {
+        m_controller->dao()->saveFile(PMC::subdirectory, fileName + PMC::fileEnding, transfer.data);
+    }
+    completeIncomingTransfer(transferId);
+}
+
+void HandoffManager::sendBlockHashes(QTcpSocket* socket, const QByteArray& payload) {
+    const QString fileName = QCborValue::fromCbor(payload).toMap()["fileName"_q].toString();
+    ProjectManager* projectManager = m_controller->projectManager();
+    QCborMap answer;
+    // hashes are only sent if a delta can be applied to the current project,
+    // otherwise the empty map makes the sender transfer the whole project:
+    if (!fileName.isEmpty() && fileName == projectManager->getCurrentProjectName() && !projectManager->isLoading()) {
+        answer["hashes"_q] = blockHashes(projectManager->history()->currentEntries());
+    } else {
+        answer["hashes"_q] = QCborMap();
+    }
+    socket->write(encodeRecord(HashesRecord, answer.toCborValue().toCbor()));
+}
+
+bool HandoffManager::deltaIsApplicable(const QByteArray& data) const {
+    const QString fileName = QCborValue::fromCbor(data).toMap()["fileName"_q].toString();
+    ProjectManager* projectManager = m_controller->projectManager();
+    return !fileName.isEmpty() && fileName == projectManager->getCurrentProjectName() && !projectManager->isLoading();
+}
+
+void HandoffManager::applyDelta(const QByteArray& data) {
+    if (!deltaIsApplicable(data)) {
+        qWarning() << "Received handoff delta doesn't match the current project anymore.";
+        return;
+    }
+    const QCborMap delta = QCborValue::fromCbor(data).toMap();
+    ProjectManager* projectManager = m_controller->projectManager();
+    QStringList removed;
+    for (QCborValueRef uid: delta["removed"_q].toArray()) {
+        removed.append(uid.toString());
+    }
+    BlockManager* blockManager = m_controller->blockManager();
+    blockManager->applyStateDelta(delta["changed"_q].toMap(), removed);
+    blockManager->setDisplayedGroup(delta["displayedGroup"_q].toString());
+    m_controller->anchorManager()->setState(delta["anchors"_q].toMap());
+    m_controller->guiManager()->setBackgroundName(delta["backgroundName"_q].toString());
+    // make the handoff undoable and persist it like a received project:
+    projectManager->history()->commitCurrentState();
+    projectManager->saveCurrentProject();
+}
+
+void HandoffManager::processIncomingTransfer(QString transferId) {
+    auto it = m_incomingTransfers.find(transferId);
+    if (it == m_incomingTransfers.end()) return;
+    IncomingTransfer& transfer = *it;
+    transfer.parseScheduled = false;
+
+    HighResTime::time_point_t start = HighResTime::now();
+    while (parseNextItem(transfer)) {
+        if (HighResTime::elapsedSecSince(start) * 1000 > HMC::restoreDurationMs) {
+            // restoreDurationMs is over, continue work in next frame:
+            transfer.parseScheduled = true;
+            QTimer::singleShot(8, this, [this, transferId]() { processIncomingTransfer(transferId); });
+            return;
+        }
+    }
+    if (transfer.parseState == ParseDone || transfer.parseState == ParseStopped) {
+        completeIncomingTransfer(transferId);
+    }
+}
+
+bool HandoffManager::parseNextItem(IncomingTransfer& transfer) {
+    if (transfer.parseOffset >= transfer.data.size()) return false;
+    const QByteArray remaining = QByteArray::fromRawData(transfer.data.constData() + transfer.parseOffset,
+                                                         transfer.data.size() - transfer.parseOffset);
+    const quint8 firstByte = quint8(remaining.at(0));
+    // break byte that ends an indefinite length map or array:
+    const quint8 breakByte = 0xff;
+
+    switch (transfer.parseState) {
+    case ParseHeader:
+        // the project is an indefinite length map (see ProjectManager::encodeCurrentProjectState()):
+        if (firstByte != 0xbf) {
+            qWarning() << "Received handoff project can't be restored while receiving it.";
+            transfer.parseState = ParseStopped;
+            return false;
+        }
+        transfer.parseOffset += 1;
+        transfer.parseState = ParseEntries;
+        return true;
+
+    case ParseEntries: {
+        if (firstByte == breakByte) {
+            transfer.parseOffset += 1;
+            transfer.parseState = ParseDone;
+            return false;
+        }
+        QCborStreamReader reader(remaining);
+        const QString key = readCborString(reader);
+        if (reader.lastError() == QCborError::EndOfFile) return false;
+
+        if (key == "blocks"_q) {
+            if (!reader.isArray() || reader.isLengthKnown()) {
+                transfer.parseState = ParseStopped;
+                return false;
+            }
+            if (!m_controller->projectManager()->beginStreamedProject(transfer.projectState["fileName"_q].toString(),
+                                                                     transfer.projectState)) {
+                // another project is currently loading, it is loaded after it has been received:
+                transfer.parseState = ParseStopped;
+                return false;
+            }
+            transfer.streamed = true;
+            // skip the start of the array:
+            transfer.parseOffset += int(reader.currentOffset()) + 1;
+            transfer.parseState = ParseBlocks;
+            return true;
+        }
+        const QCborValue value = QCborValue::fromCbor(reader);
+        if (reader.lastError() == QCborError::EndOfFile) return false;
+        if (reader.lastError() != QCborError::NoError) {
+            transfer.parseState = ParseStopped;
+            return false;
+        }
+        transfer.projectState[key] = value;
+        transfer.parseOffset += int(reader.currentOffset());
+        return true;
+    }
+
+    case ParseBlocks: {
+        if (firstByte == breakByte) {
+            transfer.parseOffset += 1;
+            transfer.parseState = ParseEntries;
+            return true;
+        }
+        // check that the block state is complete before restoring it:
+        QCborStreamReader probe(remaining);
+        probe.next();
+        if (probe.lastError() == QCborError::EndOfFile) return false;
+        if (probe.lastError() != QCborError::NoError) {
+            transfer.parseState = ParseStopped;
+            return false;
+        }
+        QCborStreamReader reader(remaining);
+        m_controller->blockManager()->restoreBlock(reader, /*animated*/ false);
+        transfer.parseOffset += int(probe.currentOffset());
+        return true;
+    }
+
+    case ParseDone:
+    case ParseStopped:
+        return false;
+    }
+    return false;
+}
+
+void HandoffManager::completeIncomingTransfer(QString transferId) {
+    auto it = m_incomingTransfers.find(transferId);
+    if (it == m_incomingTransfers.end() || !it->complete) return;
+    IncomingTransfer& transfer = *it;
+
+    if (transfer.delta) {
+        applyDelta(transfer.data);
+    } else if (transfer.streamed) {
+        // the parser finishes the project when it reached the end:
+        if (transfer.parseState != ParseDone && transfer.parseState != ParseStopped) return;
+        if (transfer.parseState == ParseStopped) {
+            // the complete file has already been saved, it is loaded instead of the partial project:
+            qWarning() << "Received handoff project could only be partially restored, loading it from file.";
+            m_controller->projectManager()->abortStreamedProject(transfer.projectState["fileName"_q].toString());
+        } else {
+            m_controller->projectManager()->finishStreamedProject(transfer.projectState["connections"_q].toArray());
+        }
+    } else {
+        const QCborMap projectState = QCborValue::fromCbor(transfer.data).toMap();
+        const QString fileName = projectState["fileName"_q].toString();
+        if (fileName.isEmpty()) {
+            qWarning() << "Couldn't find filename in project state.";
+        } else {
+            if (transfer.projectState.isEmpty()) {
+                // the file was not saved yet because the header couldn't be decoded while receiving:
+                m_controller->dao()->saveFile(PMC::subdirectory, fileName + PMC::fileEnding, transfer.data);
+            }
+            // TODO: check version
+            m_controller->projectManager()->setCurrentProject(fileName, false, true, /*reload*/ true);
+        }
+    }
+    m_incomingTransfers.erase(it);
+    for (auto socketIt = m_socketTransfers.begin(); socketIt != m_socketTransfers.end();) {
+        if (socketIt.value() == transferId) {
+            socketIt = m_socketTransfers.erase(socketIt);
+        } else {
+            ++socketIt;
+        }
+    }
+}
+
+void HandoffManager::checkAbandonedTransfers() {
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = m_incomingTransfers.begin(); it != m_incomingTransfers.end();) {
+        const bool connected = !m_socketTransfers.keys(it.key()).isEmpty();
+        if (connected || now - it->lastActivity < HMC::resumeTimeoutMs) {
+            ++it;
+            continue;
+        }
+        qWarning() << "Handoff was not resumed in time, discarding it.";
+        if (it->streamed) {
+            // the partially restored project must not be saved, the previous one is loaded again:
+            m_controller->projectManager()->abortStreamedProject();
+        }
+        it = m_incomingTransfers.erase(it);
+    }
+    if (m_incomingTransfers.isEmpty()) m_abandonTimer.stop();
 }
@@ -4,14 +4,93 @@
 #include <QObject>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QCryptographicHash>
+#include <QCborMap>
+#include <QCborArray>
+#include <QSharedPointer>
 #include <QVector>
 #include <QHash>
 #include <QTimer>
 
+#include "core/helpers/RecordBuffer.h"
+
 // forward declaration to prevent dependency loop
 class CoreController;
 
 
+/**
+ * @brief The HandoffManagerConstants namespace contains all constants used in HandoffManager.
+ */
+namespace HandoffManagerConstants {
+    /**
+     * @brief PORT is the TCP port used for handoffs
+     */
+    static const quint16 PORT = 51235;
+    /**
+     * @brief chunkSize is the maximum number of project bytes sent in one record
+     */
+    static const int chunkSize = 64 * 1024;
+    /**
+     * @brief maxRecordSize is the maximum size of a record payload (i.e. the block hashes),
+     * larger records are treated as corrupt
+     */
+    static const int maxRecordSize = 16 * 1024 * 1024;
+    /**
+     * @brief maxTransferSize is the maximum size of a received project,
+     * larger handoff requests are rejected
+     */
+    static const qint64 maxTransferSize = 256 * 1024 * 1024;
+    /**
+     * @brief maxReserveSize is the maximum number of bytes reserved in advance for a received project
+     */
+    static const qint64 maxReserveSize = 16 * 1024 * 1024;
+    /**
+     * @brief maxBytesToWrite is the maximum number of bytes waiting in the socket buffer
+     * before no more chunks are written
+     */
+    static const qint64 maxBytesToWrite = 1024 * 1024;
+    /**
+     * @brief maxReconnectAttempts is the number of reconnects after an upload was interrupted
+     * without making any progress in between
+     */
+    static const int maxReconnectAttempts = 5;
+    /**
+     * @brief reconnectDelayMs is the time in ms to wait before reconnecting
+     */
+    static const int reconnectDelayMs = 2000;
+    /**
+     * @brief resumeTimeoutMs is the time in ms a receiver waits for an interrupted transfer to be resumed
+     */
+    static const int resumeTimeoutMs = 60000;
+    /**
+     * @brief restoreDurationMs is the time in ms that can be spent restoring received blocks per frame
+     */
+    static const int restoreDurationMs = 12;
+    /**
+     * @brief blockHashSize is the number of bytes of the SHA-1 hash used to compare blocks
+     * in differential handoffs
+     */
+    static const int blockHashSize = 8;
+}
+
+
+/**
+ * @brief The HandoffManager class transfers the current project to another instance
+ * and receives projects from other instances.
+ *
+ * Before uploading, the sender asks the receiver for hashes of its blocks. If the receiver
+ * has the same project open, only the blocks (including their outgoing connections)
+ * that differ are sent and applied in place. Otherwise the whole project is sent.
+ * If the receiver switched to another project in the meantime, it answers the delta with
+ * empty hashes and the whole project is sent instead.
+ *
+ * The project is sent in checksummed chunks. An interrupted upload is continued
+ * after reconnecting from the offset the receiver reports. The receiver decodes the project
+ * while it arrives and restores each block as soon as it has been received completely.
+ *
+ * All messages are records with the format [u8 type][u32 payload size][u16 checksum][payload],
+ * integers are big endian.
+ */
 class HandoffManager : public QObject
 {
     Q_OBJECT
@@ -27,27 +106,163 @@ public slots:
 
 private slots:
     // client:
-    bool connectToHost(QString host);
-    bool writeData(QByteArray data);
-    bool writeData(QString host, QByteArray data);
+    void connectUpload();
+    void onUploadConnected();
+    void onUploadConnectionLost();
+    void processRecordsFromReceiver();
+    void continueUpload();
 
     // server:
     void clientConnected();
     void clientDisconnected();
-    void processRawPacketsFromClient();
-    void processData(QString ip, QByteArray data);
-    void receivedProject(QByteArray data);
+    void processRecordsFromClient();
+    void checkAbandonedTransfers();
 
 protected:
+    /**
+     * @brief The RecordType enum contains the types of records
+     */
+    enum RecordType : quint8 {
+        RequestControlRecord = 1,  //!< asks the receiver to upload its project, no payload
+        BeginRecord,  //!< starts or resumes a transfer, CBOR map with transferId, size and checksum
+        ResumeRecord,  //!< answer to BeginRecord, CBOR map with the offset to continue at
+        ChunkRecord,  //!< u64 offset followed by the project data
+        EndRecord,  //!< all chunks have been sent, no payload
+        DoneRecord,  //!< the receiver verified the complete project, no payload
+        HashRequestRecord,  //!< asks for the block hashes, CBOR map with the fileName of the project
+        HashesRecord,  //!< answer to HashRequestRecord, CBOR map with the hashes by block UID,
+                       //!< empty hashes instead of DoneRecord if a received delta can't be applied
+    };
+
+    /**
+     * @brief The OutgoingTransfer struct contains the state of the current upload.
+     */
+    struct OutgoingTransfer {
+        QString host;
+        QString transferId;
+        QString fileName;
+        QByteArray data;  //!< the complete project until it was replaced by a delta
+        QByteArray fullData;  //!< the complete project if data is a delta, to send it if the delta is rejected
+        QByteArray checksum;
+        QHash<QString, QByteArray> entries;  //!< ProjectHistory entries of all blocks
+        bool prepared = false;  //!< true if it was decided if a delta or the whole project is sent
+        bool delta = false;
+        qint64 offset = 0;  //!< offset of the next chunk to send
+        qint64 acknowledgedOffset = 0;  //!< offset the receiver reported last
+        int reconnectAttempts = 0;
+        bool resumeReceived = false;
+        bool endSent = false;
+        bool active = false;
+    };
+
+    /**
+     * @brief The ParseState enum is the state of the incremental project decoder
+     */
+    enum ParseState {
+        ParseHeader,  //!< waiting for the start of the project map
+        ParseEntries,  //!< reading the entries of the project map
+        ParseBlocks,  //!< restoring the entries of the blocks array
+        ParseDone,  //!< the end of the project map has been reached
+        ParseStopped,  //!< not decoding (invalid data or another project is loading)
+    };
+
+    /**
+     * @brief The IncomingTransfer struct contains the state of a received project.
+     */
+    struct IncomingTransfer {
+        QByteArray data;
+        QSharedPointer<QCryptographicHash> hash;
+        qint64 expectedSize = 0;
+        QByteArray expectedChecksum;
+        qint64 lastActivity = 0;  //!< msecs since epoch of the last received record
+
+        ParseState parseState = ParseHeader;
+        int parseOffset = 0;
+        bool parseScheduled = false;
+        QCborMap projectState;  //!< all entries of the project except the blocks
+        bool streamed = false;  //!< true if the blocks are restored while they are received
+        bool delta = false;  //!< true if only the differences to the current project are received
+        bool complete = false;  //!< true if all data has been received and verified
+    };
+
+    static QByteArray encodeRecord(RecordType type, const QByteArray& payload = QByteArray());
+
+    /**
+     * @brief blockHashes calculates the hashes used to compare blocks in differential handoffs
+     * @param entries ProjectHistory entries of all blocks
+     * @return map of block UID -> truncated hash of the entry
+     */
+    static QCborMap blockHashes(const QHash<QString, QByteArray>& entries);
+
+    // client:
+    /**
+     * @brief prepareUpload replaces the project data by the differences to the receiver's blocks
+     * if it has the same project open and starts the transfer
+     * @param receiverHashes block hashes of the receiver, empty if the whole project has to be sent
+     */
+    void prepareUpload(const QCborMap& receiverHashes);
+
+    /**
+     * @brief restartWithFullProject sends the whole project after the receiver rejected the delta
+     */
+    void restartWithFullProject();
+    void sendBegin();
+
+    // server:
+    void processRecord(QTcpSocket* socket, quint8 type, const QByteArray& payload);
+    void beginIncomingTransfer(QTcpSocket* socket, const QByteArray& payload);
+    void appendChunk(QTcpSocket* socket, const QByteArray& payload);
+    void endIncomingTransfer(QTcpSocket* socket);
+    void sendBlockHashes(QTcpSocket* socket, const QByteArray& payload);
+
+    /**
+     * @brief deltaIsApplicable checks if a received delta belongs to the current project
+     * and can be applied now
+     * @param data the CBOR encoded delta
+     * @return true if applyDelta() can be called
+     */
+    bool deltaIsApplicable(const QByteArray& data) const;
+
+    /**
+     * @brief applyDelta updates the current project in place with a received delta
+     * @param data the CBOR encoded delta
+     */
+    void applyDelta(const QByteArray& data);
+
+    /**
+     * @brief processIncomingTransfer decodes the received part of a project
+     * and restores completely received blocks until the time budget is exhausted
+     * @param transferId id of the transfer
+     */
+    void processIncomingTransfer(QString transferId);
+
+    /**
+     * @brief parseNextItem decodes the next complete item of a project
+     * @param transfer the transfer to decode
+     * @return false if more data is needed or decoding stopped
+     */
+    bool parseNextItem(IncomingTransfer& transfer);
+
+    /**
+     * @brief completeIncomingTransfer loads the project if it has been received and decoded completely
+     * @param transferId id of the transfer
+     */
+    void completeIncomingTransfer(QString transferId);
+
     CoreController* const m_controller;  //!< pointer to CoreController instance
 
     // client:
-   QTcpSocket m_clientSocket;
+    QTcpSocket m_clientSocket;
+    RecordBuffer m_clientBuffer;
+    OutgoingTransfer m_upload;
+    QTimer m_reconnectTimer;
 
     // server:
     QTcpServer m_tcpServer;
-    QHash<QTcpSocket*, QByteArray*> m_buffers;  // we need a buffer to store data until block has been completely received
-    QHash<QTcpSocket*, qint32*> m_sizes;  // we need to store the size to verify if a block has been received completely
+    QHash<QTcpSocket*, RecordBuffer> m_buffers;  // we need a buffer to store data until a record has been completely received
+    QHash<QTcpSocket*, QString> m_socketTransfers;  // the id of the transfer a socket is sending
+    QHash<QString, IncomingTransfer> m_incomingTransfers;  // also contains interrupted transfers until they are resumed
+    QTimer m_abandonTimer;
 };
 
 #endif // HANDOFFMANAGER_H
@@ -0,0 +1,283 @@
+#include "NodeDataStreamer.h"
+
+#include "core/CoreController.h"
+#include "core/manager/BlockManager.h"
+#include "core/manager/Engine.h"
+#include "core/manager/WebsocketConnection.h"
+#include "core/connections/Nodes.h"
+
+#include <QCborArray>
+#include <QCborStreamWriter>
+#include <QtEndian>
+#include <QWebSocket>
+
+#include <cstring>
+
+#include <QDebug>
+
+
+// create a shorter alias for the constants namespace:
+namespace NDSC = NodeDataStreamerConstants;
+
+
+namespace {
+
+void appendVarint(QByteArray& out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray& in, int& pos, quint32& value) {
+    value = 0;
+    int shift = 0;
+    while (pos < in.size() && shift < 32) {
+        const quint8 byte = quint8(in.at(pos++));
+        value |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+        shift += 7;
+    }
+    return false;
+}
+
+}  // namespace
+
+
+NodeDataStreamer::NodeDataStreamer(CoreController* controller, QObject* parent)
+    : QObject(parent)
+    , m_controller(controller)
+{
+    connect(m_controller->engine(), &Engine::updateOutput, this, &NodeDataStreamer::sendUpdates);
+}
+
+void NodeDataStreamer::subscribe(QWebSocket* client, const QCborMap& request) {
+    const int bits = request.value(QLatin1String("bits")).toInteger(8) == 16 ? 16 : 8;
+    const int fps = qBound(1, int(request.value(QLatin1String("maxFps")).toInteger(NDSC::maxFps)), NDSC::maxFps);
+
+    auto subscriber = m_subscribers.find(client);
+    if (subscriber == m_subscribers.end()) {
+        subscriber = m_subscribers.insert(client, Subscriber{{}, bits, 1.0 / fps, HighResTime::time_point_t()});
+    } else {
+        if (subscriber->bits != bits) {
+            // the next update has to be a keyframe:
+            for (NodeSubscription& node: subscriber->nodes) {
+                node.lastFrame.clear();
+            }
+        }
+        subscriber->bits = bits;
+        subscriber->minInterval = 1.0 / fps;
+    }
+
+    const QCborArray nodeUids = request.value(QLatin1String("nodeUids")).toArray();
+    for (const QCborValue& value: nodeUids) {
+        const QString uid = value.toString();
+        if (!uid.contains("|")) {
+            qWarning() << "NodeDataStreamer: Invalid node UID" << uid;
+            continue;
+        }
+        if (subscriber->nodes.contains(uid)) continue;
+        if (subscriber->nodes.size() >= NDSC::maxNodesPerClient) {
+            qWarning() << "NodeDataStreamer: Too many subscribed nodes.";
+            break;
+        }
+        subscriber->nodes.insert(uid, NodeSubscription{m_controller->blockManager()->getNodeByUid(uid), {}, 0, 0});
+    }
+}
+
+void NodeDataStreamer::unsubscribe(QWebSocket* client, const QCborMap& request) {
+    auto subscriber = m_subscribers.find(client);
+    if (subscriber == m_subscribers.end()) return;
+    if (request.contains(QLatin1String("nodeUids"))) {
+        for (const QCborValue& uid: request.value(QLatin1String("nodeUids")).toArray()) {
+            subscriber->nodes.remove(uid.toString());
+        }
+    } else {
+        subscriber->nodes.clear();
+    }
+    if (subscriber->nodes.isEmpty()) {
+        m_subscribers.erase(subscriber);
+    }
+}
+
+void NodeDataStreamer::removeClient(QWebSocket* client) {
+    m_subscribers.remove(client);
+}
+
+bool NodeDataStreamer::applyUpdate(const QCborMap& update, QByteArray& frame) {
+    const int bytesPerSample = update.value(QLatin1String("bits")).toInteger() == 16 ? 2 : 1;
+    const qint64 width = update.value(QLatin1String("width")).toInteger();
+    const qint64 height = update.value(QLatin1String("height")).toInteger();
+    const qint64 frameSize = width * height * 3 * bytesPerSample;
+    const QByteArray data = update.value(QLatin1String("data")).toByteArray();
+
+    if (update.value(QLatin1String("keyframe")).toBool()) {
+        if (data.size() != frameSize) return false;
+        frame = data;
+        return true;
+    }
+
+    if (frame.size() != frameSize) return false;
+    int pos = 0;
+    qint64 sample = 0;
+    while (pos < data.size()) {
+        quint32 skip = 0;
+        quint32 length = 0;
+        if (!readVarint(data, pos, skip) || !readVarint(data, pos, length)) return false;
+        sample += skip;
+        const qint64 bytes = qint64(length) * bytesPerSample;
+        const qint64 target = sample * bytesPerSample;
+        if (target + bytes > frame.size() || pos + bytes > data.size()) return false;
+        std::memcpy(frame.data() + target, data.constData() + pos, size_t(bytes));
+        pos += int(bytes);
+        sample += length;
+    }
+    return true;
+}
+
+void NodeDataStreamer::sendUpdates() {
+    if (m_subscribers.isEmpty()) return;
+    const HighResTime::time_point_t now = HighResTime::now();
+    // allow some jitter of the engine timer, otherwise every second frame
+    // would be skipped at the maximum rate:
+    const double tolerance = 0.5 / NDSC::maxFps;
+
+    // each frame is only quantized once per node and bit depth:
+    QHash<QPair<NodeBase*, int>, QByteArray> quantizedFrames;
+
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it) {
+        Subscriber& subscriber = it.value();
+        if (HighResTime::diff(now, subscriber.lastUpdate) + tolerance < subscriber.minInterval) continue;
+        // the updates are delta encoded and can't be dropped later,
+        // slow clients just get less frequent updates instead:
+        if (m_controller->websocketConnection()->isClientBusy(it.key())) continue;
+
+        QByteArray message;
+        QCborStreamWriter writer(&message);
+        writer.startMap(2);
+        writer.append(QLatin1String("requestType"));
+        writer.append(WsRequestTypes::NODE_DATA);
+        writer.append(QLatin1String("nodes"));
+        writer.startMap();
+        int updateCount = 0;
+
+        for (auto nodeIt = subscriber.nodes.begin(); nodeIt != subscriber.nodes.end(); ++nodeIt) {
+            NodeSubscription& subscription = nodeIt.value();
+            if (!subscription.node) {
+                // the block may have been created after the subscription:
+                subscription.node = m_controller->blockManager()->getNodeByUid(nodeIt.key());
+                if (!subscription.node) continue;
+            }
+            const auto frameKey = qMakePair(subscription.node.data(), subscriber.bits);
+            auto frame = quantizedFrames.find(frameKey);
+            if (frame == quantizedFrames.end()) {
+                frame = quantizedFrames.insert(frameKey, quantizeFrame(subscription.node, subscriber.bits));
+            }
+            const int width = subscription.node->constData().width();
+            const int height = subscription.node->constData().height();
+
+            QByteArray data;
+            bool keyframe = subscription.lastFrame.isEmpty()
+                    || width != subscription.lastWidth || height != subscription.lastHeight;
+            if (!keyframe) {
+                if (frame.value() == subscription.lastFrame) continue;
+                data = encodeDelta(subscription.lastFrame, frame.value(), subscriber.bits / 8);
+                // i.e. if all values changed:
+                keyframe = data.size() >= frame->size();
+            }
+            if (keyframe) {
+                data = frame.value();
+            }
+
+            writer.append(nodeIt.key());
+            writer.startMap(5);
+            writer.append(QLatin1String("width"));
+            writer.append(qint64(width));
+            writer.append(QLatin1String("height"));
+            writer.append(qint64(height));
+            writer.append(QLatin1String("bits"));
+            writer.append(qint64(subscriber.bits));
+            writer.append(QLatin1String("keyframe"));
+            writer.append(keyframe);
+            writer.append(QLatin1String("data"));
+            writer.append(data);
+            writer.endMap();
+
+            subscription.lastFrame = frame.value();
+            subscription.lastWidth = width;
+            subscription.lastHeight = height;
+            ++updateCount;
+        }
+        writer.endMap();
+        writer.endMap();
+
+        // if nothing changed, the next change is sent without waiting for the interval:
+        if (updateCount == 0) continue;
+        subscriber.lastUpdate = now;
+        emit updateReady(it.key(), message);
+    }
+}
+
+QByteArray NodeDataStreamer::quantizeFrame(const NodeBase* node, int bits) {
+    const RgbMatrix& rgb = node->constData().getRgb();
+    const int width = node->constData().width();
+    const int height = node->constData().height();
+    const int bytesPerSample = bits / 8;
+    QByteArray frame(width * height * 3 * bytesPerSample, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(frame.data());
+
+    if (bits == 16) {
+        auto quantize = [](double value) { return quint16(qBound(0.0, value, 1.0) * 65535 + 0.5); };
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const RGB& color = rgb.at(x, y);
+                qToLittleEndian<quint16>(quantize(color.r), out);
+                qToLittleEndian<quint16>(quantize(color.g), out + 2);
+                qToLittleEndian<quint16>(quantize(color.b), out + 4);
+                out += 6;
+            }
+        }
+    } else {
+        auto quantize = [](double value) { return uchar(qBound(0.0, value, 1.0) * 255 + 0.5); };
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const RGB& color = rgb.at(x, y);
+                *out++ = quantize(color.r);
+                *out++ = quantize(color.g);
+                *out++ = quantize(color.b);
+            }
+        }
+    }
+    return frame;
+}
+
+QByteArray NodeDataStreamer::encodeDelta(const QByteArray& previous, const QByteArray& current, int bytesPerSample) {
+    const int sampleCount = current.size() / bytesPerSample;
+    auto isUnchanged = [&](int sample) {
+        return std::memcmp(previous.constData() + sample * bytesPerSample,
+                           current.constData() + sample * bytesPerSample, size_t(bytesPerSample)) == 0;
+    };
+
+    QByteArray delta;
+    int lastSpanEnd = 0;
+    int sample = 0;
+    while (sample < sampleCount) {
+        if (isUnchanged(sample)) {
+            ++sample;
+            continue;
+        }
+        // extend the span over short gaps of unchanged samples:
+        const int spanStart = sample;
+        int spanEnd = sample + 1;
+        for (int next = spanEnd; next < sampleCount && next - spanEnd < NDSC::maxSpanGap + 1; ++next) {
+            if (!isUnchanged(next)) spanEnd = next + 1;
+        }
+        appendVarint(delta, quint32(spanStart - lastSpanEnd));
+        appendVarint(delta, quint32(spanEnd - spanStart));
+        delta.append(current.constData() + spanStart * bytesPerSample, (spanEnd - spanStart) * bytesPerSample);
+        lastSpanEnd = spanEnd;
+        sample = spanEnd;
+    }
+    return delta;
+}
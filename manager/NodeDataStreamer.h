@@ -0,0 +1,158 @@
+#ifndef NODEDATASTREAMER_H
+#define NODEDATASTREAMER_H
+
+#include "core/helpers/utils.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QCborMap>
+#include <QHash>
+#include <QPointer>
+#include <QString>
+
+// forward declaration to prevent dependency loop
+class CoreController;
+class NodeBase;
+class QWebSocket;
+
+
+/**
+ * @brief The NodeDataStreamerConstants namespace contains all constants used in NodeDataStreamer.
+ */
+namespace NodeDataStreamerConstants {
+    /**
+     * @brief maxFps is the maximum update rate a client can request (the engine frame rate)
+     */
+    static const int maxFps = 50;
+    /**
+     * @brief maxNodesPerClient is the maximum number of nodes a single client can subscribe to
+     */
+    static const int maxNodesPerClient = 64;
+    /**
+     * @brief maxSpanGap is the number of unchanged samples between two changed ones
+     * that are still sent as part of the same span (a new span costs at least two bytes)
+     */
+    static const int maxSpanGap = 2;
+}
+
+/**
+ * @brief The NodeDataStreamer class sends the data of nodes to subscribed websocket clients every frame.
+ *
+ * A client subscribes with a WsRequestTypes::NODE_DATA_SUBSCRIBE message containing "nodeUids",
+ * "maxFps" and "bits" (8 or 16). After each engine frame, a WsRequestTypes::NODE_DATA message is sent
+ * to the client containing a map "nodes" of node UID -> update, but only for nodes whose data changed
+ * and not more often than maxFps.
+ *
+ * Each update contains "width", "height", "bits", "keyframe" and "data". The RGB values of the matrix are
+ * quantized to unsigned 8 or 16 bit integers (little endian) in row-major order. If "keyframe" is true,
+ * "data" contains the whole frame, otherwise it contains the spans that changed since the last update
+ * of this node, each as varint offset from the end of the last span, varint length in samples and the samples.
+ * Use applyUpdate() on the client side to decode it.
+ */
+class NodeDataStreamer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief NodeDataStreamer creates a streamer without subscribers
+     * @param controller a pointer to the CoreController
+     * @param parent QObject parent
+     */
+    explicit NodeDataStreamer(CoreController* controller, QObject* parent = nullptr);
+
+    /**
+     * @brief subscribe adds nodes to the subscription of a client
+     * @param client the client that sent the request
+     * @param request containing "nodeUids" and optionally "maxFps" and "bits"
+     */
+    void subscribe(QWebSocket* client, const QCborMap& request);
+
+    /**
+     * @brief unsubscribe removes nodes from the subscription of a client
+     * @param client the client that sent the request
+     * @param request containing "nodeUids", all nodes are removed if it is missing
+     */
+    void unsubscribe(QWebSocket* client, const QCborMap& request);
+
+    /**
+     * @brief removeClient removes all subscriptions of a client, i.e. because it disconnected
+     * @param client the client
+     */
+    void removeClient(QWebSocket* client);
+
+    /**
+     * @brief applyUpdate decodes an update received by a client
+     * @param update a single node update as described above
+     * @param frame the last frame of this node, it is updated in place
+     * @return false if the update could not be applied (i.e. a delta without matching previous frame)
+     */
+    static bool applyUpdate(const QCborMap& update, QByteArray& frame);
+
+signals:
+    /**
+     * @brief updateReady is emitted when an update for a client is ready to be sent
+     * @param client the subscribed client
+     * @param data the encoded message
+     */
+    void updateReady(QWebSocket* client, const QByteArray& data);
+
+private slots:
+    /**
+     * @brief sendUpdates sends the changed node data to all subscribers (called every frame)
+     */
+    void sendUpdates();
+
+protected:
+    /**
+     * @brief The NodeSubscription struct contains the state of a node subscribed by a client.
+     */
+    struct NodeSubscription {
+        QPointer<NodeBase> node;
+        /**
+         * @brief lastFrame is the quantized frame last sent to the client
+         */
+        QByteArray lastFrame;
+        int lastWidth;
+        int lastHeight;
+    };
+
+    /**
+     * @brief The Subscriber struct contains all subscriptions of a single client.
+     */
+    struct Subscriber {
+        QHash<QString, NodeSubscription> nodes;
+        int bits;
+        double minInterval;
+        HighResTime::time_point_t lastUpdate;
+    };
+
+    /**
+     * @brief quantizeFrame converts the RGB data of a node to unsigned integers
+     * @param node the node
+     * @param bits 8 or 16
+     * @return the quantized samples in row-major order
+     */
+    static QByteArray quantizeFrame(const NodeBase* node, int bits);
+
+    /**
+     * @brief encodeDelta creates the changed spans between two frames of the same size
+     * @param previous the frame last sent
+     * @param current the new frame
+     * @param bytesPerSample 1 or 2
+     * @return the encoded spans, empty if nothing changed
+     */
+    static QByteArray encodeDelta(const QByteArray& previous, const QByteArray& current, int bytesPerSample);
+
+    /**
+     * @brief m_controller a pointer to the CoreController
+     */
+    CoreController* const m_controller;
+
+    /**
+     * @brief m_subscribers contains the subscriptions by client
+     */
+    QHash<QWebSocket*, Subscriber> m_subscribers;
+};
+
+#endif // NODEDATASTREAMER_H
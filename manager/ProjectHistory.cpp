@@ -0,0 +1,195 @@
+#include "ProjectHistory.h"
+
+#include "core/CoreController.h"
+#include "core/manager/BlockManager.h"
+#include "core/manager/ProjectManager.h"
+#include "core/block_basics/BlockInterface.h"
+#include "core/helpers/qstring_literal.h"
+
+#include <QCborArray>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QEvent>
+
+
+// create a shorter alias for the constants namespace:
+namespace PHC = ProjectHistoryConstants;
+
+ProjectHistory::ProjectHistory(CoreController* controller, QObject* parent)
+    : QObject(parent)
+    , m_controller(controller)
+    , m_currentIndex(-1)
+    , m_nextVersionId(0)
+{
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setInterval(PHC::commitDelayMs);
+    connect(&m_commitTimer, &QTimer::timeout, this, &ProjectHistory::commitCurrentState);
+    if (QCoreApplication::instance()) {
+        QCoreApplication::instance()->installEventFilter(this);
+    }
+}
+
+bool ProjectHistory::commit(const QHash<QString, QByteArray>& entries) {
+    PersistentStateMap base;
+    if (m_currentIndex >= 0) {
+        base = m_versions[m_currentIndex].blocks;
+    }
+    PersistentStateMap blocks = stateFromEntries(entries, base);
+    if (m_currentIndex >= 0 && blocks.isIdenticalTo(base)) {
+        // nothing changed since the current version
+        return false;
+    }
+
+    // a new edit discards the versions that could have been restored with redo:
+    m_versions.resize(m_currentIndex + 1);
+    m_versions.append(Version{m_nextVersionId++, blocks});
+    if (m_versions.size() > PHC::maxVersions) {
+        m_versions.removeFirst();
+    }
+    m_currentIndex = m_versions.size() - 1;
+    emit historyChanged();
+    return true;
+}
+
+QCborMap ProjectHistory::getDelta(int fromVersionId, int toVersionId) const {
+    const int fromIndex = indexOfVersion(fromVersionId);
+    const int toIndex = indexOfVersion(toVersionId);
+    if (fromIndex < 0 || toIndex < 0) return QCborMap();
+
+    const PersistentStateMap& from = m_versions[fromIndex].blocks;
+    const PersistentStateMap& to = m_versions[toIndex].blocks;
+    QStringList changedUids;
+    QStringList removedUids;
+    from.diff(to, changedUids, removedUids);
+
+    QCborMap changed;
+    for (const QString& uid: changedUids) {
+        changed[uid] = decodeEntry(to.value(uid));
+    }
+    QCborMap delta;
+    delta["changed"_q] = changed;
+    delta["removed"_q] = QCborArray::fromStringList(removedUids);
+    return delta;
+}
+
+PersistentStateMap ProjectHistory::getVersionState(int versionId) const {
+    const int index = indexOfVersion(versionId);
+    if (index < 0) return PersistentStateMap();
+    return m_versions[index].blocks;
+}
+
+QByteArray ProjectHistory::encodeEntry(const QByteArray& encodedBlockState, const QCborArray& connections) {
+    // a CBOR array with two elements, the block state is copied as it is:
+    QByteArray entry;
+    const QByteArray encodedConnections = QCborValue(connections).toCbor();
+    entry.reserve(1 + encodedBlockState.size() + encodedConnections.size());
+    entry.append(char(0x82));
+    entry.append(encodedBlockState);
+    entry.append(encodedConnections);
+    return entry;
+}
+
+QCborMap ProjectHistory::decodeEntry(const QByteArray& entry) {
+    const QCborArray parts = QCborValue::fromCbor(entry).toArray();
+    QCborMap blockState = parts.at(0).toMap();
+    blockState["connections"_q] = parts.at(1).toArray();
+    return blockState;
+}
+
+QHash<QString, QByteArray> ProjectHistory::currentEntries() const {
+    QHash<QString, QByteArray> entries;
+    BlockManager* blockManager = m_controller->blockManager();
+    for (BlockInterface* block: blockManager->getCurrentBlocks()) {
+        if (!block) continue;
+        entries.insert(block->getUid(), encodeEntry(blockManager->encodeBlockState(block), block->getConnections()));
+    }
+    return entries;
+}
+
+void ProjectHistory::clear() {
+    m_commitTimer.stop();
+    m_versions.clear();
+    m_currentIndex = -1;
+    emit historyChanged();
+}
+
+void ProjectHistory::commitCurrentState() {
+    if (m_controller->projectManager()->isLoading()) return;
+    commit(currentEntries());
+}
+
+void ProjectHistory::scheduleCommit() {
+    // restarted by each edit, a series of edits in short time becomes one version:
+    m_commitTimer.start();
+}
+
+bool ProjectHistory::eventFilter(QObject* watched, QEvent* event) {
+    switch (event->type()) {
+    case QEvent::MouseButtonRelease:
+    case QEvent::TouchEnd:
+    case QEvent::KeyRelease:
+        scheduleCommit();
+        break;
+    default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void ProjectHistory::undo() {
+    if (m_controller->projectManager()->isLoading()) return;
+    // make sure changes since the last commit can be restored with redo:
+    m_commitTimer.stop();
+    commitCurrentState();
+    if (!canUndo()) return;
+    restoreVersion(m_currentIndex - 1);
+}
+
+void ProjectHistory::redo() {
+    if (m_controller->projectManager()->isLoading()) return;
+    if (!canRedo()) return;
+    restoreVersion(m_currentIndex + 1);
+}
+
+int ProjectHistory::getCurrentVersionId() const {
+    if (m_currentIndex < 0) return -1;
+    return m_versions[m_currentIndex].id;
+}
+
+void ProjectHistory::restoreVersion(int index) {
+    if (index < 0 || index >= m_versions.size() || m_currentIndex < 0) return;
+
+    const PersistentStateMap& current = m_versions[m_currentIndex].blocks;
+    const PersistentStateMap& target = m_versions[index].blocks;
+    QStringList changedUids;
+    QStringList removedUids;
+    current.diff(target, changedUids, removedUids);
+
+    QCborMap changed;
+    for (const QString& uid: changedUids) {
+        changed[uid] = decodeEntry(target.value(uid));
+    }
+    m_controller->blockManager()->applyStateDelta(changed, removedUids);
+
+    // restored blocks can differ in details from the stored state (i.e. rounded positions),
+    // update the version to match them, otherwise the next commit would discard the redo history:
+    m_versions[index].blocks = stateFromEntries(currentEntries(), m_versions[index].blocks);
+    m_currentIndex = index;
+    emit historyChanged();
+}
+
+PersistentStateMap ProjectHistory::stateFromEntries(const QHash<QString, QByteArray>& entries, const PersistentStateMap& base) const {
+    QStringList removed;
+    for (const QString& uid: base.keys()) {
+        if (!entries.contains(uid)) removed.append(uid);
+    }
+    // unchanged entries keep sharing memory with the base version:
+    return base.updated(entries, removed);
+}
+
+int ProjectHistory::indexOfVersion(int versionId) const {
+    for (int i = 0; i < m_versions.size(); ++i) {
+        if (m_versions[i].id == versionId) return i;
+    }
+    return -1;
+}
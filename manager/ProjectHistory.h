@@ -0,0 +1,215 @@
+#ifndef PROJECTHISTORY_H
+#define PROJECTHISTORY_H
+
+#include "core/helpers/PersistentStateMap.h"
+
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QCborMap>
+#include <QCborArray>
+#include <QTimer>
+
+// forward declaration to prevent dependency loop
+class CoreController;
+
+/**
+ * @brief The ProjectHistoryConstants namespace contains all constants used in ProjectHistory.
+ */
+namespace ProjectHistoryConstants {
+    /**
+     * @brief maxVersions is the maximum number of project versions kept in memory
+     */
+    static const int maxVersions = 100;
+    /**
+     * @brief commitDelayMs is the time after an edit until a version is created,
+     * edits in this time (i.e. a drag and the following animation) become a single version
+     */
+    static const int commitDelayMs = 300;
+}
+
+/**
+ * @brief The ProjectHistory class stores versions of the current project to undo and redo
+ * arbitrary edits and to calculate the differences between two versions.
+ *
+ * The block states of each version are stored CBOR encoded in a PersistentStateMap keyed by block UID.
+ * Consecutive versions share all unchanged parts, so a new version only costs memory
+ * for the blocks that changed. Each entry contains the outgoing connections of the block,
+ * too, so connection changes are tracked per block. Entries are only decoded when a version
+ * is restored or a delta is requested.
+ *
+ * A version is created shortly after each edit. Edits are either reported by the BlockManager
+ * (a block was added, removed or moved to another group) or are user interactions,
+ * detected as released mouse buttons, touches and keys (moving and resizing blocks,
+ * connecting nodes and changing attributes in the GUI). Attributes that change by themselves
+ * (i.e. animations) don't create versions, they are included in the next version after an edit.
+ */
+class ProjectHistory : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(bool canUndo READ canUndo NOTIFY historyChanged)
+    Q_PROPERTY(bool canRedo READ canRedo NOTIFY historyChanged)
+    Q_PROPERTY(int versionCount READ getVersionCount NOTIFY historyChanged)
+
+public:
+    /**
+     * @brief ProjectHistory creates an empty history
+     * @param controller a pointer to the CoreController
+     * @param parent QObject parent
+     */
+    explicit ProjectHistory(CoreController* controller, QObject* parent = nullptr);
+
+    /**
+     * @brief commit adds a new version if the project state differs from the current version,
+     * versions that could have been restored with redo() are discarded in that case
+     * @param entries maps the UIDs of all blocks to their entries as returned by encodeEntry()
+     * @return true if a new version was created
+     */
+    bool commit(const QHash<QString, QByteArray>& entries);
+
+    /**
+     * @brief getDelta returns the changes needed to get from one version to another
+     * @param fromVersionId id of the base version
+     * @param toVersionId id of the target version
+     * @return a map with "changed" (block UID -> block state as returned by decodeEntry())
+     * and "removed" (array of UIDs)
+     * or an empty map if one of the versions doesn't exist anymore
+     */
+    QCborMap getDelta(int fromVersionId, int toVersionId) const;
+
+    /**
+     * @brief getVersionState returns the block states of a version
+     * @param versionId id of the version
+     * @return the block states (may share memory with other versions) or an empty map
+     */
+    PersistentStateMap getVersionState(int versionId) const;
+
+    /**
+     * @brief encodeEntry creates the entry stored in the history for a block
+     * @param encodedBlockState as returned by BlockManager::encodeBlockState()
+     * @param connections outgoing connections of this block
+     * @return the CBOR encoded history entry
+     */
+    static QByteArray encodeEntry(const QByteArray& encodedBlockState, const QCborArray& connections);
+
+    /**
+     * @brief decodeEntry decodes an entry created by encodeEntry()
+     * @param entry the CBOR encoded history entry
+     * @return the block state with an additional array "connections"
+     * (as expected by BlockManager::applyStateDelta())
+     */
+    static QCborMap decodeEntry(const QByteArray& entry);
+
+    /**
+     * @brief currentEntries returns the entries of all currently existing blocks
+     * @return map of block UID -> entry
+     */
+    QHash<QString, QByteArray> currentEntries() const;
+
+signals:
+    void historyChanged();
+
+public slots:
+
+    /**
+     * @brief clear removes all versions (i.e. when a different project is loaded)
+     */
+    void clear();
+
+    /**
+     * @brief commitCurrentState adds a version with the current project state if it changed
+     */
+    void commitCurrentState();
+
+    /**
+     * @brief scheduleCommit creates a version commitDelayMs after the last call,
+     * called after each edit
+     */
+    void scheduleCommit();
+
+    /**
+     * @brief undo restores the previous version of the project
+     */
+    void undo();
+
+    /**
+     * @brief redo restores the next version of the project after undo() has been used
+     */
+    void redo();
+
+    bool canUndo() const { return m_currentIndex > 0; }
+    bool canRedo() const { return m_currentIndex >= 0 && m_currentIndex < m_versions.size() - 1; }
+
+    int getVersionCount() const { return m_versions.size(); }
+
+    /**
+     * @brief getCurrentVersionId returns the id of the current version
+     * @return id of the version or -1 if there is none
+     */
+    int getCurrentVersionId() const;
+
+protected:
+    /**
+     * @brief eventFilter schedules a commit when a user interaction ended
+     * (installed on the application)
+     */
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+    /**
+     * @brief The Version struct contains a single project version.
+     */
+    struct Version {
+        int id;
+        PersistentStateMap blocks;
+    };
+
+    /**
+     * @brief restoreVersion applies the difference between the current and another version
+     * to the blocks of the current project
+     * @param index index of the version to restore in m_versions
+     */
+    void restoreVersion(int index);
+
+    /**
+     * @brief stateFromEntries converts the entries of all blocks to the block states of a version
+     * @param entries maps the UIDs of all blocks to their entries
+     * @param base the version to share unchanged entries with
+     * @return the block states
+     */
+    PersistentStateMap stateFromEntries(const QHash<QString, QByteArray>& entries, const PersistentStateMap& base) const;
+
+    /**
+     * @brief indexOfVersion returns the index in m_versions of the version with the given id
+     * @param versionId id of the version
+     * @return index or -1 if it doesn't exist (anymore)
+     */
+    int indexOfVersion(int versionId) const;
+
+    /**
+     * @brief m_controller a pointer to the CoreController
+     */
+    CoreController* const m_controller;
+
+    /**
+     * @brief m_versions all stored versions, the oldest first
+     */
+    QVector<Version> m_versions;
+
+    /**
+     * @brief m_currentIndex index of the version that matches the current project state
+     */
+    int m_currentIndex;
+
+    /**
+     * @brief m_nextVersionId the id of the next version
+     */
+    int m_nextVersionId;
+
+    /**
+     * @brief m_commitTimer delays the commit after an edit (see scheduleCommit())
+     */
+    QTimer m_commitTimer;
+};
+
+#endif // PROJECTHISTORY_H
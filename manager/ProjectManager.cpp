@@ -7,8 +7,13 @@
 #include "core/manager/GuiManager.h"
 #include "core/connections/Nodes.h"
 #include "core/helpers/qstring_literal.h"
+#include "core/helpers/cbor_stream_utils.h"
 
+#include <QCborStreamWriter>
+#include <QIODevice>
 #include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QQuickWindow>
 
 
@@ -22,6 +27,7 @@ ProjectManager::ProjectManager(CoreController* controller)
 	, m_controller(controller)
 	, m_currentProjectName("")
 	, m_loadingIsInProgress(false)
+    , m_history(new ProjectHistory(controller, this))
 {
 
 }
@@ -156,6 +162,73 @@ QCborMap ProjectManager::getCurrentProjectState() const {
     return projectState;
 }
 
+QByteArray ProjectManager::encodeCurrentProjectState(QHash<QString, QByteArray>* historyEntries) const {
+    // saving the state is only allowed if previous loading is completed:
+    if (m_loadingIsInProgress) {
+        qWarning() << "Can't save project while it is loaded.";
+        return QByteArray();
+    }
+
+    // same content as getCurrentProjectState(), but the block states are written directly
+    // to the output (indefinite length containers are used to be able to append
+    // already encoded block states):
+    QByteArray data;
+    QCborStreamWriter writer(&data);
+    writer.startMap();
+    writer.append("version"_q);
+    writer.append(ProjectManagerConstants::formatVersion);
+    writer.append("fileName"_q);
+    writer.append(m_currentProjectName);
+
+    // save anything else project related:
+    QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
+    if (workspace) {
+        const double dp = m_controller->guiManager()->getGuiScaling();
+        writer.append("planeX"_q);
+        writer.append(workspace->x() / dp);
+        writer.append("planeY"_q);
+        writer.append(workspace->y() / dp);
+    }
+    BlockManager* blockManager = m_controller->blockManager();
+    writer.append("displayedGroup"_q);
+    writer.append(blockManager->getDisplayedGroup());
+    writer.append("anchors"_q);
+    m_controller->anchorManager()->getState().toCborValue().toCbor(writer);
+    writer.append("backgroundName"_q);
+    writer.append(m_controller->guiManager()->getBackgroundName());
+    BlockInterface* focusedBlock = blockManager->getFocusedBlock();
+    writer.append("focusedBlock"_q);
+    writer.append(focusedBlock ? focusedBlock->getUid() : QString());
+    // the number of blocks is stored separately because the blocks array has no fixed length:
+    writer.append("blockCount"_q);
+    writer.append(qint64(blockManager->getCurrentBlocks().size()));
+
+    // save block states and collect connections between blocks:
+    QCborArray connections;
+    writer.append("blocks"_q);
+    writer.startArray();
+    for (BlockInterface* block: blockManager->getCurrentBlocks()) {
+        if (!block) continue;
+        const QCborArray blockConnections = block->getConnections();
+        for (QCborValueRef connectionRef: blockConnections) {
+            connections.append(connectionRef.toString());
+        }
+        if (historyEntries) {
+            const QByteArray blockState = blockManager->encodeBlockState(block);
+            writer.device()->write(blockState);
+            historyEntries->insert(block->getUid(), ProjectHistory::encodeEntry(blockState, blockConnections));
+        } else {
+            blockManager->writeBlockState(block, writer);
+        }
+    }
+    writer.endArray();
+
+    writer.append("connections"_q);
+    connections.toCborValue().toCbor(writer);
+    writer.endMap();
+    return data;
+}
+
 void ProjectManager::reloadCurrentProject() {
     loadProjectState(m_currentProjectName, /*animated*/ false);
 }
@@ -171,6 +244,10 @@ QStringList ProjectManager::getProjectList() const {
     return projectNames;
 }
 
+QVariantMap ProjectManager::getProjectHeader(QString name) const {
+    return m_controller->dao()->loadCborMapHeaderCached(PMC::subdirectory, name + PMC::fileEnding).toVariantMap();
+}
+
 void ProjectManager::importProjectFile(QString filename, bool load, bool overwrite) {
     // import file to config directory:
 #ifdef Q_OS_WIN
@@ -268,6 +345,7 @@ void ProjectManager::saveCombination(QString title) {
     m_controller->dao()->saveFile(PMC::combinationsSubdirectory,
                                   title + PMC::combinationFileEnding,
                                   blockCombination);
+    m_combinationTemplates.remove(title);
     emit combinationsChanged();
 }
 
@@ -275,50 +353,33 @@ void ProjectManager::removeCombination(QString title) {
     if (title.isEmpty()) return;
     m_controller->dao()->deleteFile(PMC::combinationsSubdirectory,
                                     title + PMC::combinationFileEnding);
+    m_combinationTemplates.remove(title);
     emit combinationsChanged();
 }
 
 void ProjectManager::addCombination(QString title) {
     if (title.isEmpty()) return;
-    QCborMap blockCombination = m_controller->dao()->loadCborMap(PMC::combinationsSubdirectory,
-                                                                   title + PMC::combinationFileEnding);
-    if (blockCombination.empty()) {
+    QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
+    if (!workspace) return;
+    QSharedPointer<const CombinationTemplate> combination = getCombinationTemplate(title);
+    if (!combination) {
         qWarning() << "Combination file does not exist or is empty.";
         return;
     }
 
-    QString currentGroup = m_controller->blockManager()->getDisplayedGroup();
-    QQuickItem* workspace = m_controller->guiManager()->getWorkspaceItem();
+    PendingCombination pending;
+    pending.combination = combination;
+    pending.group = m_controller->blockManager()->getDisplayedGroup();
     const double dp = m_controller->guiManager()->getGuiScaling();
-    double centerX = (-workspace->x() + workspace->width() / 2) / dp;
-    double centerY = (-workspace->y() + workspace->height() / 2) / dp;
-
-    QMap<QString, QString> newUids;
-
-    BlockManager* blockManager = m_controller->blockManager();
-    for (QCborValueRef ref: blockCombination["blocks"_q].toArray()) {
-        QCborMap blockState = ref.toMap();
-        blockState["posX"_q] = blockState["posX"_q].toDouble() + centerX;
-        blockState["posY"_q] = blockState["posY"_q].toDouble() + centerY;
-        QString oldUid = blockState["uid"_q].toString();
-        blockState["uid"_q] = "";
-        BlockInterface* block = blockManager->restoreBlock(blockState, /*animated*/ true, /*connectOnAdd*/ false);
-        blockManager->setGroupOfBlock(block, currentGroup);
-        newUids.insert(oldUid, block->getUid());
-    }
-
-    for (QCborValueRef connectionRef: blockCombination["connections"_q].toArray()) {
-        QString connection = connectionRef.toString();
-        QStringList outputUid = connection.split("->").at(0).split("|");
-        QStringList inputUid = connection.split("->").at(1).split("|");
-        NodeBase* outputNode = blockManager->getNodeByUid(newUids[outputUid.at(0)] + "|" + outputUid.at(1));
-        NodeBase* inputNode = blockManager->getNodeByUid(newUids[inputUid.at(0)] + "|" + inputUid.at(1));
-        if (outputNode && inputNode) {
-            outputNode->connectTo(inputNode);
-        }
+    pending.centerX = (-workspace->x() + workspace->width() / 2) / dp;
+    pending.centerY = (-workspace->y() + workspace->height() / 2) / dp;
+    pending.blocks.reserve(combination->blockStates.size());
+    m_pendingCombinations.append(pending);
+
+    // the blocks are created in multiple chunks to not block the GUI:
+    if (m_pendingCombinations.size() == 1) {
+        createChunkOfCombinationBlocks();
     }
-
-    m_controller->blockManager()->updateBlockVisibility(workspace);
 }
 
 QStringList ProjectManager::getCombinations() const {
@@ -337,16 +398,90 @@ QStringList ProjectManager::getCombinations() const {
 void ProjectManager::loadProjectState(QString name, bool animated) {
     if (name.isEmpty()) return;
     // try to load project file:
-    QCborMap projectState = m_controller->dao()->loadCborMap(PMC::subdirectory, name + PMC::fileEnding);
-	if (projectState.empty()) {
+    // the file is mapped to memory and the blocks are later created directly from it:
+    QSharedPointer<const MappedFile> projectFile = m_controller->dao()->mapFile(PMC::subdirectory, name + PMC::fileEnding);
+    QByteArray projectData = projectFile->bytes();
+    if (!QCborStreamReader(projectData).isMap()) {
+        // backward compatibility / migration path: check if file is in JSON format:
+        QJsonDocument loadDoc(QJsonDocument::fromJson(projectData));
+        projectData = QCborMap::fromJsonObject(loadDoc.object()).toCborValue().toCbor();
+        projectFile.reset();
+    }
+
+    // read everything except the blocks, remember the position of the blocks array
+    // to create them later directly from the file content:
+    QCborMap projectState;
+    qint64 blocksOffset = -1;
+    qint64 blockCount = -1;
+    QCborStreamReader reader(projectData);
+    if (reader.isMap()) {
+        reader.enterContainer();
+        while (reader.lastError() == QCborError::NoError && reader.hasNext()) {
+            if (!reader.isString()) {
+                // skip key and value:
+                reader.next();
+                reader.next();
+                continue;
+            }
+            const QString key = readCborString(reader);
+            if (key == "blocks" && reader.isArray()) {
+                blocksOffset = reader.currentOffset();
+                if (reader.isLengthKnown()) {
+                    blockCount = qint64(reader.length());
+                }
+                reader.next();
+            } else {
+                projectState[key] = QCborValue::fromCbor(reader);
+            }
+        }
+    }
+    if (reader.lastError() != QCborError::NoError) {
+        qWarning() << "Project file is corrupted: " << reader.lastError().toString();
+    }
+	if (projectState.empty() && blocksOffset < 0) {
 		qWarning() << "Project file does not exist or is empty.";
 		return;
 	}
 
     // project file exists -> start loading:
+    prepareProjectLoading(projectState);
+
+    // restoring the blocks often takes longer than one frame
+    // to revent frames being skipped, the blocks are created in multiple chuncks
+
+    // keep the file content and a reader positioned at the blocks array:
+    m_projectFile = projectFile;
+    m_projectData = projectData;
+    m_blockReader.reset();
+    if (blocksOffset >= 0) {
+        m_blockReader.reset(new QCborStreamReader(m_projectData.constData() + blocksOffset,
+                                                  m_projectData.size() - blocksOffset));
+        m_blockReader->enterContainer();
+    }
+    // copy connections to be made after blocks have been created to memeber variable:
+    m_connectionsToBeMade = projectState["connections"_q].toArray();
+    m_blockToBeFocused = projectState["focusedBlock"_q].toString();
+
+    if (projectState.contains("blockCount"_q)) {
+        blockCount = projectState["blockCount"_q].toInteger();
+    }
+    if (blockCount > PMC::maxAnimatedBlocks) {
+        animated = false;
+    }
+#if defined(Q_OS_IOS) || defined(Q_OS_ANDROID)
+    animated = false;
+#endif
+
+    // create first chunk of blocks in the next frame (in 40ms)
+    QTimer::singleShot(40, [this, animated]() { this->createChunckOfBlocks(animated); } );
+}
+
+void ProjectManager::prepareProjectLoading(const QCborMap& projectState) {
     m_loadingIsInProgress = true;
+    m_history->clear();
 
     // reset workspace:
+    m_pendingCombinations.clear();
     m_controller->blockManager()->deleteAllBlocks(/*immediate*/ true);  // TODO: reuse blocks with same UID
 
 	// restore project related settings:
@@ -358,46 +493,81 @@ void ProjectManager::loadProjectState(QString name, bool animated) {
     m_controller->guiManager()->setBackgroundName(projectState["backgroundName"_q].toString());
     // FIXME: create signal and move this to MidiManager!
     // m_controller->midiMapping()->setState(projectState["midiMapping"].toMap());
+}
 
-    // restoring the blocks often takes longer than one frame
-    // to revent frames being skipped, the blocks are created in multiple chuncks
+bool ProjectManager::beginStreamedProject(QString name, const QCborMap& projectState) {
+    if (name.isEmpty() || m_loadingIsInProgress) return false;
+    if (m_controller->blockManager()->randomConnectionTestIsRunning()) return false;
+    // save current before load new one:
+    if (!m_currentProjectName.isEmpty()) saveStateAsProject(m_currentProjectName);
+
+    m_projectBeforeStream = m_currentProjectName;
+    m_currentProjectName = name;
+    // the blocks are not read from a file:
+    m_blockReader.reset();
+    m_projectData.clear();
+    m_projectFile.reset();
+    prepareProjectLoading(projectState);
+    m_blockToBeFocused = projectState["focusedBlock"_q].toString();
+    emit projectChanged();
+    return true;
+}
 
-    // copy block states to temporary member variable:
-    m_blocksToBeCreated.clear();
-    for (QCborValueRef blockStateRef: projectState["blocks"_q].toArray()) {
-        m_blocksToBeCreated.append(blockStateRef.toMap());
-    }
-    // copy connections to be made after blocks have been created to memeber variable:
-    m_connectionsToBeMade = projectState["connections"_q].toArray();
+void ProjectManager::finishStreamedProject(const QCborArray& connections) {
+    m_projectBeforeStream.clear();
+    m_connectionsToBeMade = connections;
+    completeProjectLoading();
+}
 
-    if (m_blocksToBeCreated.size() > 50) {
-        animated = false;
+void ProjectManager::abortStreamedProject(QString projectToLoad) {
+    // the previous project has been saved in beginStreamedProject():
+    const QString projectName = projectToLoad.isEmpty() ? m_projectBeforeStream : projectToLoad;
+    m_projectBeforeStream.clear();
+    m_connectionsToBeMade = QCborArray();
+    m_blockToBeFocused.clear();
+    m_loadingIsInProgress = false;
+    if (!projectName.isEmpty()
+            && m_controller->dao()->fileExists(PMC::subdirectory, projectName + PMC::fileEnding)) {
+        m_currentProjectName = projectName;
+        loadProjectState(projectName, /*animated*/ false);
+    } else {
+        m_controller->blockManager()->deleteAllBlocks(/*immediate*/ true);
+        m_history->clear();
+        m_currentProjectName.clear();
     }
-#if defined(Q_OS_IOS) || defined(Q_OS_ANDROID)
-    animated = false;
-#endif
-
-    // create first chunk of blocks in the next frame (in 40ms)
-    QTimer::singleShot(40, [this, animated]() { this->createChunckOfBlocks(animated); } );
+    emit projectChanged();
 }
 
 void ProjectManager::createChunckOfBlocks(bool animated) {
     // this is called with QTimer by loadProjectState() or previous createChunckOfBlocks() call
-    // try to create as many blocks as possible in the next 12 ms:
+    // try to create as many blocks as possible in the next PMC::blockChunkDurationMs:
 
     HighResTime::time_point_t start = HighResTime::now();
     BlockManager* blockManager = m_controller->blockManager();
-    while (!m_blocksToBeCreated.isEmpty()) {
-        QCborMap blockState = m_blocksToBeCreated.takeLast();
-        blockManager->restoreBlock(blockState, animated);
-
-        if (HighResTime::elapsedSecSince(start) * 1000 > 12) {
-            // 12ms are over, continue work in next frame:
+    auto blocksRemaining = [this]() {
+        return m_blockReader
+                && m_blockReader->lastError() == QCborError::NoError
+                && m_blockReader->hasNext();
+    };
+    // the blocks are restored in the order they are stored in the file (previously in reverse order),
+    // that way the stacking order of overlapping blocks stays the same when a project is saved and loaded:
+    while (blocksRemaining()) {
+        blockManager->restoreBlock(*m_blockReader, animated);
+
+        if (HighResTime::elapsedSecSince(start) * 1000 > PMC::blockChunkDurationMs) {
+            // blockChunkDurationMs is over, continue work in next frame:
             break;
         }
     }
 
-    if (m_blocksToBeCreated.isEmpty()) {
+    if (!blocksRemaining()) {
+        if (m_blockReader && m_blockReader->lastError() != QCborError::NoError) {
+            qWarning() << "Could not read all blocks: " << m_blockReader->lastError().toString();
+        }
+        // the file content is not needed anymore:
+        m_blockReader.reset();
+        m_projectData.clear();
+        m_projectFile.reset();
         // all blocks have been created -> continue with connections:
         QTimer::singleShot(8, this, SLOT(completeProjectLoading()));
     } else {
@@ -422,6 +592,12 @@ void ProjectManager::completeProjectLoading() {
         }
     }
 
+    // focus the block that was focused when the project was saved:
+    BlockInterface* focusedBlock = blockManager->getBlockByUid(m_blockToBeFocused);
+    if (focusedBlock) {
+        blockManager->focusBlock(focusedBlock);
+    }
+
     emit projectLoadingFinished();
 
     // prevent snapshots being saved before the project is completely loaded
@@ -435,10 +611,65 @@ void ProjectManager::completeProjectLoading() {
     emit m_controller->blockManager()->displayedGroupChanged();
 }
 
+void ProjectManager::createChunkOfCombinationBlocks() {
+    // this is called by addCombination() or the previous createChunkOfCombinationBlocks() call
+    if (m_pendingCombinations.isEmpty()) return;
+    PendingCombination& pending = m_pendingCombinations.first();
+    const CombinationTemplate& combination = *pending.combination;
+    const bool animated = combination.blockStates.size() <= PMC::maxAnimatedBlocks;
+
+    HighResTime::time_point_t start = HighResTime::now();
+    BlockManager* blockManager = m_controller->blockManager();
+    while (pending.blocks.size() < combination.blockStates.size()) {
+        QCborMap blockState = combination.blockStates[pending.blocks.size()];
+        blockState["posX"_q] = blockState["posX"_q].toDouble() + pending.centerX;
+        blockState["posY"_q] = blockState["posY"_q].toDouble() + pending.centerY;
+        // set the group before the block is created, restoreBlock() then only creates
+        // a GUI item if the block is visible:
+        QCborMap internalState = blockState["internalState"_q].toMap();
+        internalState["group"_q] = pending.group;
+        blockState["internalState"_q] = internalState;
+        pending.blocks.append(blockManager->restoreBlock(blockState, animated, /*connectOnAdd*/ false));
+
+        if (HighResTime::elapsedSecSince(start) * 1000 > PMC::blockChunkDurationMs) {
+            // blockChunkDurationMs is over, continue work in next frame:
+            break;
+        }
+    }
+
+    if (pending.blocks.size() < combination.blockStates.size()) {
+        // there are still blocks to be created:
+        QTimer::singleShot(8, this, SLOT(createChunkOfCombinationBlocks()));
+        return;
+    }
+
+    // all blocks have been created -> make connections:
+    for (const CombinationTemplate::Connection& connection: combination.connections) {
+        BlockInterface* outputBlock = pending.blocks[connection.outputBlock];
+        BlockInterface* inputBlock = pending.blocks[connection.inputBlock];
+        if (!outputBlock || !inputBlock) continue;
+        NodeBase* outputNode = outputBlock->getNodeById(connection.outputNode);
+        NodeBase* inputNode = inputBlock->getNodeById(connection.inputNode);
+        if (outputNode && inputNode) {
+            outputNode->connectTo(inputNode);
+        }
+    }
+    m_pendingCombinations.removeFirst();
+
+    m_controller->blockManager()->updateBlockVisibility(m_controller->guiManager()->getWorkspaceItem());
+    if (!m_pendingCombinations.isEmpty()) {
+        QTimer::singleShot(8, this, SLOT(createChunkOfCombinationBlocks()));
+    }
+}
+
 void ProjectManager::releaseLoadingStateAfter(int ms) {
 	m_loadingIsInProgress = true;
 	// change value back to false after ms milliseconds:
-    QTimer::singleShot(ms, [this]() { this->m_loadingIsInProgress = false; } );
+    QTimer::singleShot(ms, [this]() {
+        this->m_loadingIsInProgress = false;
+        // the loaded state is the first version, edits can be undone until here:
+        m_history->commitCurrentState();
+    });
 }
 
 void ProjectManager::saveStateAsProject(QString name) const {
@@ -446,10 +677,64 @@ void ProjectManager::saveStateAsProject(QString name) const {
 	// saving the state is only allowed if previous loading is completed:
 	if (m_loadingIsInProgress) return;
 
-    QCborMap projectState = getCurrentProjectState();
+    // versions of the history are created by edits, not when saving:
+    QByteArray projectData = encodeCurrentProjectState();
 
 	// write file to file system:
-	m_controller->dao()->saveFile(PMC::subdirectory, name + PMC::fileEnding, projectState);
+	m_controller->dao()->saveFile(PMC::subdirectory, name + PMC::fileEnding, projectData);
+}
+
+QSharedPointer<const ProjectManager::CombinationTemplate> ProjectManager::getCombinationTemplate(const QString& title) {
+    const QString filename = title + PMC::combinationFileEnding;
+    const QFileInfo fileInfo(m_controller->dao()->getDir(PMC::combinationsSubdirectory, filename));
+    if (!fileInfo.exists()) return nullptr;
+    const qint64 lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+    QSharedPointer<const CombinationTemplate> cached = m_combinationTemplates.value(title);
+    if (cached && cached->lastModified == lastModified && cached->size == fileInfo.size()) {
+        return cached;
+    }
+
+    // the template is cached, so the decoded file doesn't have to be:
+    const QCborMap blockCombination = m_controller->dao()->loadCborMap(PMC::combinationsSubdirectory, filename);
+    if (blockCombination.isEmpty()) return nullptr;
+
+    QSharedPointer<CombinationTemplate> combination(new CombinationTemplate());
+    combination->lastModified = lastModified;
+    combination->size = fileInfo.size();
+
+    QHash<QString, int> indexByUid;
+    const QCborArray blocks = blockCombination["blocks"_q].toArray();
+    combination->blockStates.reserve(blocks.size());
+    for (const QCborValue& blockStateValue: blocks) {
+        QCborMap blockState = blockStateValue.toMap();
+        indexByUid.insert(blockState["uid"_q].toString(), combination->blockStates.size());
+        // an empty UID creates a new one each time the template is used:
+        blockState["uid"_q] = "";
+        combination->blockStates.append(blockState);
+    }
+
+    // parse the connections ("outputBlockUid|nodeId->inputBlockUid|nodeId") only once:
+    auto parseNodeUid = [&indexByUid](const QStringRef& nodeUid, int& blockIndex, int& nodeId) {
+        const int separator = nodeUid.indexOf('|');
+        if (separator < 0) return false;
+        blockIndex = indexByUid.value(nodeUid.left(separator).toString(), -1);
+        bool ok = false;
+        nodeId = nodeUid.mid(separator + 1).toInt(&ok);
+        return blockIndex >= 0 && ok;
+    };
+    for (const QCborValue& connectionValue: blockCombination["connections"_q].toArray()) {
+        const QString connectionString = connectionValue.toString();
+        const int arrow = connectionString.indexOf("->");
+        if (arrow < 0) continue;
+        CombinationTemplate::Connection connection;
+        if (parseNodeUid(connectionString.leftRef(arrow), connection.outputBlock, connection.outputNode)
+                && parseNodeUid(connectionString.midRef(arrow + 2), connection.inputBlock, connection.inputNode)) {
+            combination->connections.append(connection);
+        }
+    }
+
+    m_combinationTemplates.insert(title, combination);
+    return combination;
 }
 
 QString ProjectManager::correctCaseIfPossible(QString name) const {
@@ -1,14 +1,24 @@
 #ifndef PROJECTMANAGER_H
 #define PROJECTMANAGER_H
 
+#include "core/manager/ProjectHistory.h"
+#include "core/helpers/MappedFile.h"
+
 #include <QObject>
 #include <QVector>
+#include <QHash>
 #include <QCborMap>
 #include <QCborArray>
+#include <QCborStreamReader>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QSharedPointer>
 #include <QTimer>
+#include <QVariantMap>
 
 // forward declaration to prevent dependency loop
 class CoreController;
+class BlockInterface;
 
 /**
  * @brief The ProjectManagerConstants namespace contains all constants used in ProjectManager.
@@ -38,6 +48,15 @@ namespace ProjectManagerConstants {
 	 * @brief defaultProjectName is the name of the default project (i.e. that is created on first start)
 	 */
 	static const QString defaultProjectName = "default";
+    /**
+     * @brief maxAnimatedBlocks is the maximum number of blocks for which the creation is animated
+     * when a project or a combination is loaded
+     */
+    static const int maxAnimatedBlocks = 50;
+    /**
+     * @brief blockChunkDurationMs is the time in ms that can be spent creating blocks per frame
+     */
+    static const int blockChunkDurationMs = 12;
 }
 
 /**
@@ -50,6 +69,7 @@ class ProjectManager : public QObject
 	Q_PROPERTY(QStringList projectList READ getProjectList NOTIFY projectListChanged)
     Q_PROPERTY(QString currentProjectName READ getCurrentProjectName NOTIFY projectChanged)
     Q_PROPERTY(QStringList combinations READ getCombinations NOTIFY combinationsChanged)
+    Q_PROPERTY(ProjectHistory* history READ history CONSTANT)
 
 public:
 	/**
@@ -124,6 +144,15 @@ public slots:
      */
     QCborMap getCurrentProjectState() const;
 
+    /**
+     * @brief encodeCurrentProjectState returns the current project state CBOR encoded,
+     * the blocks are streamed directly without creating a QCborMap for each of them
+     * @param historyEntries if not null, the entries for the ProjectHistory are stored here
+     * (created from the same encoded block states)
+     * @return the encoded project state or an empty array while loading
+     */
+    QByteArray encodeCurrentProjectState(QHash<QString, QByteArray>* historyEntries = nullptr) const;
+
     /**
      * @brief reloadCurrentProject reloads the current project from file without saving it before that
      */
@@ -142,6 +171,15 @@ public slots:
 	 */
 	QStringList getProjectList() const;
 
+    /**
+     * @brief getProjectHeader returns the settings of a project without its blocks and connections
+     * (i.e. "blockCount", "backgroundName" and "displayedGroup") without loading the whole project,
+     * the result is cached until the file changes (i.e. for the project list in the GUI)
+     * @param name of the project (filename without fileending)
+     * @return the project settings or an empty map if the project doesn't exist
+     */
+    QVariantMap getProjectHeader(QString name) const;
+
     /**
      * @brief importProjectFile imports a JSON project file from the filesystem to the app data dir
      * @param filename path to the file
@@ -174,6 +212,39 @@ public slots:
      */
     bool isLoading() const { return m_loadingIsInProgress; }
 
+    /**
+     * @brief beginStreamedProject saves the current project and starts loading a project whose blocks
+     * are restored by the caller while they arrive (i.e. from HandoffManager)
+     * @param name of the new project
+     * @param projectState the project settings without blocks and connections
+     * @return false if another project is currently loaded
+     */
+    bool beginStreamedProject(QString name, const QCborMap& projectState);
+
+    /**
+     * @brief finishStreamedProject restores the connections after all blocks of a project
+     * started with beginStreamedProject() have been restored
+     * @param connections the connections of the project
+     */
+    void finishStreamedProject(const QCborArray& connections);
+
+    /**
+     * @brief abortStreamedProject discards the blocks of a project started with beginStreamedProject()
+     * that could not be received or restored completely and loads the previous project again
+     *
+     * The project is in the loading state until it is finished or aborted,
+     * so the incomplete project is never saved.
+     * @param projectToLoad project to load instead of the previous one (i.e. the received project
+     * if its file is complete), empty to load the previous one
+     */
+    void abortStreamedProject(QString projectToLoad = QString());
+
+    /**
+     * @brief history returns the undo history of the current project
+     * @return a pointer to the ProjectHistory
+     */
+    ProjectHistory* history() const { return m_history; }
+
     // -----------------------------------------------------------------
 
     void saveCombination(QString title);
@@ -194,8 +265,8 @@ private slots:
 	void loadProjectState(QString name, bool animated = true);
 
     /**
-     * @brief createChunckOfBlocks creates as much blocks from m_blocksToBeCreated as possible
-     * in 12ms, the remaining blocks are created in the next chunk
+     * @brief createChunckOfBlocks creates as much blocks from m_blockReader as possible
+     * in blockChunkDurationMs, the remaining blocks are created in the next chunk
      * @param animated true if the creation should be animated
      */
     void createChunckOfBlocks(bool animated);
@@ -205,6 +276,12 @@ private slots:
      */
     void completeProjectLoading();
 
+    /**
+     * @brief createChunkOfCombinationBlocks creates as much blocks of the first pending
+     * combination as possible in blockChunkDurationMs and creates the connections when all blocks exist
+     */
+    void createChunkOfCombinationBlocks();
+
 	/**
 	 * @brief setLoadingStateFor activates the "loading state" for a given number of milliseconds
 	 *  - the "loading state" prevents other projects from being saved or loaded
@@ -213,6 +290,13 @@ private slots:
     void releaseLoadingStateAfter(int ms);
 
 private:
+    /**
+     * @brief prepareProjectLoading deletes all blocks and restores the project settings
+     * before the blocks of a project are restored
+     * @param projectState the project settings without blocks and connections
+     */
+    void prepareProjectLoading(const QCborMap& projectState);
+
 	/**
 	 * @brief saveStateAsProject saves the current state in a project file
 	 * (internal, use saveCurrentProject() instead)
@@ -229,6 +313,58 @@ private:
 	 */
     QString correctCaseIfPossible(QString name) const;
 
+    /**
+     * @brief The CombinationTemplate struct is a block combination prepared to be added
+     * many times without reading and parsing the file again.
+     */
+    struct CombinationTemplate {
+        /**
+         * @brief The Connection struct describes a connection by the indexes of the blocks
+         * in blockStates and the node IDs.
+         */
+        struct Connection {
+            int outputBlock;
+            int outputNode;
+            int inputBlock;
+            int inputNode;
+        };
+
+        /**
+         * @brief blockStates the block states with positions relative to the center and empty UIDs
+         */
+        QVector<QCborMap> blockStates;
+        QVector<Connection> connections;
+
+        /**
+         * @brief lastModified and size of the file the template was created from
+         */
+        qint64 lastModified;
+        qint64 size;
+    };
+
+    /**
+     * @brief The PendingCombination struct contains the state of a combination that
+     * is currently being added in multiple chunks.
+     */
+    struct PendingCombination {
+        QSharedPointer<const CombinationTemplate> combination;
+        QString group;
+        double centerX;
+        double centerY;
+        /**
+         * @brief blocks the created blocks in the same order as in the template (nullptr if creation failed)
+         */
+        QVector<QPointer<BlockInterface>> blocks;
+    };
+
+    /**
+     * @brief getCombinationTemplate returns the template of a combination,
+     * it is created from the file if it doesn't exist yet or the file changed
+     * @param title of the combination
+     * @return the template or nullptr if the file doesn't exist or is empty
+     */
+    QSharedPointer<const CombinationTemplate> getCombinationTemplate(const QString& title);
+
 
 protected:
 	/**
@@ -245,19 +381,57 @@ protected:
 	 *  - the "loading state" prevents other projects from being saved or loaded
 	 */
 	bool m_loadingIsInProgress;
+    /**
+     * @brief m_projectBeforeStream the name of the project that was open before beginStreamedProject()
+     */
+    QString m_projectBeforeStream;
 
     /**
-     * @brief m_blocksToBeCreated a list of blocks to be created to restore a project,
+     * @brief m_history stores the versions of the current project for undo and redo,
+     * a version is added each time the project is saved
+     */
+    ProjectHistory* const m_history;
+
+    /**
+     * @brief m_projectFile the mapped project file that is currently loaded,
      * only used while loading a project to create the blocks in multiple chunks
      */
-    QVector<QCborMap> m_blocksToBeCreated;
+    QSharedPointer<const MappedFile> m_projectFile;
 
     /**
-     * @brief m_connectionsToBeMade list of connections to be made as soon as all blocks in
-     * m_blocksToBeCreated have been created
+     * @brief m_projectData the encoded content of the project file that is currently loaded,
+     * usually it points directly to the memory of m_projectFile
+     */
+    QByteArray m_projectData;
+
+    /**
+     * @brief m_blockReader reads the block states from m_projectData,
+     * it is positioned inside the "blocks" array at the next block to be created
+     */
+    QScopedPointer<QCborStreamReader> m_blockReader;
+
+    /**
+     * @brief m_connectionsToBeMade list of connections to be made as soon as all blocks
+     * have been created
      */
     QCborArray m_connectionsToBeMade;
 
+    /**
+     * @brief m_blockToBeFocused UID of the block to focus after all blocks have been created
+     */
+    QString m_blockToBeFocused;
+
+    /**
+     * @brief m_combinationTemplates contains the templates of all combinations used so far by title
+     */
+    QHash<QString, QSharedPointer<const CombinationTemplate>> m_combinationTemplates;
+
+    /**
+     * @brief m_pendingCombinations combinations that are currently being added, the first one
+     * is created by createChunkOfCombinationBlocks()
+     */
+    QVector<PendingCombination> m_pendingCombinations;
+
 };
 
 #endif // PROJECTMANAGER_H
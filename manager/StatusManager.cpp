@@ -14,6 +14,8 @@ Status::Status(StatusManager* statusManager, const QString& uid)
     , m_running(this, "running", false)
     , m_hidden(this, "hidden", false)
 {
+    // progress is updated by long running tasks as often as they like:
+    m_progress.setNotificationMode(SmartAttribute::NotificationMode::Coalesced);
 }
 
 QObject* Status::attr(QString name) {
@@ -30,8 +30,8 @@ public:
     StringAttribute m_title;
     StringAttribute m_text;
     DoubleAttribute m_progress;
-    BoolAttribute m_running;
-    BoolAttribute m_hidden;
+    CompactBoolAttribute m_running;
+    CompactBoolAttribute m_hidden;
 };
 
 
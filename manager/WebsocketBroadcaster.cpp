@@ -0,0 +1,111 @@
+#include "WebsocketBroadcaster.h"
+
+#include <QWebSocket>
+
+#include <QDebug>
+
+
+// create a shorter alias for the constants namespace:
+namespace WBC = WebsocketBroadcasterConstants;
+
+WebsocketBroadcaster::WebsocketBroadcaster(QObject* parent)
+    : QObject(parent)
+    , m_droppedFrameCount(0)
+{
+
+}
+
+void WebsocketBroadcaster::addClient(QWebSocket* client) {
+    if (!client || m_queues.contains(client)) return;
+    m_queues.insert(client, ClientQueue());
+    connect(client, &QWebSocket::bytesWritten, this, &WebsocketBroadcaster::onBytesWritten);
+}
+
+void WebsocketBroadcaster::removeClient(QWebSocket* client) {
+    if (!m_queues.contains(client)) return;
+    m_queues.remove(client);
+    disconnect(client, &QWebSocket::bytesWritten, this, &WebsocketBroadcaster::onBytesWritten);
+}
+
+void WebsocketBroadcaster::send(QWebSocket* client, const QByteArray& frame, DeliveryPolicy policy, const QString& key) {
+    auto queue = m_queues.find(client);
+    if (queue == m_queues.end()) return;
+    enqueue(client, queue.value(), frame, policy, key);
+}
+
+void WebsocketBroadcaster::broadcast(const QByteArray& frame, DeliveryPolicy policy, const QString& key) {
+    // iterate over a copy of the keys because overflowing clients are removed:
+    const QList<QWebSocket*> clients = m_queues.keys();
+    for (QWebSocket* client: clients) {
+        auto queue = m_queues.find(client);
+        if (queue == m_queues.end()) continue;
+        enqueue(client, queue.value(), frame, policy, key);
+    }
+}
+
+bool WebsocketBroadcaster::isBusy(QWebSocket* client) const {
+    auto queue = m_queues.constFind(client);
+    if (queue == m_queues.constEnd()) return false;
+    return !queue->frames.isEmpty() || queue->bytesInFlight >= WBC::maxBytesInFlight;
+}
+
+void WebsocketBroadcaster::onBytesWritten(qint64 bytes) {
+    QWebSocket* client = qobject_cast<QWebSocket*>(sender());
+    auto queue = m_queues.find(client);
+    if (queue == m_queues.end()) return;
+    // the written bytes include the frame headers:
+    queue->bytesInFlight = qMax<qint64>(0, queue->bytesInFlight - bytes);
+    pump(client, queue.value());
+}
+
+bool WebsocketBroadcaster::enqueue(QWebSocket* client, ClientQueue& queue, const QByteArray& frame, DeliveryPolicy policy, const QString& key) {
+    const bool busy = !queue.frames.isEmpty() || queue.bytesInFlight >= WBC::maxBytesInFlight;
+
+    if (policy == BulkDelivery) {
+        // a few large files must not disconnect the client, they are only delayed:
+        queue.bulkFrames.append(frame);
+        pump(client, queue);
+        return true;
+    }
+    if (policy == DropIfBusy && busy) {
+        ++m_droppedFrameCount;
+        return true;
+    }
+    if (policy == LatestWins && !key.isEmpty()) {
+        for (Frame& queued: queue.frames) {
+            if (queued.key != key) continue;
+            // the stale frame is replaced, the position in the queue stays the same:
+            queue.queuedBytes += frame.size() - queued.data.size();
+            queued.data = frame;
+            ++m_droppedFrameCount;
+            return true;
+        }
+    }
+
+    if (!queue.frames.isEmpty()
+            && (queue.frames.size() >= WBC::maxQueuedFrames
+                || queue.queuedBytes + frame.size() > WBC::maxQueuedBytes)) {
+        qWarning() << "WebsocketServer: Outgoing queue of client" << client->peerAddress().toString()
+                   << "overflowed, disconnecting it.";
+        removeClient(client);
+        client->close(QWebSocketProtocol::CloseCodeGoingAway, QStringLiteral("Client too slow"));
+        return false;
+    }
+
+    queue.frames.append(Frame{frame, key});
+    queue.queuedBytes += frame.size();
+    pump(client, queue);
+    return true;
+}
+
+void WebsocketBroadcaster::pump(QWebSocket* client, ClientQueue& queue) {
+    while (!queue.frames.isEmpty() && queue.bytesInFlight < WBC::maxBytesInFlight) {
+        const Frame frame = queue.frames.takeFirst();
+        queue.queuedBytes -= frame.data.size();
+        queue.bytesInFlight += client->sendBinaryMessage(frame.data);
+    }
+    // state frames have priority, the bulk frames use the remaining bandwidth:
+    while (queue.frames.isEmpty() && !queue.bulkFrames.isEmpty() && queue.bytesInFlight < WBC::maxBytesInFlight) {
+        queue.bytesInFlight += client->sendBinaryMessage(queue.bulkFrames.takeFirst());
+    }
+}
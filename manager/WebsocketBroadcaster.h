@@ -0,0 +1,152 @@
+#ifndef WEBSOCKETBROADCASTER_H
+#define WEBSOCKETBROADCASTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// forward declaration to reduce dependencies
+class QWebSocket;
+
+
+/**
+ * @brief The WebsocketBroadcasterConstants namespace contains all constants used in WebsocketBroadcaster.
+ */
+namespace WebsocketBroadcasterConstants {
+    /**
+     * @brief maxBytesInFlight is the amount of bytes passed to a socket but not yet written
+     * after which further frames are kept in the queue of the client
+     */
+    static const qint64 maxBytesInFlight = 1024 * 1024;
+    /**
+     * @brief maxQueuedFrames is the maximum number of frames in the queue of a client
+     */
+    static const int maxQueuedFrames = 512;
+    /**
+     * @brief maxQueuedBytes is the maximum size of the queue of a client,
+     * a single larger frame is accepted if the queue is empty
+     */
+    static const qint64 maxQueuedBytes = 32 * 1024 * 1024;
+}
+
+/**
+ * @brief The DeliveryPolicy enum describes what happens with a frame if a client can't receive it immediately.
+ */
+enum DeliveryPolicy {
+    /**
+     * @brief ReliableDelivery frames are queued, the client is disconnected if its queue overflows
+     */
+    ReliableDelivery = 0,
+    /**
+     * @brief DropIfBusy frames are dropped if the client is busy (i.e. optional previews)
+     */
+    DropIfBusy,
+    /**
+     * @brief LatestWins frames replace a queued frame with the same key (i.e. state updates)
+     */
+    LatestWins,
+    /**
+     * @brief BulkDelivery frames are kept in a separate queue without the limits of the other frames
+     * and are only sent when no other frame is queued (i.e. file responses,
+     * their amount is already limited by the file server)
+     */
+    BulkDelivery
+};
+
+/**
+ * @brief The WebsocketBroadcaster class sends frames to websocket clients
+ * through a bounded outgoing queue per client.
+ *
+ * Only a limited amount of data is passed to each socket at once, the rest is kept in the queue
+ * until the socket reports that it has been written. This way a slow client only fills its own queue
+ * instead of the memory and event loop of the whole application. A broadcasted frame is a single
+ * implicitly shared QByteArray that is referenced by the queues of all clients.
+ */
+class WebsocketBroadcaster : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WebsocketBroadcaster(QObject* parent = nullptr);
+
+    void addClient(QWebSocket* client);
+    void removeClient(QWebSocket* client);
+
+    /**
+     * @brief send sends a frame to a single client
+     * @param client the client
+     * @param frame the encoded message
+     * @param policy what to do if the client can't receive it immediately
+     * @param key identifies frames that replace each other (LatestWins only)
+     */
+    void send(QWebSocket* client, const QByteArray& frame, DeliveryPolicy policy = ReliableDelivery, const QString& key = QString());
+
+    /**
+     * @brief broadcast sends the same frame to all clients
+     * @param frame the encoded message, it is shared and not copied
+     * @param policy what to do if a client can't receive it immediately
+     * @param key identifies frames that replace each other (LatestWins only)
+     */
+    void broadcast(const QByteArray& frame, DeliveryPolicy policy = ReliableDelivery, const QString& key = QString());
+
+    /**
+     * @brief isBusy returns true if a client has queued frames or the maximum amount of data in flight
+     * @param client the client
+     * @return true if another frame would be queued
+     */
+    bool isBusy(QWebSocket* client) const;
+
+    /**
+     * @brief getDroppedFrameCount returns the number of frames dropped because of busy clients
+     * @return number of frames
+     */
+    qint64 getDroppedFrameCount() const { return m_droppedFrameCount; }
+
+private slots:
+    void onBytesWritten(qint64 bytes);
+
+protected:
+    /**
+     * @brief The Frame struct is a queued frame.
+     */
+    struct Frame {
+        QByteArray data;
+        QString key;
+    };
+
+    /**
+     * @brief The ClientQueue struct contains the outgoing queue of a client.
+     */
+    struct ClientQueue {
+        QList<Frame> frames;
+        qint64 queuedBytes = 0;
+        /**
+         * @brief bulkFrames are the frames sent with BulkDelivery, they don't count towards the limits
+         */
+        QList<QByteArray> bulkFrames;
+        /**
+         * @brief bytesInFlight is the amount of bytes passed to the socket and not yet written
+         */
+        qint64 bytesInFlight = 0;
+    };
+
+    /**
+     * @brief enqueue adds a frame to the queue of a client and sends it if possible
+     * @return false if the queue overflowed and the client was disconnected
+     */
+    bool enqueue(QWebSocket* client, ClientQueue& queue, const QByteArray& frame, DeliveryPolicy policy, const QString& key);
+
+    /**
+     * @brief pump passes queued frames to the socket until the maximum amount of data is in flight,
+     * bulk frames are only passed when no other frame is queued
+     */
+    void pump(QWebSocket* client, ClientQueue& queue);
+
+    QHash<QWebSocket*, ClientQueue> m_queues;
+
+    qint64 m_droppedFrameCount;
+};
+
+#endif // WEBSOCKETBROADCASTER_H
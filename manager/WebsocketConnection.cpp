@@ -2,20 +2,25 @@
 
 #include "core/CoreController.h"
 #include "core/manager/GuiManager.h"
+#include "core/manager/WebsocketFileServer.h"
+#include "core/manager/NodeDataStreamer.h"
+#include "core/helpers/qstring_literal.h"
 
 #include <QWebSocketServer>
-#include <QUuid>
 #include <QQuickAsyncImageProvider>
 #include <QImage>
 #include <QQmlEngine>
 #include <QDir>
 #include <QBuffer>
 #include <QImageReader>
-#include <QQueue>
-#include <QPair>
-#include <QGuiApplication>
-#include <QScreen>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QNetworkReply>
+#include <QThread>
+
+#include <limits>
 
 #ifdef SSL_ENABLED
 #include <QSslKey>
@@ -30,6 +35,66 @@
 #include <QDebug>
 
 
+/**
+ * @brief The AsyncImageProviderConstants namespace contains all constants used in AsyncImageProvider.
+ */
+namespace AsyncImageProviderConstants {
+    /**
+     * @brief thumbnailMaxSize is the maximum width and height of an image to be cached as a thumbnail
+     */
+    static const int thumbnailMaxSize = 400;
+    /**
+     * @brief thumbnailCacheBytes is the memory budget of the thumbnail cache in bytes
+     */
+    static const int thumbnailCacheBytes = 32 * 1024 * 1024;
+    /**
+     * @brief fullImageCacheBytes is the memory budget of the cache of larger images in bytes
+     */
+    static const int fullImageCacheBytes = 128 * 1024 * 1024;
+}
+
+// create a shorter alias for the constants namespace:
+namespace AIPC = AsyncImageProviderConstants;
+
+
+// create a shorter alias for the constants namespace:
+namespace WCC = WebsocketConnectionConstants;
+
+
+namespace {
+
+/**
+ * @brief compressIfLarge wraps an encoded message in a compressed message if it is large
+ * @param data the encoded message
+ * @return the original or the compressed message
+ */
+QByteArray compressIfLarge(const QByteArray& data) {
+    if (data.size() <= WCC::compressionThreshold) return data;
+    const QByteArray compressed = qCompress(data);
+    // i.e. already compressed image data:
+    if (compressed.size() >= data.size()) return data;
+    QCborMap message;
+    message[QLatin1String("requestType")] = WsRequestTypes::COMPRESSED;
+    message[QLatin1String("data")] = compressed;
+    return message.toCborValue().toCbor();
+}
+
+/**
+ * @brief decodeMessage decodes a received message and decompresses it if necessary
+ * @param data the received message
+ * @return the message content
+ */
+QCborMap decodeMessage(const QByteArray& data) {
+    QCborMap message = QCborValue::fromCbor(data).toMap();
+    if (message.value(QLatin1String("requestType")).toString() == WsRequestTypes::COMPRESSED) {
+        return QCborValue::fromCbor(qUncompress(message.value(QLatin1String("data")).toByteArray())).toMap();
+    }
+    return message;
+}
+
+}  // namespace
+
+
 class AsyncImageResponse : public QQuickImageResponse {
 
 public:
@@ -45,19 +110,37 @@ public:
     explicit AsyncImageProvider(WebsocketConnection* websocketConnection)
         : QQuickAsyncImageProvider()
         , m_websocketConnection(websocketConnection)
+        , m_thumbnailCache(AIPC::thumbnailCacheBytes)
+        , m_fullImageCache(AIPC::fullImageCacheBytes)
     { }
 
+    // the only key function, used for requests and by isCached():
+    static QString cacheKey(const QString& id, const QSize& requestedSize) {
+        return "/" + id + "|" + QString::number(requestedSize.width()) + "x" + QString::number(requestedSize.height());
+    }
+
+    // this is called in the thread of the image loader:
     QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override {
         AsyncImageResponse* asyncResponse = new AsyncImageResponse();
-
-        // check cache:
-        QString cacheId = "/" + id + QString::number(requestedSize.width()) + QString::number(requestedSize.height());
-        for (auto item: m_imageCache) {
-            if (item.first == cacheId) {
-                asyncResponse->m_image = item.second;
+        const QString cacheId = cacheKey(id, requestedSize);
+
+        {
+            QMutexLocker locker(&m_mutex);
+            // check cache:
+            const QImage* cachedImage = cachedImageUnlocked(cacheId);
+            if (cachedImage) {
+                asyncResponse->m_image = *cachedImage;
+                locker.unlock();
                 emit asyncResponse->finished();
                 return asyncResponse;
             }
+            // the same image is already requested -> wait for that response:
+            auto pending = m_pendingResponses.find(cacheId);
+            if (pending != m_pendingResponses.end()) {
+                pending->append(asyncResponse);
+                return asyncResponse;
+            }
+            m_pendingResponses.insert(cacheId, {asyncResponse});
         }
 
         QCborMap data;
@@ -69,12 +152,31 @@ public:
             data[QString("width")] = 0;
             data[QString("height")] = 0;
         }
+        // the file is sent in chunks to not create another copy of it in a single message:
+        data[QString("chunked")] = true;
+        data[QString("window")] = WebsocketFileServerConstants::defaultChunkWindow;
+        // collects the chunks, shared by all copies of the callback:
+        QSharedPointer<QByteArray> receivedContent = QSharedPointer<QByteArray>::create();
 
         emit m_websocketConnection->askServerMainthread(
                     WsRequestTypes::FILE,
                     data,
-                    [this, id, requestedSize, asyncResponse, cacheId](QCborMap response) {
-            QByteArray content = response[QString("content")].toByteArray();
+                    [this, requestedSize, cacheId, receivedContent](QCborMap response) {
+            QByteArray content;
+            if (response.contains(QString("chunk"))) {
+                if (response[QString("offset")].toInteger() == 0) {
+                    // allocate the whole content at once:
+                    receivedContent->clear();
+                    receivedContent->reserve(int(response[QString("size")].toInteger()));
+                }
+                receivedContent->append(response[QString("chunk")].toByteArray());
+                if (!response[QString("final")].toBool()) return;
+                content = *receivedContent;
+                receivedContent->clear();
+            } else {
+                // servers without support for chunked transfers send the whole file:
+                content = response[QString("content")].toByteArray();
+            }
             // thumbnail size: < 8kB
             // medium size: < 30kB
             // full size: > 1MB, up to 11 MB
@@ -84,66 +186,103 @@ public:
                 // processing a thumbnail takes ~1.8ms
                 // threading has overhead of <0.2ms
 #ifdef THREADS_ENABLED
-                QtConcurrent::run([this, requestedSize, asyncResponse, cacheId, content]() mutable {
-                    this->processImage(requestedSize, asyncResponse, cacheId, content);
+                QtConcurrent::run([this, requestedSize, cacheId, content]() mutable {
+                    this->processImage(requestedSize, cacheId, content);
                 });
 #endif
             } else {
                 // small thumbnails are processed in main thread
-                this->processImage(requestedSize, asyncResponse, cacheId, content);
+                this->processImage(requestedSize, cacheId, content);
             }
+        }, [this, requestedSize, cacheId](QString) {
+            // finishes the waiting responses with an empty image:
+            this->processImage(requestedSize, cacheId, QByteArray());
         });
 
         return asyncResponse;
     }
 
-    void processImage(const QSize& requestedSize, AsyncImageResponse* asyncResponse,
-                      QString cacheId, QByteArray content) {
+    void processImage(const QSize& requestedSize, QString cacheId, QByteArray content) {
         QBuffer readBuffer(&content);
         readBuffer.open(QIODevice::ReadOnly);
         QImageReader imageReader(&readBuffer);
         imageReader.setAutoTransform(true);
-        asyncResponse->m_image = imageReader.read();
+        QImage image = imageReader.read();
 
         if (requestedSize.isValid()) {
             double ratio = 1.0;
             if (requestedSize.height() <= 0 && requestedSize.width() > 0) {
-                ratio = requestedSize.width() / double(asyncResponse->m_image.width());
+                ratio = requestedSize.width() / double(image.width());
             } else if (requestedSize.width() <= 0 && requestedSize.height() > 0) {
-                ratio = requestedSize.height() / double(asyncResponse->m_image.height());
+                ratio = requestedSize.height() / double(image.height());
             }
             if (ratio < 1.0) {
-                QSize newSize(int(asyncResponse->m_image.width() * ratio), int(asyncResponse->m_image.height() * ratio));
-                asyncResponse->m_image = asyncResponse->m_image.scaled(newSize);
+                QSize newSize(int(image.width() * ratio), int(image.height() * ratio));
+                image = image.scaled(newSize);
             }
         }
 
-        if (asyncResponse->m_image.width() > 300) {
-            m_imageCache << QPair<QString, QImage>(cacheId, asyncResponse->m_image);
-            if (m_imageCache.size() > 7) {
-                m_imageCache.dequeue();
+        QVector<AsyncImageResponse*> responses;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!image.isNull()) {
+                // the cost of each entry is its size in bytes, the least recently used
+                // entries are removed when a budget is exceeded:
+                const int cost = int(qMin<qint64>(image.sizeInBytes(), std::numeric_limits<int>::max()));
+                if (image.width() <= AIPC::thumbnailMaxSize && image.height() <= AIPC::thumbnailMaxSize) {
+                    m_thumbnailCache.insert(cacheId, new QImage(image), cost);
+                } else {
+                    m_fullImageCache.insert(cacheId, new QImage(image), cost);
+                }
             }
+            responses = m_pendingResponses.take(cacheId);
         }
 
-        emit asyncResponse->finished();
+        for (AsyncImageResponse* asyncResponse: responses) {
+            asyncResponse->m_image = image;
+            emit asyncResponse->finished();
+        }
     }
 
     bool isCached(const QString& id, const QSize& requestedSize) const {
-        QSize realSize = requestedSize * QGuiApplication::primaryScreen()->devicePixelRatio();
-        QString cacheId = id + QString::number(realSize.width()) + QString::number(realSize.height());
-        for (auto item: m_imageCache) {
-            if (item.first == cacheId) {
-                return true;
-            }
-        }
-        return false;
+        const QString cacheId = cacheKey(id, requestedSize);
+        QMutexLocker locker(&m_mutex);
+        return m_thumbnailCache.contains(cacheId) || m_fullImageCache.contains(cacheId);
     }
 
 private:
+    /**
+     * @brief cachedImageUnlocked returns a cached image and marks it as recently used
+     * (m_mutex has to be locked)
+     * @param cacheId key of the image
+     * @return pointer to the image (owned by the cache) or nullptr
+     */
+    const QImage* cachedImageUnlocked(const QString& cacheId) {
+        const QImage* image = m_thumbnailCache.object(cacheId);
+        if (image) return image;
+        return m_fullImageCache.object(cacheId);
+    }
+
     WebsocketConnection* m_websocketConnection;
-    QQueue<QPair<QString, QImage>> m_imageCache;
-};
 
+    /**
+     * @brief m_mutex protects the caches and pending responses,
+     * they are accessed from the image loader thread, the main thread and worker threads
+     */
+    mutable QMutex m_mutex;
+
+    /**
+     * @brief m_thumbnailCache and m_fullImageCache contain decoded images by cache key,
+     * the total cost of each cache is the size of its images in bytes
+     */
+    QCache<QString, QImage> m_thumbnailCache;
+    QCache<QString, QImage> m_fullImageCache;
+
+    /**
+     * @brief m_pendingResponses contains the responses waiting for a requested image by cache key
+     */
+    QHash<QString, QVector<AsyncImageResponse*>> m_pendingResponses;
+};
 
 WebsocketConnection::WebsocketConnection(CoreController* controller)
     : QObject(controller)
@@ -164,8 +303,17 @@ WebsocketConnection::WebsocketConnection(CoreController* controller)
     , m_websocketServer(new QWebSocketServer(QStringLiteral("Luminosus Websocket Server"),
                                              QWebSocketServer::NonSecureMode, this))
 #endif
+    , m_broadcaster(new WebsocketBroadcaster(this))
+    , m_fileServer(new WebsocketFileServer(controller, this))
+    , m_nodeDataStreamer(new NodeDataStreamer(controller, this))
     , m_connectedToServer(this, "connectedToServer", false, /*persistent*/ false)
+    , m_nextPacketId(0)
+    , m_roundTripTime(this, "roundTripTime", 0, 0, 60000, /*persistent*/ false)
+    , m_pendingRequestCount(this, "pendingRequestCount", 0, 0, std::numeric_limits<int>::max(), /*persistent*/ false)
 {
+    // updated with every request and response, only displayed in the GUI:
+    m_roundTripTime.setNotificationMode(SmartAttribute::NotificationMode::Coalesced);
+    m_pendingRequestCount.setNotificationMode(SmartAttribute::NotificationMode::Coalesced);
 #ifdef SSL_ENABLED
     QSslConfiguration sslConfiguration;
     QFile certFile(QStringLiteral(":/core/data/luminosus_websocket.cert"));
@@ -192,10 +340,27 @@ WebsocketConnection::WebsocketConnection(CoreController* controller)
 #endif
 
     qRegisterMetaType<std::function<void (QCborMap)>>("std::function<void(QCborMap)>");
-    connect(this, &WebsocketConnection::askServerMainthread,
-            this, &WebsocketConnection::askServer, Qt::QueuedConnection);
+    qRegisterMetaType<std::function<void (QString)>>("std::function<void(QString)>");
+    connect(this, &WebsocketConnection::askServerMainthread, this,
+            [this](QString fnName, QCborMap value, std::function<void (QCborMap)> callback, std::function<void (QString)> onError) {
+        askServerWithDeadline(fnName, value, callback, onError);
+    }, Qt::QueuedConnection);
     connect(this, &WebsocketConnection::sendToClientMainthread,
             this, &WebsocketConnection::handleSendToClientMainthread, Qt::QueuedConnection);
+    connect(m_fileServer, &WebsocketFileServer::responseReady,
+            this, &WebsocketConnection::handleFileResponseMainthread, Qt::QueuedConnection);
+    connect(m_nodeDataStreamer, &NodeDataStreamer::updateReady,
+            this, &WebsocketConnection::handleSendToClientMainthread);
+
+    // all requests of one event loop iteration are sent in the same batch:
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(0);
+    connect(&m_batchTimer, &QTimer::timeout, this, &WebsocketConnection::flushRequestBatch);
+    m_deadlineTimer.setInterval(WCC::timeoutCheckIntervalMs);
+    connect(&m_deadlineTimer, &QTimer::timeout, this, &WebsocketConnection::checkRequestDeadlines);
+    m_congestionTimer.setInterval(WCC::congestionCheckIntervalMs);
+    connect(&m_congestionTimer, &QTimer::timeout, this, &WebsocketConnection::flushSendBacklog);
+    m_requestClock.start();
 
 
     connect(m_websocketServer, &QWebSocketServer::newConnection,
@@ -259,16 +424,52 @@ void WebsocketConnection::setState(QCborMap state) {
 }
 
 void WebsocketConnection::tellServer(QString contentType, QCborMap value) {
+    if (QThread::currentThread() != thread()) {
+        // the send backlog is only used in the main thread:
+        QMetaObject::invokeMethod(this, [this, contentType, value]() { tellServer(contentType, value); },
+                                  Qt::QueuedConnection);
+        return;
+    }
     value[QStringLiteral("requestType")] = contentType;
-    m_asyncWebsocketClient.sendBinaryMessage(value.toCborValue().toCbor());
+    sendToServer(value);
 }
 
 void WebsocketConnection::askServer(QString fnName, QCborMap value, std::function<void (QCborMap)> callback) {
-    QString packetId = QUuid::createUuid().toString();
+    askServerWithDeadline(fnName, value, callback, nullptr);
+}
+
+void WebsocketConnection::askServerWithDeadline(QString fnName, QCborMap value, std::function<void (QCborMap)> callback,
+                                                std::function<void (QString)> onError, int timeoutMs, bool batched) {
+    if (QThread::currentThread() != thread()) {
+        // the pending requests are only used in the main thread:
+        QMetaObject::invokeMethod(this, [=]() { askServerWithDeadline(fnName, value, callback, onError, timeoutMs, batched); },
+                                  Qt::QueuedConnection);
+        return;
+    }
+    const qint64 packetId = m_nextPacketId++;
     value[QStringLiteral("requestType")] = fnName;
     value[QLatin1String("packetId")] = packetId;
-    m_asyncWebsocketClient.sendBinaryMessage(value.toCborValue().toCbor());
-    m_packetCallbacks.insert(packetId, callback);
+    value[QLatin1String("acceptsCompressed")] = true;
+
+    const qint64 now = m_requestClock.elapsed();
+    m_pendingRequests.insert(packetId, PendingRequest{callback, onError, now, now + timeoutMs, timeoutMs, false});
+    m_pendingRequestCount = m_pendingRequests.size();
+    if (!m_deadlineTimer.isActive()) m_deadlineTimer.start();
+
+    if (batched) {
+        m_requestBatch.append(value);
+        if (m_requestBatch.size() >= WCC::maxBatchSize) {
+            flushRequestBatch();
+        } else if (!m_batchTimer.isActive()) {
+            m_batchTimer.start();
+        }
+    } else {
+        sendToServer(value);
+    }
+}
+
+void WebsocketConnection::askServerBatched(QString fnName, QCborMap value, std::function<void (QCborMap)> callback) {
+    askServerWithDeadline(fnName, value, callback, nullptr, WCC::defaultTimeoutMs, /*batched*/ true);
 }
 
 void WebsocketConnection::registerFunction(const QString& requestType, std::function<QCborMap(QCborMap)> handler) {
@@ -279,6 +480,11 @@ void WebsocketConnection::registerFunction(const QString& requestType, std::func
     m_requestHandlers.insert(requestType, handler);
 }
 
+void WebsocketConnection::broadcast(const QCborMap& message, DeliveryPolicy policy, const QString& key) {
+    // the encoded message is shared by the queues of all clients:
+    m_broadcaster->broadcast(message.toCborValue().toCbor(), policy, key);
+}
+
 void WebsocketConnection::registerListener(const QString& contentType, std::function<void(QCborMap)> listener) {
     if (m_requestListeners.contains(contentType)) {
         m_requestListeners[contentType].append(listener);
@@ -329,60 +535,7 @@ void WebsocketConnection::onNewConnection() {
     connect(socket, &QWebSocket::binaryMessageReceived, this, &WebsocketConnection::processBinaryMessageFromClient);
     connect(socket, &QWebSocket::disconnected, this, &WebsocketConnection::onClientDisconnected);
     m_clients << socket;
-}
-
-QByteArray loadFile(QString path) {
-    QFile loadFile(path);
-    if (!loadFile.open(QIODevice::ReadOnly)) {
-        qWarning() << "Couldn't open file " + path + ".";
-        return QByteArray();
-    }
-    QByteArray content = loadFile.readAll();
-    loadFile.close();
-    return content;
-}
-
-QByteArray loadImage(QString path, int maxWidth, int maxHeight) {
-    if (maxWidth > 0 && maxHeight > 0) {
-        QImageReader imageReader(path);
-        imageReader.setAutoTransform(true);
-        QSize imageSize = imageReader.size();
-        bool rotated = imageReader.transformation().testFlag(QImageIOHandler::TransformationRotate90)
-                || imageReader.transformation().testFlag(QImageIOHandler::TransformationRotate270);
-        if (rotated) imageSize.transpose();
-        double viewportRatio = double(maxWidth) / maxHeight;
-        double imageRatio = double(imageSize.width()) / imageSize.height();
-        double scaleRatio = 1.0;
-        if (viewportRatio < imageRatio) {
-            // limit is width
-            scaleRatio = maxWidth / double(imageSize.width());
-        } else {
-            // limit is height
-            scaleRatio = maxHeight / double(imageSize.height());
-        }
-        if (scaleRatio < 1.0) {
-            // max size is smaller than image
-            // -> only return required size and compress it:
-            QSize newSize(int(imageSize.width() * scaleRatio), int(imageSize.height() * scaleRatio));
-            if (rotated) newSize.transpose();
-            // using setScaledSize avoids loading the whole image first
-            imageReader.setScaledSize(newSize);
-            QImage image = imageReader.read();
-            QByteArray content;
-            QBuffer buffer(&content);
-            buffer.open(QIODevice::WriteOnly);
-            image.save(&buffer, "JPG", 75);
-            return content;
-        } else {
-            // max width and height is larger than image,
-            // return full, original image:
-            return loadFile(path);
-        }
-    } else {
-        // max size is not set,
-        // return original image:
-        return loadFile(path);
-    }
+    m_broadcaster->addClient(socket);
 }
 
 void WebsocketConnection::processBinaryMessageFromClient(QByteArray data) {
@@ -391,44 +544,72 @@ void WebsocketConnection::processBinaryMessageFromClient(QByteArray data) {
         qWarning() << "WebsocketServer: Client of received message is invalid.";
         return;
     }
-    QCborMap message = QCborValue::fromCbor(data).toMap();
+    QCborMap message = decodeMessage(data);
+
+    if (message.value(QLatin1String("requestType")).toString() == WsRequestTypes::BATCH) {
+        // the responses of all requests that can be answered immediately are sent in a single message:
+        QCborArray responses;
+        bool compressionAllowed = false;
+        for (const QCborValue& request: message.value(QLatin1String("requests")).toArray()) {
+            const QCborMap requestMap = request.toMap();
+            compressionAllowed = compressionAllowed || requestMap.value(QLatin1String("acceptsCompressed")).toBool();
+            handleRequestFromClient(client, requestMap, &responses);
+        }
+        if (!responses.isEmpty()) {
+            QCborMap batch;
+            batch[QLatin1String("requestType")] = WsRequestTypes::BATCH;
+            batch[QLatin1String("responses")] = responses;
+            sendResponseToClient(client, batch, compressionAllowed);
+        }
+        return;
+    }
+    handleRequestFromClient(client, message, nullptr);
+}
+
+void WebsocketConnection::handleRequestFromClient(QWebSocket* client, const QCborMap& message, QCborArray* batchResponses) {
     QString requestType = message.value(QLatin1String("requestType")).toString();
+    const bool compressionAllowed = message.value(QLatin1String("acceptsCompressed")).toBool();
 
     if (requestType == WsRequestTypes::FILE) {
-        // loading and sending files is done in separate thread:
-#ifdef THREADS_ENABLED
-        QtConcurrent::run([this, client, message]() mutable {
-            QString path = message.value(QLatin1String("path")).toString();
-            if (!QDir().exists(path)) {
-                qWarning() << "File " + path + " does not exist.";
-                return;
-            }
-
-            QByteArray content;
-            if (path.toLower().endsWith(".jpg") || path.toLower().endsWith(".jpeg")) {
-                int maxWidth = int(message[QString("width")].toInteger());
-                int maxHeight = int(message[QString("height")].toInteger());
-                content = loadImage(path, maxWidth, maxHeight);
-            } else {
-                content = loadFile(path);
-            }
-
-            message[QString("content")] = content;
-            emit sendToClientMainthread(client, message.toCborValue().toCbor());
-        });
-#endif
-
+        // loading and sending files is done in separate threads:
+        m_fileServer->enqueue(client, message);
+    } else if (requestType == WsRequestTypes::FILE_ACK) {
+        m_fileServer->acknowledgeChunk(client, message.value(QLatin1String("packetId")));
+    } else if (requestType == WsRequestTypes::NODE_DATA_SUBSCRIBE) {
+        m_nodeDataStreamer->subscribe(client, message);
+    } else if (requestType == WsRequestTypes::NODE_DATA_UNSUBSCRIBE) {
+        m_nodeDataStreamer->unsubscribe(client, message);
     } else if (m_requestHandlers.contains(requestType)) {
         QCborMap result = m_requestHandlers[requestType](message);
-        client->sendBinaryMessage(result.toCborValue().toCbor());
+        if (message.contains(QLatin1String("packetId")) && !result.contains(QLatin1String("packetId"))) {
+            // the client needs the packet id to find the callback:
+            result[QLatin1String("packetId")] = message.value(QLatin1String("packetId"));
+        }
+        if (batchResponses) {
+            batchResponses->append(result);
+        } else {
+            sendResponseToClient(client, result, compressionAllowed);
+        }
     } else if (m_requestListeners.contains(requestType)) {
         for (auto& listener: m_requestListeners[requestType]) {
             listener(message);
         }
     } else {
         // echo message if no known request type is given:
-        client->sendBinaryMessage(data);
+        if (batchResponses) {
+            batchResponses->append(message);
+        } else {
+            sendResponseToClient(client, message, compressionAllowed);
+        }
+    }
+}
+
+void WebsocketConnection::sendResponseToClient(QWebSocket* client, const QCborMap& response, bool compressionAllowed) {
+    QByteArray data = response.toCborValue().toCbor();
+    if (compressionAllowed) {
+        data = compressIfLarge(data);
     }
+    m_broadcaster->send(client, data);
 }
 
 void WebsocketConnection::onClientDisconnected() {
@@ -436,6 +617,9 @@ void WebsocketConnection::onClientDisconnected() {
     qDebug() << "WebsocketServer: Client disconnect:" << client;
     if (client) {
         m_clients.removeAll(client);
+        m_broadcaster->removeClient(client);
+        m_fileServer->cancelRequestsOf(client);
+        m_nodeDataStreamer->removeClient(client);
         client->deleteLater();
     }
 }
@@ -450,16 +634,56 @@ void WebsocketConnection::onConnectedToServer() {
 
 void WebsocketConnection::onDisconnectedFromServer() {
     m_connectedToServer = false;
+    // the responses will never arrive:
+    m_requestBatch = QCborArray();
+    m_sendBacklog.clear();
+    m_congestionTimer.stop();
+    failPendingRequests("disconnected"_q);
 }
 
 void WebsocketConnection::processBinaryMessageFromServer(QByteArray data) {
-    QCborMap message = QCborValue::fromCbor(data).toMap();
+    QCborMap message = decodeMessage(data);
+    if (message.value(QLatin1String("requestType")).toString() == WsRequestTypes::BATCH) {
+        for (const QCborValue& response: message.value(QLatin1String("responses")).toArray()) {
+            handleMessageFromServer(response.toMap());
+        }
+        return;
+    }
+    handleMessageFromServer(message);
+}
+
+void WebsocketConnection::handleMessageFromServer(const QCborMap& message) {
     if (message.contains(QLatin1String("packetId"))){
-        QString packetId = message.value(QLatin1String("packetId")).toString();
-        if (m_packetCallbacks.contains(packetId)) {
-            m_packetCallbacks[packetId](message);
-            m_packetCallbacks.remove(packetId);
+        const qint64 packetId = message.value(QLatin1String("packetId")).toInteger(-1);
+        auto it = m_pendingRequests.find(packetId);
+        // unknown requests may have already timed out:
+        if (it == m_pendingRequests.end()) return;
+
+        const qint64 now = m_requestClock.elapsed();
+        if (!it->answered) {
+            it->answered = true;
+            const double roundTripTime = now - it->sentTime;
+            if (m_roundTripTime.getValue() <= 0) {
+                m_roundTripTime = roundTripTime;
+            } else {
+                m_roundTripTime = m_roundTripTime * (1 - WCC::roundTripTimeSmoothing)
+                        + roundTripTime * WCC::roundTripTimeSmoothing;
+            }
+        }
+
+        // the callback is copied because it may send another request and modify m_pendingRequests:
+        const std::function<void(QCborMap)> callback = it->callback;
+        if (message.contains(QLatin1String("final")) && !message.value(QLatin1String("final")).toBool()) {
+            // a chunk of a chunked transfer, acknowledge it to receive the next one:
+            it->deadline = now + it->timeoutMs;
+            QCborMap acknowledgement;
+            acknowledgement[QLatin1String("packetId")] = packetId;
+            tellServer(WsRequestTypes::FILE_ACK, acknowledgement);
+        } else {
+            m_pendingRequests.erase(it);
+            m_pendingRequestCount = m_pendingRequests.size();
         }
+        if (callback) callback(message);
     } else if (message.contains(QLatin1String("requestType"))) {
         QString requestType = message.value(QLatin1String("requestType")).toString();
         if (m_requestListeners.contains(requestType)) {
@@ -470,6 +694,111 @@ void WebsocketConnection::processBinaryMessageFromServer(QByteArray data) {
     }
 }
 
+void WebsocketConnection::sendToServer(const QCborMap& message) {
+    OutgoingMessage outgoing;
+    outgoing.data = compressIfLarge(message.toCborValue().toCbor());
+    if (message.contains(QLatin1String("packetId"))) {
+        outgoing.packetIds.append(message.value(QLatin1String("packetId")).toInteger());
+    }
+    for (const QCborValue& request: message.value(QLatin1String("requests")).toArray()) {
+        outgoing.packetIds.append(request.toMap().value(QLatin1String("packetId")).toInteger());
+    }
+
+    if (m_sendBacklog.isEmpty() && !m_asyncWebsocketClient.isCongested()) {
+        writeToServer(outgoing);
+        return;
+    }
+    // the socket can't keep up, the message waits to not fill up its queue:
+    if (m_sendBacklog.size() >= WCC::maxSendBacklog) {
+        qWarning() << "WebsocketConnection: Connection to server is congested, message dropped.";
+        failRequests(outgoing.packetIds, "congested"_q);
+        return;
+    }
+    m_sendBacklog.append(outgoing);
+    if (!m_congestionTimer.isActive()) m_congestionTimer.start();
+}
+
+void WebsocketConnection::writeToServer(const OutgoingMessage& message) {
+    if (m_asyncWebsocketClient.sendBinaryMessage(message.data) < 0) {
+        failRequests(message.packetIds, "queue full"_q);
+    }
+}
+
+void WebsocketConnection::flushSendBacklog() {
+    // messages are sent in order, the rest waits until the socket wrote more data:
+    while (!m_sendBacklog.isEmpty() && !m_asyncWebsocketClient.isCongested()) {
+        writeToServer(m_sendBacklog.takeFirst());
+    }
+    if (m_sendBacklog.isEmpty()) m_congestionTimer.stop();
+}
+
+void WebsocketConnection::failRequests(const QVector<qint64>& packetIds, const QString& error) {
+    QVector<std::function<void(QString)>> failed;
+    for (qint64 packetId: packetIds) {
+        const PendingRequest request = m_pendingRequests.take(packetId);
+        if (request.onError) failed.append(request.onError);
+    }
+    m_pendingRequestCount = m_pendingRequests.size();
+    if (failed.isEmpty()) return;
+    // called later because the caller may not expect the error handler to be called while sending:
+    QTimer::singleShot(0, this, [failed, error]() {
+        for (const auto& onError: failed) {
+            onError(error);
+        }
+    });
+}
+
+void WebsocketConnection::failPendingRequests(const QString& error) {
+    const QHash<qint64, PendingRequest> requests = m_pendingRequests;
+    m_pendingRequests.clear();
+    m_pendingRequestCount = 0;
+    m_deadlineTimer.stop();
+    for (const PendingRequest& request: requests) {
+        if (request.onError) request.onError(error);
+    }
+}
+
 void WebsocketConnection::handleSendToClientMainthread(QWebSocket* client, const QByteArray& data) {
-    client->sendBinaryMessage(data);
+    // the client may have disconnected in the meantime:
+    if (!m_clients.contains(client)) return;
+    m_broadcaster->send(client, data);
+}
+
+void WebsocketConnection::handleFileResponseMainthread(QWebSocket* client, const QByteArray& data) {
+    // the client may have disconnected in the meantime:
+    if (!m_clients.contains(client)) return;
+    m_broadcaster->send(client, data, BulkDelivery);
+}
+
+void WebsocketConnection::flushRequestBatch() {
+    m_batchTimer.stop();
+    if (m_requestBatch.isEmpty()) return;
+    if (m_requestBatch.size() == 1) {
+        sendToServer(m_requestBatch.at(0).toMap());
+    } else {
+        QCborMap batch;
+        batch[QLatin1String("requestType")] = WsRequestTypes::BATCH;
+        batch[QLatin1String("requests")] = m_requestBatch;
+        sendToServer(batch);
+    }
+    m_requestBatch = QCborArray();
+}
+
+void WebsocketConnection::checkRequestDeadlines() {
+    const qint64 now = m_requestClock.elapsed();
+    QVector<std::function<void(QString)>> expired;
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+        if (it->deadline <= now) {
+            if (it->onError) expired.append(it->onError);
+            it = m_pendingRequests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_pendingRequestCount = m_pendingRequests.size();
+    if (m_pendingRequests.isEmpty()) m_deadlineTimer.stop();
+    // called after the loop because they may send new requests:
+    for (const auto& onError: expired) {
+        onError("timeout"_q);
+    }
 }
@@ -4,6 +4,7 @@
 #include "core/helpers/SmartAttribute.h"
 #include "core/helpers/ObjectWithAttributes.h"
 #include "core/helpers/AsyncWebSocket.h"
+#include "core/manager/WebsocketBroadcaster.h"
 
 #include <QObject>
 #include <QList>
@@ -14,6 +15,9 @@
 #include <QTimer>
 #include <QNetworkAccessManager>
 #include <QSize>
+#include <QHash>
+#include <QCborArray>
+#include <QElapsedTimer>
 
 #include <functional>
 
@@ -21,15 +25,60 @@ class QWebSocketServer;
 class QWebSocket;
 class CoreController;
 class AsyncImageProvider;
+class WebsocketFileServer;
+class NodeDataStreamer;
 
 
 namespace WsRequestTypes {
     static const QString FILE = "file";
+    static const QString FILE_ACK = "fileAck";
+    static const QString NODE_DATA_SUBSCRIBE = "nodeDataSubscribe";
+    static const QString NODE_DATA_UNSUBSCRIBE = "nodeDataUnsubscribe";
+    static const QString NODE_DATA = "nodeData";
+    static const QString BATCH = "batch";
+    static const QString COMPRESSED = "compressed";
     static const QString USER_INPUT = "userInput";
     static const QString SYSTEM_OUTPUT = "systemOutput";
     static const QString ANSWER_OPTIONS = "answerOptions";
 }
 
+/**
+ * @brief The WebsocketConnectionConstants namespace contains all constants used in WebsocketConnection.
+ */
+namespace WebsocketConnectionConstants {
+    /**
+     * @brief defaultTimeoutMs is the time after which a request without response fails
+     */
+    static const int defaultTimeoutMs = 10000;
+    /**
+     * @brief timeoutCheckIntervalMs is the interval in which the deadlines of requests are checked
+     */
+    static const int timeoutCheckIntervalMs = 250;
+    /**
+     * @brief maxBatchSize is the maximum number of requests sent in a single batch message
+     */
+    static const int maxBatchSize = 64;
+    /**
+     * @brief compressionThreshold is the size of a message in bytes above which it is compressed
+     * (if the receiver supports it)
+     */
+    static const int compressionThreshold = 16 * 1024;
+    /**
+     * @brief roundTripTimeSmoothing is the weight of a new sample in the moving average of the round trip time
+     */
+    static const double roundTripTimeSmoothing = 0.1;
+    /**
+     * @brief maxSendBacklog is the maximum number of messages waiting while the connection
+     * to the server is congested, requests in messages above it fail immediately
+     */
+    static const int maxSendBacklog = 1024;
+    /**
+     * @brief congestionCheckIntervalMs is the interval in which a congested connection is checked
+     * to send the waiting messages
+     */
+    static const int congestionCheckIntervalMs = 20;
+}
+
 
 class WebsocketConnection : public QObject, public ObjectWithAttributes {
 
@@ -44,16 +93,52 @@ public:
 
 signals:
     void serverClosed();
-    void askServerMainthread(QString fnName, QCborMap value, std::function<void (QCborMap)> callback);
+    void askServerMainthread(QString fnName, QCborMap value, std::function<void (QCborMap)> callback,
+                             std::function<void (QString)> onError);
     void sendToClientMainthread(QWebSocket* client, const QByteArray& data);
     void connectedToServer();
 
 public slots:
+    // the following methods can be called from any thread, they are forwarded to the main thread:
     void tellServer(QString contentType, QCborMap value);
     void askServer(QString fnName, QCborMap value, std::function<void (QCborMap)> callback);
+
+    /**
+     * @brief askServerWithDeadline sends a request to the server
+     * @param fnName request type
+     * @param value request parameters
+     * @param callback called with the response (for each chunk of chunked responses)
+     * @param onError called with "timeout" or "disconnected" if no response arrived in time
+     * @param timeoutMs time to wait for the (next part of the) response
+     * @param batched true to send it together with other requests of this event loop iteration
+     */
+    void askServerWithDeadline(QString fnName, QCborMap value, std::function<void (QCborMap)> callback,
+                               std::function<void (QString)> onError,
+                               int timeoutMs = WebsocketConnectionConstants::defaultTimeoutMs, bool batched = false);
+
+    /**
+     * @brief askServerBatched is the same as askServer() but the request is sent together
+     * with all other batched requests of this event loop iteration in a single message
+     */
+    void askServerBatched(QString fnName, QCborMap value, std::function<void (QCborMap)> callback);
     void registerFunction(const QString& name, std::function<QCborMap(QCborMap)> handler);
     void registerListener(const QString& contentType, std::function<void(QCborMap)> listener);
 
+    /**
+     * @brief broadcast sends a message to all connected clients, it is only encoded once
+     * @param message the message
+     * @param policy what to do if a client can't receive it immediately
+     * @param key identifies messages that replace each other (LatestWins only)
+     */
+    void broadcast(const QCborMap& message, DeliveryPolicy policy = ReliableDelivery, const QString& key = QString());
+
+    /**
+     * @brief isClientBusy returns true if messages to a client are queued because it is slow
+     * @param client the client
+     * @return true if busy
+     */
+    bool isClientBusy(QWebSocket* client) const { return m_broadcaster->isBusy(client); }
+
     QObject* serverEnabled() { return &m_serverEnabled; }
     QObject* clientEnabled() { return &m_clientEnabled; }
 
@@ -62,8 +147,17 @@ public slots:
     QObject* dynv6Hostname() { return &m_dynv6Hostname; }
     QObject* dynv6Token() { return &m_dynv6Token; }
     QObject* isConnectedToServer() { return &m_connectedToServer; }
+    QObject* roundTripTime() { return &m_roundTripTime; }
+    QObject* pendingRequestCount() { return &m_pendingRequestCount; }
     QList<QWebSocket*>& clients() { return m_clients; }
 
+    /**
+     * @brief isCached returns true if the image provider has an image in its memory cache
+     * @param id of the image
+     * @param requestedSize the size as requested from the image provider, QML images request
+     * their sourceSize multiplied by the device pixel ratio
+     * @return true if a request with these arguments is answered from the cache
+     */
     bool isCached(const QString& id, const QSize& requestedSize=QSize()) const;
 
 private slots:
@@ -80,8 +174,60 @@ private slots:
     void processBinaryMessageFromServer(QByteArray data);
 
     void handleSendToClientMainthread(QWebSocket* client, const QByteArray& data);
+    /**
+     * @brief handleFileResponseMainthread sends a response of the file server,
+     * it is queued without the limits of other messages
+     */
+    void handleFileResponseMainthread(QWebSocket* client, const QByteArray& data);
+
+    void flushRequestBatch();
+    void checkRequestDeadlines();
+
+    /**
+     * @brief flushSendBacklog sends the messages that waited for the congestion to end
+     */
+    void flushSendBacklog();
 
 private:
+    /**
+     * @brief The PendingRequest struct contains a request sent to the server waiting for its response.
+     */
+    struct PendingRequest {
+        std::function<void(QCborMap)> callback;
+        std::function<void(QString)> onError;
+        qint64 sentTime;
+        qint64 deadline;
+        int timeoutMs;
+        bool answered;
+    };
+
+    /**
+     * @brief The OutgoingMessage struct contains an encoded message to the server
+     * and the ids of the requests in it.
+     */
+    struct OutgoingMessage {
+        QByteArray data;
+        QVector<qint64> packetIds;
+    };
+
+    void handleRequestFromClient(QWebSocket* client, const QCborMap& message, QCborArray* batchResponses);
+    void sendResponseToClient(QWebSocket* client, const QCborMap& response, bool compressionAllowed);
+    void handleMessageFromServer(const QCborMap& message);
+    /**
+     * @brief sendToServer sends a message or keeps it in the backlog while the connection is congested,
+     * the requests in it fail immediately if it can't be sent
+     * @param message the message
+     */
+    void sendToServer(const QCborMap& message);
+    void writeToServer(const OutgoingMessage& message);
+    void failPendingRequests(const QString& error);
+    /**
+     * @brief failRequests removes pending requests and calls their error handlers in the next event loop iteration
+     * @param packetIds ids of the requests
+     * @param error the error message
+     */
+    void failRequests(const QVector<qint64>& packetIds, const QString& error);
+
     CoreController* const m_controller;
     AsyncImageProvider* m_imageProvider;
     bool m_initialized;
@@ -98,11 +244,33 @@ private:
 
     QWebSocketServer* m_websocketServer;
     QList<QWebSocket*> m_clients;
+    WebsocketBroadcaster* m_broadcaster;
+    WebsocketFileServer* m_fileServer;
+    NodeDataStreamer* m_nodeDataStreamer;
 
     AsyncWebSocket m_asyncWebsocketClient;
-    QMap<QString, std::function<void(QCborMap)>> m_packetCallbacks;
     BoolAttribute m_connectedToServer;
 
+    /**
+     * @brief m_pendingRequests contains the requests waiting for a response by packet id
+     */
+    QHash<qint64, PendingRequest> m_pendingRequests;
+    qint64 m_nextPacketId;
+    QCborArray m_requestBatch;
+    QTimer m_batchTimer;
+    QTimer m_deadlineTimer;
+    /**
+     * @brief m_sendBacklog contains the messages waiting while the connection to the server is congested
+     */
+    QVector<OutgoingMessage> m_sendBacklog;
+    QTimer m_congestionTimer;
+    QElapsedTimer m_requestClock;
+    /**
+     * @brief m_roundTripTime is the moving average of the time until the first response to a request in ms
+     */
+    DoubleAttribute m_roundTripTime;
+    IntegerAttribute m_pendingRequestCount;
+
     QMap<QString, std::function<QCborMap(QCborMap)>> m_requestHandlers;
     QMap<QString, QVector<std::function<void(QCborMap)>>> m_requestListeners;
 };
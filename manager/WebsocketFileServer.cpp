@@ -0,0 +1,370 @@
+#include "WebsocketFileServer.h"
+
+#include "core/CoreController.h"
+#include "core/manager/FileSystemManager.h"
+#include "core/helpers/MappedFile.h"
+
+#include <QWebSocket>
+#include <QRunnable>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QBuffer>
+#include <QImageReader>
+#include <QCborStreamWriter>
+
+#include <limits>
+#include <functional>
+#include <algorithm>
+
+#include <QDebug>
+
+
+// create a shorter alias for the constants namespace:
+namespace WFSC = WebsocketFileServerConstants;
+
+
+namespace {
+
+QByteArray loadScaledImage(QString path, int maxWidth, int maxHeight) {
+    if (maxWidth <= 0 || maxHeight <= 0) {
+        // max size is not set,
+        // the original image should be used:
+        return QByteArray();
+    }
+    QImageReader imageReader(path);
+    imageReader.setAutoTransform(true);
+    QSize imageSize = imageReader.size();
+    bool rotated = imageReader.transformation().testFlag(QImageIOHandler::TransformationRotate90)
+            || imageReader.transformation().testFlag(QImageIOHandler::TransformationRotate270);
+    if (rotated) imageSize.transpose();
+    double viewportRatio = double(maxWidth) / maxHeight;
+    double imageRatio = double(imageSize.width()) / imageSize.height();
+    double scaleRatio = 1.0;
+    if (viewportRatio < imageRatio) {
+        // limit is width
+        scaleRatio = maxWidth / double(imageSize.width());
+    } else {
+        // limit is height
+        scaleRatio = maxHeight / double(imageSize.height());
+    }
+    if (scaleRatio >= 1.0) {
+        // max width and height is larger than image,
+        // the full, original image should be used:
+        return QByteArray();
+    }
+    // max size is smaller than image
+    // -> only return required size and compress it:
+    QSize newSize(int(imageSize.width() * scaleRatio), int(imageSize.height() * scaleRatio));
+    if (rotated) newSize.transpose();
+    // using setScaledSize avoids loading the whole image first
+    imageReader.setScaledSize(newSize);
+    QImage image = imageReader.read();
+    QByteArray content;
+    QBuffer buffer(&content);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "JPG", 75);
+    return content;
+}
+
+/**
+ * @brief The FileServerWorker class pulls jobs from the queue of a WebsocketFileServer until it is empty.
+ */
+class FileServerWorker : public QRunnable {
+public:
+    explicit FileServerWorker(std::function<bool()> processNextJob)
+        : m_processNextJob(processNextJob)
+    {}
+
+    void run() override {
+        while (m_processNextJob()) {}
+    }
+
+protected:
+    std::function<bool()> m_processNextJob;
+};
+
+}  // namespace
+
+
+WebsocketFileServer::WebsocketFileServer(CoreController* controller, QObject* parent)
+    : QObject(parent)
+    , m_controller(controller)
+    , m_nextSequenceNumber(0)
+    , m_activeWorkers(0)
+    , m_scaledImageCache(controller->dao()->getDataDir("cache/scaled_images"))
+{
+    m_threadPool.setMaxThreadCount(WFSC::workerCount);
+}
+
+WebsocketFileServer::~WebsocketFileServer() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queuedJobs.clear();
+        m_queueOrder.clear();
+        m_transfers.clear();
+        for (Job& job: m_runningJobs) {
+            job.waiters.clear();
+        }
+    }
+    m_threadPool.waitForDone();
+}
+
+void WebsocketFileServer::enqueue(QWebSocket* client, const QCborMap& request) {
+    const QString path = request.value(QLatin1String("path")).toString();
+    const int maxWidth = qMax(0, int(request.value(QLatin1String("width")).toInteger()));
+    const int maxHeight = qMax(0, int(request.value(QLatin1String("height")).toInteger()));
+    const QString key = path + "|" + QString::number(maxWidth) + "|" + QString::number(maxHeight);
+    const Waiter waiter {client, request};
+
+    QVector<Waiter> droppedWaiters;
+    QMutexLocker locker(&m_mutex);
+
+    // coalesce identical requests:
+    auto running = m_runningJobs.find(key);
+    if (running != m_runningJobs.end()) {
+        running->waiters.append(waiter);
+        return;
+    }
+    auto queued = m_queuedJobs.find(key);
+    if (queued != m_queuedJobs.end()) {
+        queued->waiters.append(waiter);
+        return;
+    }
+
+    // smaller images (i.e. thumbnails) are served first,
+    // requests without a size are the most expensive ones:
+    qint64 priority = std::numeric_limits<qint64>::max();
+    if (maxWidth > 0 && maxHeight > 0) {
+        priority = qint64(maxWidth) * maxHeight;
+    }
+    Job job {path, maxWidth, maxHeight, qMakePair(priority, m_nextSequenceNumber++), {waiter}};
+    m_queuedJobs.insert(key, job);
+    m_queueOrder.insert(job.order, key);
+
+    if (m_queuedJobs.size() > WFSC::maxQueuedJobs) {
+        auto lowestPriority = std::prev(m_queueOrder.end());
+        const Job droppedJob = m_queuedJobs.take(lowestPriority.value());
+        qWarning() << "File request queue is full, dropping request for" << droppedJob.path;
+        m_queueOrder.erase(lowestPriority);
+        droppedWaiters = droppedJob.waiters;
+    }
+
+    startWorkerIfNeededUnlocked();
+    locker.unlock();
+
+    // the clients of the dropped job get an error instead of waiting forever:
+    for (const Waiter& droppedWaiter: droppedWaiters) {
+        emit responseReady(droppedWaiter.client, encodeErrorResponse(droppedWaiter.request, "queue full"));
+    }
+}
+
+void WebsocketFileServer::cancelRequestsOf(QWebSocket* client) {
+    auto isFromClient = [client](const Waiter& waiter) { return waiter.client == client; };
+
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_queuedJobs.begin(); it != m_queuedJobs.end();) {
+        QVector<Waiter>& waiters = it->waiters;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(), isFromClient), waiters.end());
+        if (waiters.isEmpty()) {
+            m_queueOrder.remove(it->order);
+            it = m_queuedJobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // running jobs are finished anyway, but the result is not sent to this client:
+    for (Job& job: m_runningJobs) {
+        job.waiters.erase(std::remove_if(job.waiters.begin(), job.waiters.end(), isFromClient), job.waiters.end());
+    }
+    for (auto it = m_transfers.begin(); it != m_transfers.end();) {
+        if (it.key().first == client) {
+            it = m_transfers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WebsocketFileServer::acknowledgeChunk(QWebSocket* client, const QCborValue& packetId) {
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_transfers.find(qMakePair(client, packetId.toCbor()));
+        if (it == m_transfers.end()) return;
+        it->credits = qMin(it->credits + 1, WFSC::maxChunkWindow);
+    }
+    sendChunks();
+}
+
+void WebsocketFileServer::sendChunks() {
+    QVector<QPair<QWebSocket*, QByteArray>> messages;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_transfers.begin(); it != m_transfers.end();) {
+            Transfer& transfer = it.value();
+            const qint64 totalSize = transfer.content.size();
+            bool finished = false;
+            while (transfer.credits > 0 && !finished) {
+                const qint64 length = qMin<qint64>(WFSC::chunkSize, totalSize - transfer.offset);
+                finished = transfer.offset + length >= totalSize;
+                messages.append(qMakePair(it.key().first,
+                                          encodeChunk(transfer.packetId, transfer.content.constData() + transfer.offset,
+                                                      transfer.offset, length, totalSize, finished)));
+                transfer.offset += length;
+                --transfer.credits;
+            }
+            if (finished) {
+                it = m_transfers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (const auto& message: messages) {
+        emit responseReady(message.first, message.second);
+    }
+}
+
+bool WebsocketFileServer::processNextJob() {
+    QString key;
+    Job job;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_queueOrder.isEmpty()) {
+            // the worker stops, this has to happen while the mutex is locked
+            // to not miss jobs that are enqueued in the meantime:
+            --m_activeWorkers;
+            return false;
+        }
+        key = m_queueOrder.take(m_queueOrder.firstKey());
+        job = m_queuedJobs.take(key);
+        m_runningJobs.insert(key, job);
+    }
+
+    QByteArray scaledImage;
+    QSharedPointer<const MappedFile> file;
+    if (!QDir().exists(job.path)) {
+        qWarning() << "File " + job.path + " does not exist.";
+    } else {
+        const QString lowerPath = job.path.toLower();
+        if (lowerPath.endsWith(".jpg") || lowerPath.endsWith(".jpeg")) {
+            const QDateTime lastModified = QFileInfo(job.path).lastModified();
+            scaledImage = m_scaledImageCache.get(job.path, lastModified, job.maxWidth, job.maxHeight);
+            if (scaledImage.isEmpty()) {
+                scaledImage = loadScaledImage(job.path, job.maxWidth, job.maxHeight);
+                m_scaledImageCache.insert(job.path, lastModified, job.maxWidth, job.maxHeight, scaledImage);
+            }
+        }
+        if (scaledImage.isEmpty()) {
+            // the original file is sent directly from the mapped memory:
+            file = m_controller->dao()->mapLocalFile(job.path);
+        }
+    }
+
+    QByteArray content;
+    if (!scaledImage.isEmpty()) {
+        content = scaledImage;
+    } else if (file && file->isValid()) {
+        // uses the mapped memory without copying it:
+        content = file->bytes();
+    }
+
+    // waiters could have been added or cancelled while the file was loaded,
+    // transfers are created while the mutex is still locked to not miss a cancellation:
+    QVector<Waiter> waiters;
+    QVector<Waiter> failedWaiters;
+    bool transfersAdded = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        waiters = m_runningJobs.take(key).waiters;
+        if (content.isNull()) {
+            waiters.swap(failedWaiters);
+        }
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            if (!it->request.value(QLatin1String("chunked")).toBool()) {
+                ++it;
+                continue;
+            }
+            const QCborValue packetId = it->request.value(QLatin1String("packetId"));
+            const int window = int(it->request.value(QLatin1String("window")).toInteger(WFSC::defaultChunkWindow));
+            Transfer transfer {packetId, content, file, 0, qBound(1, window, WFSC::maxChunkWindow)};
+            m_transfers.insert(qMakePair(it->client, packetId.toCbor()), transfer);
+            transfersAdded = true;
+            it = waiters.erase(it);
+        }
+    }
+
+    for (const Waiter& waiter: failedWaiters) {
+        emit responseReady(waiter.client, encodeErrorResponse(waiter.request, "not found"));
+    }
+    // the remaining waiters get the whole file in a single message:
+    for (const Waiter& waiter: waiters) {
+        emit responseReady(waiter.client, encodeResponse(waiter.request, content.constData(), content.size()));
+    }
+    if (transfersAdded) {
+        QMetaObject::invokeMethod(this, &WebsocketFileServer::sendChunks, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void WebsocketFileServer::startWorkerIfNeededUnlocked() {
+    if (m_queueOrder.isEmpty() || m_activeWorkers >= WFSC::workerCount) return;
+    ++m_activeWorkers;
+#ifdef THREADS_ENABLED
+    m_threadPool.start(new FileServerWorker([this]() { return processNextJob(); }));
+#else
+    QTimer::singleShot(0, this, &WebsocketFileServer::processJobsInEventLoop);
+#endif
+}
+
+void WebsocketFileServer::processJobsInEventLoop() {
+    if (processNextJob()) {
+        QTimer::singleShot(0, this, &WebsocketFileServer::processJobsInEventLoop);
+    }
+}
+
+QByteArray WebsocketFileServer::encodeResponse(const QCborMap& request, const char* content, qint64 contentSize) {
+    // the content is written directly to the response instead of
+    // copying it to a QCborMap first:
+    QByteArray response;
+    response.reserve(int(qMin<qint64>(contentSize + 256, std::numeric_limits<int>::max())));
+    QCborStreamWriter writer(&response);
+    writer.startMap();
+    for (auto it = request.constBegin(); it != request.constEnd(); ++it) {
+        if (it.key() == QLatin1String("content")) continue;
+        it.key().toCbor(writer);
+        it.value().toCbor(writer);
+    }
+    writer.append(QLatin1String("content"));
+    writer.appendByteString(content, contentSize);
+    writer.endMap();
+    return response;
+}
+
+QByteArray WebsocketFileServer::encodeErrorResponse(const QCborMap& request, const QString& error) {
+    QCborMap response = request;
+    response[QLatin1String("content")] = QByteArray();
+    response[QLatin1String("error")] = error;
+    return response.toCborValue().toCbor();
+}
+
+QByteArray WebsocketFileServer::encodeChunk(const QCborValue& packetId, const char* data, qint64 offset, qint64 length, qint64 totalSize, bool final) {
+    QByteArray message;
+    message.reserve(int(length) + 128);
+    QCborStreamWriter writer(&message);
+    writer.startMap(5);
+    writer.append(QLatin1String("packetId"));
+    packetId.toCbor(writer);
+    writer.append(QLatin1String("offset"));
+    writer.append(offset);
+    writer.append(QLatin1String("size"));
+    writer.append(totalSize);
+    writer.append(QLatin1String("final"));
+    writer.append(final);
+    writer.append(QLatin1String("chunk"));
+    writer.appendByteString(data, length);
+    writer.endMap();
+    return message;
+}
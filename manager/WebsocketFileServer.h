@@ -0,0 +1,263 @@
+#ifndef WEBSOCKETFILESERVER_H
+#define WEBSOCKETFILESERVER_H
+
+#include "core/helpers/ScaledImageCache.h"
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QCborMap>
+#include <QCborValue>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QMutex>
+#include <QThreadPool>
+#include <QByteArray>
+
+// forward declaration to prevent dependency loop
+class CoreController;
+class QWebSocket;
+class MappedFile;
+
+
+/**
+ * @brief The WebsocketFileServerConstants namespace contains all constants used in WebsocketFileServer.
+ */
+namespace WebsocketFileServerConstants {
+    /**
+     * @brief workerCount is the number of threads loading and encoding files
+     */
+    static const int workerCount = 2;
+    /**
+     * @brief maxQueuedJobs is the maximum number of different files waiting to be processed,
+     * the jobs with the lowest priority are dropped if more are requested
+     */
+    static const int maxQueuedJobs = 256;
+    /**
+     * @brief chunkSize is the maximum size of the content of a single message of a chunked transfer
+     */
+    static const int chunkSize = 256 * 1024;
+    /**
+     * @brief defaultChunkWindow is the number of chunks sent without waiting for an acknowledgement
+     * if the client doesn't specify it
+     */
+    static const int defaultChunkWindow = 4;
+    /**
+     * @brief maxChunkWindow is the maximum number of unacknowledged chunks per transfer
+     */
+    static const int maxChunkWindow = 32;
+}
+
+/**
+ * @brief The WebsocketFileServer class answers file requests of websocket clients.
+ *
+ * Requests are queued and processed by a small pool of worker threads that pull the job
+ * with the highest priority from the queue, small images (i.e. thumbnails) are served first.
+ * Identical requests (same path and size) are coalesced into a single job,
+ * requests of a client that disconnected are cancelled.
+ *
+ * If a request contains "chunked": true, the content is sent in multiple messages
+ * containing "packetId", "offset", "size" (of the whole content), "final" and "chunk".
+ * Only "window" (from the request) unacknowledged chunks are sent at a time, the client
+ * acknowledges each non-final chunk with a WsRequestTypes::FILE_ACK message.
+ * The chunks are read directly from the mapped file.
+ */
+class WebsocketFileServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief WebsocketFileServer creates a file server with an empty queue
+     * @param controller a pointer to the CoreController
+     * @param parent QObject parent
+     */
+    explicit WebsocketFileServer(CoreController* controller, QObject* parent = nullptr);
+    /**
+     * @brief ~WebsocketFileServer cancels all queued jobs and waits for the running ones
+     */
+    ~WebsocketFileServer() override;
+
+    /**
+     * @brief enqueue adds a file request to the queue
+     * @param client the client that sent the request
+     * @param request the request containing "path" and optionally "width" and "height",
+     * the response is the same map with an additional entry "content"
+     */
+    void enqueue(QWebSocket* client, const QCborMap& request);
+
+    /**
+     * @brief cancelRequestsOf removes all requests of a client from the queue,
+     * results of running jobs for this client are discarded
+     * @param client the client, i.e. because it disconnected
+     */
+    void cancelRequestsOf(QWebSocket* client);
+
+    /**
+     * @brief acknowledgeChunk allows a chunked transfer to send another chunk
+     * @param client the client that received the chunk
+     * @param packetId the packet id of the original request
+     */
+    void acknowledgeChunk(QWebSocket* client, const QCborValue& packetId);
+
+signals:
+    /**
+     * @brief responseReady is emitted when a response is ready to be sent (usually in a worker thread)
+     * @param client the client that requested the file
+     * @param data the encoded response
+     */
+    void responseReady(QWebSocket* client, const QByteArray& data);
+
+protected:
+    /**
+     * @brief The Waiter struct is a single request waiting for the result of a job.
+     */
+    struct Waiter {
+        QWebSocket* client;
+        QCborMap request;
+    };
+
+    /**
+     * @brief The Job struct contains the requests for the same path and size.
+     */
+    struct Job {
+        QString path;
+        int maxWidth;
+        int maxHeight;
+        /**
+         * @brief order is the key of this job in m_queueOrder (priority and sequence number)
+         */
+        QPair<qint64, quint64> order;
+        QVector<Waiter> waiters;
+    };
+
+    /**
+     * @brief The Transfer struct contains the state of a chunked transfer.
+     */
+    struct Transfer {
+        QCborValue packetId;
+        /**
+         * @brief content may point to the memory of file, which is kept alive by this struct
+         */
+        QByteArray content;
+        QSharedPointer<const MappedFile> file;
+        qint64 offset;
+        /**
+         * @brief credits is the number of chunks that can be sent without an acknowledgement
+         */
+        int credits;
+    };
+
+    /**
+     * @brief sendChunks sends the next chunks of all transfers that have credits left
+     * (called in the main thread)
+     */
+    void sendChunks();
+
+    /**
+     * @brief encodeChunk creates a message of a chunked transfer
+     * @param packetId the packet id of the original request
+     * @param data pointer to the first byte of the chunk
+     * @param offset of the chunk in the whole content
+     * @param length of the chunk in bytes
+     * @param totalSize size of the whole content
+     * @param final true if this is the last chunk
+     * @return the encoded message
+     */
+    static QByteArray encodeChunk(const QCborValue& packetId, const char* data, qint64 offset, qint64 length, qint64 totalSize, bool final);
+
+    /**
+     * @brief processNextJob takes the job with the highest priority from the queue
+     * and processes it (called by the workers)
+     * @return false if the queue was empty
+     */
+    bool processNextJob();
+
+    /**
+     * @brief startWorkerIfNeededUnlocked starts another worker if there are queued jobs
+     * and not all workers are busy (m_mutex has to be locked)
+     */
+    void startWorkerIfNeededUnlocked();
+
+    /**
+     * @brief processJobsInEventLoop processes one job per event loop iteration
+     * in the main thread (used if threads are not available)
+     */
+    void processJobsInEventLoop();
+
+    /**
+     * @brief encodeResponse creates the response to a request, the content is written
+     * directly to the encoded response without copying it to a QCborMap first
+     * @param request the original request
+     * @param content pointer to the content of the file
+     * @param contentSize size of the content in bytes
+     * @return the encoded response
+     */
+    static QByteArray encodeResponse(const QCborMap& request, const char* content, qint64 contentSize);
+
+    /**
+     * @brief encodeErrorResponse creates a response with empty content and an "error" entry
+     * to resolve a request that can't be served
+     * @param request the original request
+     * @param error reason, i.e. "queue full"
+     * @return the encoded response
+     */
+    static QByteArray encodeErrorResponse(const QCborMap& request, const QString& error);
+
+    /**
+     * @brief m_controller a pointer to the CoreController
+     */
+    CoreController* const m_controller;
+
+    /**
+     * @brief m_mutex protects all members below
+     */
+    QMutex m_mutex;
+
+    /**
+     * @brief m_queuedJobs contains the jobs waiting to be processed by "path|width|height"
+     */
+    QHash<QString, Job> m_queuedJobs;
+
+    /**
+     * @brief m_queueOrder sorts the keys of the queued jobs by priority
+     * (smaller requested images first) and then by the order of arrival
+     */
+    QMap<QPair<qint64, quint64>, QString> m_queueOrder;
+
+    /**
+     * @brief m_runningJobs contains the jobs that are currently processed by "path|width|height",
+     * new identical requests are added to their waiters
+     */
+    QHash<QString, Job> m_runningJobs;
+
+    /**
+     * @brief m_transfers contains the running chunked transfers by client and encoded packet id
+     * (the packet id can be a string or an integer)
+     */
+    QHash<QPair<QWebSocket*, QByteArray>, Transfer> m_transfers;
+
+    /**
+     * @brief m_nextSequenceNumber is used to keep the order of arrival for equal priorities
+     */
+    quint64 m_nextSequenceNumber;
+
+    /**
+     * @brief m_activeWorkers is the number of workers currently pulling jobs
+     */
+    int m_activeWorkers;
+
+    /**
+     * @brief m_scaledImageCache contains the already scaled images to not decode and encode
+     * them again when they are requested repeatedly (thread-safe itself)
+     */
+    ScaledImageCache m_scaledImageCache;
+
+    /**
+     * @brief m_threadPool contains the worker threads (separate from the global pool)
+     */
+    QThreadPool m_threadPool;
+};
+
+#endif // WEBSOCKETFILESERVER_H
@@ -0,0 +1,113 @@
+#include "BlockOverviewItem.h"
+
+#include <QSGNode>
+#include <QSGFlatColorMaterial>
+#include <QSGVertexColorMaterial>
+
+
+BlockOverviewItem::BlockOverviewItem(QQuickItem* parent)
+    : QQuickItem(parent)
+    , m_lineColor(255, 255, 255, 100)
+{
+    setFlag(ItemHasContents, true);
+}
+
+BlockOverviewItem::~BlockOverviewItem() {
+}
+
+void BlockOverviewItem::setContent(const QVector<QRectF>& rects, const QVector<QColor>& colors, const QVector<QLineF>& lines) {
+    m_rects = rects;
+    m_colors = colors;
+    m_lines = lines;
+    update();
+}
+
+void BlockOverviewItem::setLineColor(const QColor& color) {
+    if (m_lineColor == color) return;
+
+    m_lineColor = color;
+    emit lineColorChanged(color);
+    update();
+}
+
+QSGNode* BlockOverviewItem::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData*) {
+    if (!isVisible()) return oldNode;
+
+    // -------------------- Prepare QSG Nodes:
+    QSGNode* parentNode = nullptr;
+    if (oldNode) {
+        parentNode = static_cast<QSGNode*>(oldNode);
+    } else {
+        parentNode = new QSGNode;
+    }
+    // first child draws the lines, second one the rectangles above them:
+    if (parentNode->childCount() != 2) {
+        parentNode->removeAllChildNodes();
+
+        QSGGeometryNode* lineNode = new QSGGeometryNode;
+        QSGGeometry* lineGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        lineGeometry->setDrawingMode(QSGGeometry::DrawLines);
+        lineNode->setGeometry(lineGeometry);
+        lineNode->setFlag(QSGNode::OwnsGeometry);
+        lineNode->setMaterial(new QSGFlatColorMaterial);
+        lineNode->setFlag(QSGNode::OwnsMaterial);
+        parentNode->appendChildNode(lineNode);
+
+        QSGGeometryNode* rectNode = new QSGGeometryNode;
+        QSGGeometry* rectGeometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        rectGeometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        rectNode->setGeometry(rectGeometry);
+        rectNode->setFlag(QSGNode::OwnsGeometry);
+        rectNode->setMaterial(new QSGVertexColorMaterial);
+        rectNode->setFlag(QSGNode::OwnsMaterial);
+        parentNode->appendChildNode(rectNode);
+    }
+
+    QSGGeometryNode* const lineNode = static_cast<QSGGeometryNode*>(parentNode->childAtIndex(0));
+    QSGGeometryNode* const rectNode = static_cast<QSGGeometryNode*>(parentNode->childAtIndex(1));
+    if (!lineNode || !rectNode) {
+        qCritical() << "[BlockOverviewItem] Could not get QSG Nodes.";
+        return nullptr;
+    }
+
+    // -------------------- Lines:
+    static_cast<QSGFlatColorMaterial*>(lineNode->material())->setColor(m_lineColor);
+    QSGGeometry* const lineGeometry = lineNode->geometry();
+    lineGeometry->allocate(m_lines.size() * 2);
+    QSGGeometry::Point2D* const lineVertices = lineGeometry->vertexDataAsPoint2D();
+    for (int i = 0; i < m_lines.size(); ++i) {
+        const QLineF& line = m_lines[i];
+        lineVertices[i*2].set(float(line.x1()), float(line.y1()));
+        lineVertices[i*2+1].set(float(line.x2()), float(line.y2()));
+    }
+    lineNode->markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+
+    // -------------------- Rectangles:
+    const int rectCount = std::min(m_rects.size(), m_colors.size());
+    QSGGeometry* const rectGeometry = rectNode->geometry();
+    rectGeometry->allocate(rectCount * 6);
+    QSGGeometry::ColoredPoint2D* const rectVertices = rectGeometry->vertexDataAsColoredPoint2D();
+    for (int i = 0; i < rectCount; ++i) {
+        const QRectF& rect = m_rects[i];
+        const QColor& color = m_colors[i];
+        const uchar r = uchar(color.red());
+        const uchar g = uchar(color.green());
+        const uchar b = uchar(color.blue());
+        const uchar a = uchar(color.alpha());
+        const float left = float(rect.left());
+        const float top = float(rect.top());
+        const float right = float(rect.right());
+        const float bottom = float(rect.bottom());
+        // two triangles per rectangle:
+        QSGGeometry::ColoredPoint2D* v = rectVertices + i * 6;
+        v[0].set(left, top, r, g, b, a);
+        v[1].set(right, top, r, g, b, a);
+        v[2].set(left, bottom, r, g, b, a);
+        v[3].set(right, top, r, g, b, a);
+        v[4].set(right, bottom, r, g, b, a);
+        v[5].set(left, bottom, r, g, b, a);
+    }
+    rectNode->markDirty(QSGNode::DirtyGeometry);
+
+    return parentNode;
+}
@@ -0,0 +1,53 @@
+#ifndef BLOCKOVERVIEWITEM_H
+#define BLOCKOVERVIEWITEM_H
+
+#include <QtQuick/QQuickItem>
+#include <QVector>
+#include <QRectF>
+#include <QLineF>
+#include <QColor>
+
+
+/**
+ * @brief The BlockOverviewItem class draws simplified blocks as colored rectangles
+ * and their connections as straight lines.
+ *
+ * It is used instead of the GUI items of the blocks when the workspace is zoomed out
+ * so far that their details are not recognizable anyway. All rectangles and all lines
+ * are drawn by one geometry node each, independent of the number of blocks.
+ */
+class BlockOverviewItem : public QQuickItem {
+
+    Q_OBJECT
+
+    Q_PROPERTY(QColor lineColor READ lineColor WRITE setLineColor NOTIFY lineColorChanged)
+
+public:
+    explicit BlockOverviewItem(QQuickItem* parent = nullptr);
+    ~BlockOverviewItem();
+
+    QSGNode* updatePaintNode(QSGNode*, UpdatePaintNodeData*);
+
+    /**
+     * @brief setContent replaces the drawn blocks and connections
+     * @param rects bounds of the blocks in the coordinate system of the parent item
+     * @param colors color of each block, same size as rects
+     * @param lines connections between blocks
+     */
+    void setContent(const QVector<QRectF>& rects, const QVector<QColor>& colors, const QVector<QLineF>& lines);
+
+signals:
+    void lineColorChanged(const QColor& color);
+
+public slots:
+    QColor lineColor() const { return m_lineColor; }
+    void setLineColor(const QColor& color);
+
+private:
+    QVector<QRectF> m_rects;
+    QVector<QColor> m_colors;
+    QVector<QLineF> m_lines;
+    QColor m_lineColor;
+};
+
+#endif // BLOCKOVERVIEWITEM_H
@@ -182,6 +182,10 @@ void NodeConnectionLines::setNodeObject(NodeBase* value) {
         qWarning() << "NodeConnectionLines: setNodeObject: received nullptr";
         return;
     }
+    if (m_nodeObject == value) return;
+    // the item can be reused for another node (see GuiItemPool):
+    if (m_nodeObject) disconnect(m_nodeObject, nullptr, this, nullptr);
     m_nodeObject = value;
+    update();
     connect(m_nodeObject, SIGNAL(connectionLinesChanged()), this, SLOT(update()));
 }
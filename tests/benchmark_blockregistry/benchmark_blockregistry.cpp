@@ -0,0 +1,157 @@
+#include "core/helpers/SlotList.h"
+#include "core/helpers/SlabAllocator.h"
+
+#include <QtTest>
+
+
+/**
+ * @brief The BenchmarkBlockRegistry class measures the operations of the block registry
+ * in BlockManager (create, lookup by UID, delete) with plain objects instead of blocks.
+ *
+ * The objects are children of a parent object per benchmark,
+ * so they are deleted on every path, even if a benchmark fails.
+ */
+class BenchmarkBlockRegistry : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void insert_data();
+    void insert();
+    void lookupByUid_data();
+    void lookupByUid();
+    void removeSwap_data();
+    void removeSwap();
+    void removeLinear_data();
+    void removeLinear();
+    void allocateSlab();
+    void allocateHeap();
+
+private:
+    static void addBlockCounts();
+    static QVector<QObject*> createObjects(QObject* parent, int count);
+};
+
+void BenchmarkBlockRegistry::addBlockCounts() {
+    QTest::addColumn<int>("blockCount");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+QVector<QObject*> BenchmarkBlockRegistry::createObjects(QObject* parent, int count) {
+    QVector<QObject*> objects;
+    objects.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        QObject* object = new QObject(parent);
+        object->setObjectName(QString::number(i));
+        objects.append(object);
+    }
+    return objects;
+}
+
+void BenchmarkBlockRegistry::insert_data() {
+    addBlockCounts();
+}
+
+void BenchmarkBlockRegistry::insert() {
+    QFETCH(int, blockCount);
+    QObject parent;
+    const QVector<QObject*> objects = createObjects(&parent, blockCount);
+    QBENCHMARK {
+        SlotList<QObject*> registry;
+        QHash<QString, QObject*> uids;
+        for (QObject* object: objects) {
+            registry.insert(object);
+            uids.insert(object->objectName(), object);
+        }
+    }
+}
+
+void BenchmarkBlockRegistry::lookupByUid_data() {
+    addBlockCounts();
+}
+
+void BenchmarkBlockRegistry::lookupByUid() {
+    QFETCH(int, blockCount);
+    QObject parent;
+    const QVector<QObject*> objects = createObjects(&parent, blockCount);
+    QHash<QString, QObject*> uids;
+    for (QObject* object: objects) {
+        uids.insert(object->objectName(), object);
+    }
+    int foundCount = 0;
+    QBENCHMARK {
+        for (QObject* object: objects) {
+            if (uids.value(object->objectName()) == object) ++foundCount;
+        }
+    }
+    QVERIFY(foundCount >= blockCount);
+}
+
+void BenchmarkBlockRegistry::removeSwap_data() {
+    addBlockCounts();
+}
+
+void BenchmarkBlockRegistry::removeSwap() {
+    QFETCH(int, blockCount);
+    QObject parent;
+    const QVector<QObject*> objects = createObjects(&parent, blockCount);
+    QBENCHMARK {
+        SlotList<QObject*> registry;
+        for (QObject* object: objects) {
+            registry.insert(object);
+        }
+        for (int i = 0; i < objects.size(); i += 2) {
+            registry.remove(objects[i]);
+        }
+    }
+}
+
+void BenchmarkBlockRegistry::removeLinear_data() {
+    addBlockCounts();
+}
+
+void BenchmarkBlockRegistry::removeLinear() {
+    // the registry before SlotList, for comparison:
+    QFETCH(int, blockCount);
+    QObject parent;
+    const QVector<QObject*> objects = createObjects(&parent, blockCount);
+    QBENCHMARK {
+        QVector<QObject*> registry;
+        for (QObject* object: objects) {
+            registry.append(object);
+        }
+        for (int i = 0; i < objects.size(); i += 2) {
+            registry.removeOne(objects[i]);
+        }
+    }
+}
+
+void BenchmarkBlockRegistry::allocateSlab() {
+    SlabAllocator allocator("benchmark");
+    QVector<void*> objects(10000, nullptr);
+    QBENCHMARK {
+        for (void*& ptr: objects) {
+            ptr = allocator.allocate(200);
+        }
+        for (void* ptr: objects) {
+            allocator.deallocate(ptr, 200);
+        }
+    }
+}
+
+void BenchmarkBlockRegistry::allocateHeap() {
+    QVector<void*> objects(10000, nullptr);
+    QBENCHMARK {
+        for (void*& ptr: objects) {
+            ptr = ::operator new(200);
+        }
+        for (void* ptr: objects) {
+            ::operator delete(ptr);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(BenchmarkBlockRegistry)
+
+#include "benchmark_blockregistry.moc"
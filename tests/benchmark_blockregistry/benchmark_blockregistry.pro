@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+# benchmarks are not run by "make check":
+CONFIG -= testcase
+
+TARGET = benchmark_blockregistry
+
+HEADERS += $$CORE_DIR/helpers/SlabAllocator.h
+SOURCES += benchmark_blockregistry.cpp \
+    $$CORE_DIR/helpers/SlabAllocator.cpp
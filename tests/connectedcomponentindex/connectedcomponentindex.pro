@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_connectedcomponentindex
+
+HEADERS += $$CORE_DIR/helpers/ConnectedComponentIndex.h
+SOURCES += tst_connectedcomponentindex.cpp \
+    $$CORE_DIR/helpers/ConnectedComponentIndex.cpp
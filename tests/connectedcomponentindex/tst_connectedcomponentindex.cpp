@@ -0,0 +1,144 @@
+#include "core/helpers/ConnectedComponentIndex.h"
+
+#include <QtTest>
+
+
+/**
+ * @brief The FakeGraph class stores connections between fake block pointers,
+ * the index never dereferences them.
+ */
+class FakeGraph {
+
+public:
+    static BlockInterface* block(int id) { return reinterpret_cast<BlockInterface*>(quintptr(id) * 16); }
+
+    void connect(int a, int b) {
+        m_neighbours[block(a)].append(block(b));
+        m_neighbours[block(b)].append(block(a));
+        index.onConnected(block(a), block(b));
+    }
+
+    void disconnect(int a, int b) {
+        m_neighbours[block(a)].removeOne(block(b));
+        m_neighbours[block(b)].removeOne(block(a));
+        index.onDisconnected(block(a), block(b), [this](BlockInterface* block) {
+            return m_neighbours.value(block);
+        });
+    }
+
+    QSet<int> componentOf(int id) {
+        QSet<int> ids;
+        for (BlockInterface* member: index.componentOf(block(id))) {
+            ids.insert(int(reinterpret_cast<quintptr>(member) / 16));
+        }
+        return ids;
+    }
+
+    ConnectedComponentIndex index;
+
+protected:
+    QHash<BlockInterface*, QVector<BlockInterface*>> m_neighbours;
+};
+
+
+class TestConnectedComponentIndex : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void singleBlock();
+    void connectBlocks();
+    void mergeComponents();
+    void disconnectWithCycle();
+    void disconnectSplits();
+    void disconnectLastConnection();
+    void parallelConnections();
+    void clear();
+};
+
+void TestConnectedComponentIndex::singleBlock() {
+    FakeGraph graph;
+    QCOMPARE(graph.componentOf(1), QSet<int>({1}));
+    QVERIFY(!graph.index.contains(FakeGraph::block(1)));
+}
+
+void TestConnectedComponentIndex::connectBlocks() {
+    FakeGraph graph;
+    graph.connect(1, 2);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1, 2}));
+    QCOMPARE(graph.componentOf(2), QSet<int>({1, 2}));
+    QCOMPARE(graph.index.componentOf(FakeGraph::block(1)).size(), 2);
+}
+
+void TestConnectedComponentIndex::mergeComponents() {
+    FakeGraph graph;
+    graph.connect(1, 2);
+    graph.connect(2, 3);
+    graph.connect(4, 5);
+    QCOMPARE(graph.componentOf(5), QSet<int>({4, 5}));
+    graph.connect(3, 4);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1, 2, 3, 4, 5}));
+    QCOMPARE(graph.index.componentOf(FakeGraph::block(5)).size(), 5);
+}
+
+void TestConnectedComponentIndex::disconnectWithCycle() {
+    FakeGraph graph;
+    graph.connect(1, 2);
+    graph.connect(2, 3);
+    graph.connect(3, 1);
+    graph.disconnect(1, 2);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1, 2, 3}));
+}
+
+void TestConnectedComponentIndex::disconnectSplits() {
+    FakeGraph graph;
+    // 1 - 2 - 3 - 4 - 5 and 3 - 6:
+    graph.connect(1, 2);
+    graph.connect(2, 3);
+    graph.connect(3, 4);
+    graph.connect(4, 5);
+    graph.connect(3, 6);
+    graph.disconnect(3, 4);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1, 2, 3, 6}));
+    QCOMPARE(graph.componentOf(6), QSet<int>({1, 2, 3, 6}));
+    QCOMPARE(graph.componentOf(5), QSet<int>({4, 5}));
+    // the split components can be merged again:
+    graph.connect(6, 5);
+    QCOMPARE(graph.componentOf(4), QSet<int>({1, 2, 3, 4, 5, 6}));
+}
+
+void TestConnectedComponentIndex::disconnectLastConnection() {
+    FakeGraph graph;
+    graph.connect(1, 2);
+    graph.connect(2, 3);
+    graph.disconnect(1, 2);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1}));
+    QVERIFY(!graph.index.contains(FakeGraph::block(1)));
+    QCOMPARE(graph.componentOf(3), QSet<int>({2, 3}));
+    graph.disconnect(2, 3);
+    QVERIFY(!graph.index.contains(FakeGraph::block(2)));
+    QVERIFY(!graph.index.contains(FakeGraph::block(3)));
+}
+
+void TestConnectedComponentIndex::parallelConnections() {
+    FakeGraph graph;
+    // two connections between the same blocks (i.e. between different nodes):
+    graph.connect(1, 2);
+    graph.connect(1, 2);
+    graph.disconnect(1, 2);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1, 2}));
+    graph.disconnect(1, 2);
+    QCOMPARE(graph.componentOf(1), QSet<int>({1}));
+}
+
+void TestConnectedComponentIndex::clear() {
+    FakeGraph graph;
+    graph.connect(1, 2);
+    graph.index.clear();
+    QVERIFY(!graph.index.contains(FakeGraph::block(1)));
+    QCOMPARE(graph.componentOf(2), QSet<int>({2}));
+}
+
+QTEST_APPLESS_MAIN(TestConnectedComponentIndex)
+
+#include "tst_connectedcomponentindex.moc"
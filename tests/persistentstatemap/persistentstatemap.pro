@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_persistentstatemap
+
+HEADERS += $$CORE_DIR/helpers/PersistentStateMap.h
+SOURCES += tst_persistentstatemap.cpp \
+    $$CORE_DIR/helpers/PersistentStateMap.cpp
@@ -0,0 +1,103 @@
+#include "core/helpers/PersistentStateMap.h"
+
+#include <QtTest>
+
+
+class TestPersistentStateMap : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void emptyMap();
+    void insertAndValue();
+    void previousVersionIsUnchanged();
+    void unchangedEntriesAreShared();
+    void remove();
+    void diff();
+
+private:
+    static QHash<QString, QByteArray> entries(int count, const QByteArray& suffix = QByteArray());
+};
+
+QHash<QString, QByteArray> TestPersistentStateMap::entries(int count, const QByteArray& suffix) {
+    QHash<QString, QByteArray> entries;
+    for (int i = 0; i < count; ++i) {
+        entries.insert(QString("block-%1").arg(i), QByteArray::number(i) + suffix);
+    }
+    return entries;
+}
+
+void TestPersistentStateMap::emptyMap() {
+    PersistentStateMap map;
+    QVERIFY(map.isEmpty());
+    QCOMPARE(map.size(), 0);
+    QVERIFY(!map.contains("block-0"));
+    QVERIFY(map.value("block-0").isNull());
+    QVERIFY(map.keys().isEmpty());
+}
+
+void TestPersistentStateMap::insertAndValue() {
+    const PersistentStateMap map = PersistentStateMap().updated(entries(1000), {});
+    QCOMPARE(map.size(), 1000);
+    QCOMPARE(map.keys().size(), 1000);
+    QVERIFY(map.contains("block-0"));
+    QCOMPARE(map.value("block-123"), QByteArray("123"));
+    QVERIFY(!map.contains("block-1000"));
+}
+
+void TestPersistentStateMap::previousVersionIsUnchanged() {
+    const PersistentStateMap first = PersistentStateMap().updated(entries(100), {});
+    const PersistentStateMap second = first.updated({{"block-5", "modified"}, {"block-200", "new"}}, {"block-6"});
+    QCOMPARE(first.size(), 100);
+    QCOMPARE(first.value("block-5"), QByteArray("5"));
+    QVERIFY(first.contains("block-6"));
+    QVERIFY(!first.contains("block-200"));
+    QCOMPARE(second.size(), 100);
+    QCOMPARE(second.value("block-5"), QByteArray("modified"));
+    QVERIFY(!second.contains("block-6"));
+    QCOMPARE(second.value("block-200"), QByteArray("new"));
+}
+
+void TestPersistentStateMap::unchangedEntriesAreShared() {
+    const PersistentStateMap first = PersistentStateMap().updated(entries(1000), {});
+    // updating with equal values doesn't create a new version:
+    const PersistentStateMap same = first.updated(entries(10), {});
+    QVERIFY(same.isIdenticalTo(first));
+
+    const PersistentStateMap second = first.updated({{"block-1", "modified"}}, {});
+    QVERIFY(!second.isIdenticalTo(first));
+    const int firstBucketCount = first.sharedBucketCount(first);
+    // only the bucket with the modified entry is copied:
+    QCOMPARE(second.sharedBucketCount(first), firstBucketCount - 1);
+}
+
+void TestPersistentStateMap::remove() {
+    const PersistentStateMap first = PersistentStateMap().updated(entries(10), {});
+    const PersistentStateMap second = first.updated({}, entries(10).keys());
+    QVERIFY(second.isEmpty());
+    QVERIFY(second.keys().isEmpty());
+    // removing missing keys changes nothing:
+    QVERIFY(first.updated({}, {"block-10"}).isIdenticalTo(first));
+}
+
+void TestPersistentStateMap::diff() {
+    const PersistentStateMap first = PersistentStateMap().updated(entries(500), {});
+    const PersistentStateMap second = first.updated({{"block-1", "modified"}, {"block-600", "new"}}, {"block-2", "block-3"});
+    QStringList changed;
+    QStringList removed;
+    first.diff(second, changed, removed);
+    std::sort(changed.begin(), changed.end());
+    std::sort(removed.begin(), removed.end());
+    QCOMPARE(changed, QStringList({"block-1", "block-600"}));
+    QCOMPARE(removed, QStringList({"block-2", "block-3"}));
+
+    changed.clear();
+    removed.clear();
+    first.diff(first, changed, removed);
+    QVERIFY(changed.isEmpty());
+    QVERIFY(removed.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestPersistentStateMap)
+
+#include "tst_persistentstatemap.moc"
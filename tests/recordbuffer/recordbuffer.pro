@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_recordbuffer
+
+HEADERS += $$CORE_DIR/helpers/RecordBuffer.h
+SOURCES += tst_recordbuffer.cpp \
+    $$CORE_DIR/helpers/RecordBuffer.cpp
@@ -0,0 +1,116 @@
+#include "core/helpers/RecordBuffer.h"
+
+#include <QtTest>
+
+
+class TestRecordBuffer : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void encode();
+    void roundTrip();
+    void emptyPayload();
+    void byteByByte();
+    void multipleRecords();
+    void corruptChecksum();
+    void payloadTooLarge();
+    void compactsConsumedBytes();
+};
+
+void TestRecordBuffer::encode() {
+    const QByteArray record = RecordBuffer::encode(3, "abc");
+    QCOMPARE(record.size(), RecordBuffer::headerSize + 3);
+    QCOMPARE(quint8(record.at(0)), quint8(3));
+    // the payload size is big endian:
+    QCOMPARE(record.mid(1, 4), QByteArray::fromHex("00000003"));
+    QCOMPARE(record.mid(RecordBuffer::headerSize), QByteArray("abc"));
+}
+
+void TestRecordBuffer::roundTrip() {
+    RecordBuffer buffer;
+    buffer.append(RecordBuffer::encode(5, "payload"));
+    quint8 type = 0;
+    QByteArray payload;
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(type, quint8(5));
+    QCOMPARE(payload, QByteArray("payload"));
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Incomplete);
+    QCOMPARE(buffer.bufferedBytes(), 0);
+}
+
+void TestRecordBuffer::emptyPayload() {
+    RecordBuffer buffer;
+    buffer.append(RecordBuffer::encode(1));
+    quint8 type = 0;
+    QByteArray payload = "old";
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(type, quint8(1));
+    QVERIFY(payload.isEmpty());
+}
+
+void TestRecordBuffer::byteByByte() {
+    const QByteArray record = RecordBuffer::encode(2, QByteArray(100, 'x'));
+    RecordBuffer buffer;
+    quint8 type = 0;
+    QByteArray payload;
+    for (int i = 0; i < record.size() - 1; ++i) {
+        buffer.append(record.mid(i, 1));
+        QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Incomplete);
+    }
+    buffer.append(record.right(1));
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(payload, QByteArray(100, 'x'));
+}
+
+void TestRecordBuffer::multipleRecords() {
+    RecordBuffer buffer;
+    buffer.append(RecordBuffer::encode(1, "first") + RecordBuffer::encode(2) + RecordBuffer::encode(3, "third").left(4));
+    quint8 type = 0;
+    QByteArray payload;
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(payload, QByteArray("first"));
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(type, quint8(2));
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Incomplete);
+    buffer.append(RecordBuffer::encode(3, "third").mid(4));
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Complete);
+    QCOMPARE(type, quint8(3));
+    QCOMPARE(payload, QByteArray("third"));
+}
+
+void TestRecordBuffer::corruptChecksum() {
+    QByteArray record = RecordBuffer::encode(4, "payload");
+    record[RecordBuffer::headerSize] = 'P';
+    RecordBuffer buffer;
+    buffer.append(record);
+    quint8 type = 0;
+    QByteArray payload;
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Corrupt);
+}
+
+void TestRecordBuffer::payloadTooLarge() {
+    RecordBuffer buffer;
+    // only the header is needed to detect it:
+    buffer.append(RecordBuffer::encode(4, QByteArray(2000, 'x')).left(RecordBuffer::headerSize));
+    quint8 type = 0;
+    QByteArray payload;
+    QCOMPARE(buffer.take(1024, type, payload), RecordBuffer::Corrupt);
+}
+
+void TestRecordBuffer::compactsConsumedBytes() {
+    RecordBuffer buffer;
+    quint8 type = 0;
+    QByteArray payload;
+    for (int i = 0; i < 1000; ++i) {
+        buffer.append(RecordBuffer::encode(1, QByteArray::number(i)));
+        if (i % 3 == 0) continue;
+        while (buffer.take(1024, type, payload) == RecordBuffer::Complete) {}
+        QCOMPARE(payload, QByteArray::number(i));
+        QCOMPARE(buffer.bufferedBytes(), 0);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestRecordBuffer)
+
+#include "tst_recordbuffer.moc"
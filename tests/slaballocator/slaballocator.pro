@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_slaballocator
+
+HEADERS += $$CORE_DIR/helpers/SlabAllocator.h
+SOURCES += tst_slaballocator.cpp \
+    $$CORE_DIR/helpers/SlabAllocator.cpp
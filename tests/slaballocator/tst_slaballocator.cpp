@@ -0,0 +1,119 @@
+#include "core/helpers/SlabAllocator.h"
+
+#include <QtTest>
+
+#include <cstring>
+
+
+// create a shorter alias for the constants namespace:
+namespace SAC = SlabAllocatorConstants;
+
+
+class TestSlabAllocator : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void allocateAndDeallocate();
+    void reusesFreedChunks();
+    void sizeClassesDontOverlap();
+    void largeObjectsUseHeap();
+    void releaseEmptySlabs();
+    void keepsSlabsWithLiveObjects();
+};
+
+void TestSlabAllocator::allocateAndDeallocate() {
+    SlabAllocator allocator("test");
+    void* ptr = allocator.allocate(100);
+    QVERIFY(ptr);
+    QCOMPARE(quintptr(ptr) % alignof(std::max_align_t), quintptr(0));
+    std::memset(ptr, 0xAB, 100);
+    QVariantMap statistics = allocator.getStatistics();
+    QCOMPARE(statistics["allocations"].toULongLong(), quint64(1));
+    QCOMPARE(statistics["liveObjects"].toULongLong(), quint64(1));
+    QCOMPARE(statistics["slabs"].toInt(), 1);
+    allocator.deallocate(ptr, 100);
+    statistics = allocator.getStatistics();
+    QCOMPARE(statistics["deallocations"].toULongLong(), quint64(1));
+    QCOMPARE(statistics["liveObjects"].toULongLong(), quint64(0));
+}
+
+void TestSlabAllocator::reusesFreedChunks() {
+    SlabAllocator allocator("test");
+    void* first = allocator.allocate(64);
+    allocator.deallocate(first, 64);
+    void* second = allocator.allocate(64);
+    QCOMPARE(second, first);
+    allocator.deallocate(second, 64);
+}
+
+void TestSlabAllocator::sizeClassesDontOverlap() {
+    SlabAllocator allocator("test");
+    QVector<QPair<char*, std::size_t>> objects;
+    for (std::size_t size = 8; size <= SAC::maxObjectSize; size += 24) {
+        for (int i = 0; i < 3; ++i) {
+            char* ptr = static_cast<char*>(allocator.allocate(size));
+            std::memset(ptr, int(objects.size() % 256), size);
+            objects.append({ptr, size});
+        }
+    }
+    // each object still contains its own pattern:
+    for (int i = 0; i < objects.size(); ++i) {
+        const char* ptr = objects[i].first;
+        for (std::size_t k = 0; k < objects[i].second; ++k) {
+            if (ptr[k] != char(i % 256)) QFAIL("Objects overlap.");
+        }
+    }
+    for (const auto& object: objects) {
+        allocator.deallocate(object.first, object.second);
+    }
+    QCOMPARE(allocator.getStatistics()["liveObjects"].toULongLong(), quint64(0));
+}
+
+void TestSlabAllocator::largeObjectsUseHeap() {
+    SlabAllocator allocator("test");
+    void* ptr = allocator.allocate(SAC::maxObjectSize + 1);
+    QVERIFY(ptr);
+    QCOMPARE(allocator.getStatistics()["heapAllocations"].toULongLong(), quint64(1));
+    QCOMPARE(allocator.getStatistics()["slabs"].toInt(), 0);
+    allocator.deallocate(ptr, SAC::maxObjectSize + 1);
+}
+
+void TestSlabAllocator::releaseEmptySlabs() {
+    SlabAllocator allocator("test");
+    QVector<void*> objects;
+    // more than fit into one slab:
+    const int count = int(SAC::slabSize / 256) * 3;
+    for (int i = 0; i < count; ++i) {
+        objects.append(allocator.allocate(256));
+    }
+    QVERIFY(allocator.getStatistics()["slabs"].toInt() > 1);
+    for (void* ptr: objects) {
+        allocator.deallocate(ptr, 256);
+    }
+    QVERIFY(allocator.releaseEmptySlabs() > 1);
+    QCOMPARE(allocator.getStatistics()["slabs"].toInt(), 0);
+    // the free list must not contain chunks of released slabs:
+    void* ptr = allocator.allocate(256);
+    std::memset(ptr, 0, 256);
+    QCOMPARE(allocator.getStatistics()["slabs"].toInt(), 1);
+    allocator.deallocate(ptr, 256);
+}
+
+void TestSlabAllocator::keepsSlabsWithLiveObjects() {
+    SlabAllocator allocator("test");
+    void* live = allocator.allocate(32);
+    void* other = allocator.allocate(1024);
+    allocator.deallocate(other, 1024);
+    QCOMPARE(allocator.releaseEmptySlabs(), 1);
+    QCOMPARE(allocator.getStatistics()["slabs"].toInt(), 1);
+    // the remaining slab is still usable:
+    void* next = allocator.allocate(32);
+    QVERIFY(next != live);
+    allocator.deallocate(next, 32);
+    allocator.deallocate(live, 32);
+}
+
+QTEST_APPLESS_MAIN(TestSlabAllocator)
+
+#include "tst_slaballocator.moc"
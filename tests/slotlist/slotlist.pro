@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_slotlist
+
+SOURCES += tst_slotlist.cpp
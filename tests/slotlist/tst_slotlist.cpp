@@ -0,0 +1,93 @@
+#include "core/helpers/SlotList.h"
+
+#include <QtTest>
+
+
+class TestSlotList : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void insertAndContains();
+    void insertExisting();
+    void removeLast();
+    void removeMovesLastItem();
+    void removeMissing();
+    void removeAll();
+    void clear();
+};
+
+void TestSlotList::insertAndContains() {
+    SlotList<int> list;
+    QVERIFY(list.isEmpty());
+    QVERIFY(list.insert(1));
+    QVERIFY(list.insert(2));
+    QVERIFY(list.insert(3));
+    QCOMPARE(list.size(), 3);
+    QVERIFY(list.contains(2));
+    QVERIFY(!list.contains(4));
+    QCOMPARE(list.items(), QVector<int>({1, 2, 3}));
+}
+
+void TestSlotList::insertExisting() {
+    SlotList<int> list;
+    list.insert(1);
+    QVERIFY(!list.insert(1));
+    QCOMPARE(list.size(), 1);
+}
+
+void TestSlotList::removeLast() {
+    SlotList<int> list;
+    list.insert(1);
+    list.insert(2);
+    QVERIFY(list.remove(2));
+    QCOMPARE(list.items(), QVector<int>({1}));
+    QVERIFY(!list.contains(2));
+}
+
+void TestSlotList::removeMovesLastItem() {
+    SlotList<int> list;
+    list.insert(1);
+    list.insert(2);
+    list.insert(3);
+    QVERIFY(list.remove(1));
+    QCOMPARE(list.items(), QVector<int>({3, 2}));
+    // the slot of the moved item has to be updated:
+    QVERIFY(list.remove(3));
+    QCOMPARE(list.items(), QVector<int>({2}));
+    QVERIFY(list.contains(2));
+}
+
+void TestSlotList::removeMissing() {
+    SlotList<int> list;
+    list.insert(1);
+    QVERIFY(!list.remove(2));
+    QCOMPARE(list.size(), 1);
+}
+
+void TestSlotList::removeAll() {
+    SlotList<int> list;
+    for (int i = 0; i < 100; ++i) list.insert(i);
+    for (int i = 0; i < 100; i += 2) QVERIFY(list.remove(i));
+    QCOMPARE(list.size(), 50);
+    for (int item: list) {
+        QVERIFY(item % 2 == 1);
+        QVERIFY(list.contains(item));
+    }
+    for (int i = 1; i < 100; i += 2) QVERIFY(list.remove(i));
+    QVERIFY(list.isEmpty());
+}
+
+void TestSlotList::clear() {
+    SlotList<int> list;
+    list.insert(1);
+    list.insert(2);
+    list.clear();
+    QVERIFY(list.isEmpty());
+    QVERIFY(!list.contains(1));
+    QVERIFY(list.insert(1));
+}
+
+QTEST_APPLESS_MAIN(TestSlotList)
+
+#include "tst_slotlist.moc"
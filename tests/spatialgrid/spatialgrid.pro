@@ -0,0 +1,5 @@
+include(../tests.pri)
+
+TARGET = tst_spatialgrid
+
+SOURCES += tst_spatialgrid.cpp
@@ -0,0 +1,110 @@
+#include "core/helpers/SpatialGrid.h"
+
+#include <QtTest>
+
+
+class TestSpatialGrid : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void insertAndBounds();
+    void updateBounds();
+    void remove();
+    void forEachInReportsOverlappingItems();
+    void forEachInReportsLargeItemsOnce();
+    void forEachInLargeArea();
+    void negativeCoordinates();
+
+private:
+    static QSet<int> itemsIn(const SpatialGrid<int>& grid, const QRectF& area);
+};
+
+QSet<int> TestSpatialGrid::itemsIn(const SpatialGrid<int>& grid, const QRectF& area) {
+    QSet<int> items;
+    grid.forEachIn(area, [&items, &area](int item, const QRectF& bounds) {
+        // the same item must not be reported twice:
+        QVERIFY(!items.contains(item));
+        if (bounds.intersects(area)) items.insert(item);
+    });
+    return items;
+}
+
+void TestSpatialGrid::insertAndBounds() {
+    SpatialGrid<int> grid(100);
+    grid.insert(1, QRectF(10, 10, 50, 50));
+    QVERIFY(grid.contains(1));
+    QVERIFY(!grid.contains(2));
+    QCOMPARE(grid.size(), 1);
+    QCOMPARE(grid.bounds(1), QRectF(10, 10, 50, 50));
+}
+
+void TestSpatialGrid::updateBounds() {
+    SpatialGrid<int> grid(100);
+    grid.insert(1, QRectF(10, 10, 50, 50));
+    grid.insert(1, QRectF(1000, 1000, 50, 50));
+    QCOMPARE(grid.size(), 1);
+    QCOMPARE(grid.bounds(1), QRectF(1000, 1000, 50, 50));
+    QVERIFY(itemsIn(grid, QRectF(0, 0, 100, 100)).isEmpty());
+    QCOMPARE(itemsIn(grid, QRectF(950, 950, 100, 100)), QSet<int>({1}));
+}
+
+void TestSpatialGrid::remove() {
+    SpatialGrid<int> grid(100);
+    grid.insert(1, QRectF(10, 10, 50, 50));
+    grid.insert(2, QRectF(20, 20, 50, 50));
+    grid.remove(1);
+    grid.remove(3);
+    QVERIFY(!grid.contains(1));
+    QCOMPARE(grid.size(), 1);
+    QCOMPARE(itemsIn(grid, QRectF(0, 0, 100, 100)), QSet<int>({2}));
+    grid.clear();
+    QCOMPARE(grid.size(), 0);
+}
+
+void TestSpatialGrid::forEachInReportsOverlappingItems() {
+    SpatialGrid<int> grid(100);
+    for (int x = 0; x < 20; ++x) {
+        for (int y = 0; y < 20; ++y) {
+            grid.insert(x * 20 + y, QRectF(x * 100 + 10, y * 100 + 10, 80, 80));
+        }
+    }
+    const QRectF area(250, 250, 200, 100);
+    QSet<int> expected;
+    for (int x = 0; x < 20; ++x) {
+        for (int y = 0; y < 20; ++y) {
+            if (QRectF(x * 100 + 10, y * 100 + 10, 80, 80).intersects(area)) expected.insert(x * 20 + y);
+        }
+    }
+    QCOMPARE(itemsIn(grid, area), expected);
+}
+
+void TestSpatialGrid::forEachInReportsLargeItemsOnce() {
+    SpatialGrid<int> grid(100);
+    // covers 5 x 5 cells:
+    grid.insert(1, QRectF(0, 0, 450, 450));
+    for (int i = 0; i < 100; ++i) {
+        grid.insert(i + 2, QRectF(i * 100, 2000, 50, 50));
+    }
+    QCOMPARE(itemsIn(grid, QRectF(50, 50, 300, 300)), QSet<int>({1}));
+    QCOMPARE(itemsIn(grid, QRectF(320, 320, 10, 10)), QSet<int>({1}));
+}
+
+void TestSpatialGrid::forEachInLargeArea() {
+    SpatialGrid<int> grid(100);
+    grid.insert(1, QRectF(0, 0, 50, 50));
+    grid.insert(2, QRectF(5000, 5000, 50, 50));
+    // more cells than occupied, all items are reported:
+    QCOMPARE(itemsIn(grid, QRectF(-100000, -100000, 200000, 200000)), QSet<int>({1, 2}));
+}
+
+void TestSpatialGrid::negativeCoordinates() {
+    SpatialGrid<int> grid(100);
+    grid.insert(1, QRectF(-150, -150, 50, 50));
+    grid.insert(2, QRectF(10, 10, 50, 50));
+    QCOMPARE(itemsIn(grid, QRectF(-200, -200, 100, 100)), QSet<int>({1}));
+}
+
+QTEST_APPLESS_MAIN(TestSpatialGrid)
+
+#include "tst_spatialgrid.moc"
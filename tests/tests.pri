@@ -0,0 +1,11 @@
+# Common settings of all test projects.
+
+QT += testlib
+QT -= gui
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+# the sources are included as "core/helpers/...":
+INCLUDEPATH += $$PWD/../..
+
+CORE_DIR = $$PWD/..
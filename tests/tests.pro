@@ -0,0 +1,14 @@
+# Unit tests and benchmarks of the container classes in helpers/.
+# Like in the applications, this repository has to be checked out as a directory named "core".
+# Build and run: qmake tests.pro && make && make check
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    slotlist \
+    spatialgrid \
+    slaballocator \
+    persistentstatemap \
+    connectedcomponentindex \
+    recordbuffer \
+    benchmark_blockregistry
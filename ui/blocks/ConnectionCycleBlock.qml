@@ -15,11 +15,11 @@ BlockBase {
             text: "Cycle"
 
             InputNode {
-                node: block.node("inputNode")
+                node: block ? block.node("inputNode") : null
             }
 
             OutputNode {
-                node: block.node("outputNode")
+                node: block ? block.node("outputNode") : null
             }
 
         }
@@ -11,10 +11,12 @@ Item {
     property alias color: background.color
     property bool ignoreKeyboardShortcuts: false
 
-	onXChanged: block.positionChanged()
-	onYChanged: block.positionChanged()
+	onXChanged: if (block) block.positionChanged()
+	onYChanged: if (block) block.positionChanged()
+	onWidthChanged: if (block) block.positionChanged()
+	onHeightChanged: if (block) block.positionChanged()
 
-    z: block.focused ? 1 : 0
+    z: block && block.focused ? 1 : 0
     antialiasing: false
 
     Component {
@@ -48,7 +50,7 @@ Item {
             textFormat: Text.AutoText
             wrapMode: Text.Wrap
             color: "white"
-            text: block.getHelpText()
+            text: block ? block.getHelpText() : ""
         }
     }
     BlockOptionButton {
@@ -89,7 +91,7 @@ Item {
         cornerRadius: glowRadius
         spread: 0.1
         color: Qt.rgba(0.9, 0.8, 0.0, 0.5)
-        visible: block.focused && showShadows
+        visible: !!block && block.focused && showShadows
     }
 
     Rectangle {
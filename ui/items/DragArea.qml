@@ -18,14 +18,14 @@ Rectangle {
 
     Rectangle {
         // thin line at the top
-        color: block.focused ? Style.blockFocusColor : "#666"
+        color: block && block.focused ? Style.blockFocusColor : "#666"
         height: 1*dp
         anchors.left: parent.left
         anchors.right: parent.right
     }
 
     Text {
-        color: block.focused ? Style.blockFocusColor : "#999"
+        color: block && block.focused ? Style.blockFocusColor : "#999"
         font.family: "Quicksand"
         font.weight: Font.Bold
         font.pixelSize: 18*dp
@@ -33,7 +33,7 @@ Rectangle {
         verticalAlignment: Text.AlignVCenter
         horizontalAlignment: Text.AlignHCenter
         fontSizeMode: Text.Fit
-        text: block.attr("label").val || root.text
+        text: block && block.attr("label").val || root.text
     }
 }
 
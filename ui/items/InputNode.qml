@@ -9,6 +9,12 @@ Item {
     anchors.left: parent.left
 
     Component.onCompleted: {
+        if (node) node.setGuiItem(this)
+    }
+
+    // the GUI item of the block was reused for another block (see GuiItemPool):
+    onNodeChanged: {
+        if (!node) return
         node.setGuiItem(this)
     }
 
@@ -16,8 +22,8 @@ Item {
         width: 30*dp
         height: 30*dp
         x: -15*dp
-        source: dp <= 1 ? (node.focused ? "qrc:/core/ui/images/node_precomposed_red.png" : "qrc:/core/ui/images/node_precomposed_" + (node.htpMode ? "cyan.png" : "blue.png"))
-                        : (node.focused ? "qrc:/core/ui/images/node_precomposed_red@2x.png" : "qrc:/core/ui/images/node_precomposed_" + (node.htpMode ? "cyan@2x.png" : "blue@2x.png"))
+        source: dp <= 1 ? (node && node.focused ? "qrc:/core/ui/images/node_precomposed_red.png" : "qrc:/core/ui/images/node_precomposed_" + (node && node.htpMode ? "cyan.png" : "blue.png"))
+                        : (node && node.focused ? "qrc:/core/ui/images/node_precomposed_red@2x.png" : "qrc:/core/ui/images/node_precomposed_" + (node && node.htpMode ? "cyan@2x.png" : "blue@2x.png"))
     }
 
     CustomTouchArea {
@@ -9,6 +9,12 @@ Item {
     anchors.left: parent.left
 
     Component.onCompleted: {
+        if (node) node.setGuiItem(this)
+    }
+
+    // the GUI item of the block was reused for another block (see GuiItemPool):
+    onNodeChanged: {
+        if (!node) return
         node.setGuiItem(this)
     }
 
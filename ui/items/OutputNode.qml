@@ -10,14 +10,21 @@ Item {
     anchors.right: parent.right
 
     Component.onCompleted: {
+        if (node) node.setGuiItem(this)
+    }
+
+    // the GUI item of the block was reused for another block (see GuiItemPool):
+    onNodeChanged: {
+        if (!node) return
         node.setGuiItem(this)
+        connectionLines.setNodeObject(node)
     }
 
     Image {
         width: 30*dp
         height: 30*dp
-        source: dp <= 1 ? (node.focused ? "qrc:/core/ui/images/node_precomposed_red.png" : "qrc:/core/ui/images/node_precomposed_blue.png")
-                        : (node.focused ? "qrc:/core/ui/images/node_precomposed_red@2x.png" : "qrc:/core/ui/images/node_precomposed_blue@2x.png")
+        source: dp <= 1 ? (node && node.focused ? "qrc:/core/ui/images/node_precomposed_red.png" : "qrc:/core/ui/images/node_precomposed_blue.png")
+                        : (node && node.focused ? "qrc:/core/ui/images/node_precomposed_red@2x.png" : "qrc:/core/ui/images/node_precomposed_blue@2x.png")
     }
 
     CustomTouchArea {
@@ -36,12 +43,12 @@ Item {
         anchors.fill: parent
         objectName: "connectionLines"
         lineWidth: 3*dp
-        color: node.active ? Style.primaryActionColor : "#555"
+        color: node && node.active ? Style.primaryActionColor : "#555"
         //color: Qt.rgba(0.0, 0.3, 1.0, 0.7)
         z: -1
 
         Component.onCompleted: {
-            setNodeObject(node)
+            if (node) setNodeObject(node)
         }
     }
 
@@ -10,7 +10,14 @@ Item {
     anchors.right: parent.right
 
     Component.onCompleted: {
+        if (node) node.setGuiItem(this)
+    }
+
+    // the GUI item of the block was reused for another block (see GuiItemPool):
+    onNodeChanged: {
+        if (!node) return
         node.setGuiItem(this)
+        connectionLines.setNodeObject(node)
     }
 
     Image {
@@ -41,7 +48,7 @@ Item {
         z: -1
 
         Component.onCompleted: {
-            setNodeObject(node)
+            if (node) setNodeObject(node)
         }
     }
 